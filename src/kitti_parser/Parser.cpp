@@ -32,6 +32,13 @@
 #include <kitti_parser/types/stereo_t.h>
 #include <kitti_parser/types/lidar_t.h>
 #include <kitti_parser/types/gpsimu_t.h>
+#include "kitti_parser/util/FrameCache.h"
+#include "kitti_parser/util/SpscQueue.h"
+#include "kitti_parser/util/MpmcQueue.h"
+#include <mutex>
+#include <thread>
+#include <climits>
+#include <exception>
 #include <boost/lexical_cast.hpp>
 
 
@@ -39,6 +46,16 @@ using namespace std;
 using namespace kitti_parser;
 
 
+/**
+ * Parses a configuration file, which can be on disk or in a mounted archive
+ */
+static YAML::Node load_yaml(Loader* loader, const std::string& path) {
+    std::vector<char> buffer;
+    loader->read(path, buffer);
+    return YAML::Load(std::string(buffer.begin(), buffer.end()));
+}
+
+
 /**
  * Default constructor
  * This should check to make sure that the path is valid
@@ -61,15 +78,44 @@ Parser::Parser(std::string path) {
         return;
     }
 
+    // Create our loader, the calibration and drives are all read through it
+    loader = new Loader(&config, &metrics);
+
+
+    // Loop through all sub folders, assume they are sequential
+    // http://www.boost.org/doc/libs/1_47_0/libs/filesystem/v3/example/tut4.cpp
+    boost::filesystem::path p(config.path_data);
+    vector<boost::filesystem::path> v;
+    {
+        Stats::Timer timer(&metrics, STAGE_SCAN_FOLDERS);
+        copy(boost::filesystem::directory_iterator(p), boost::filesystem::directory_iterator(), back_inserter(v));
+
+        // Sort, since directory iteration
+        // Is not ordered on some file systems
+        sort(v.begin(), v.end());
+    }
+
+    // The configuration files are in the date folder, or in an archive of it like 2011_09_26_calib.zip
+    std::string path_calib = config.path_data;
+    if(!boost::filesystem::exists(path_calib + "calib_cam_to_cam.txt")) {
+        for(size_t i=0; i<v.size(); i++) {
+            if(boost::filesystem::is_regular_file(v.at(i)) && loader->mount(v.at(i).string())
+               && loader->exists(v.at(i).string() + "/calib_cam_to_cam.txt")) {
+                path_calib = v.at(i).string() + "/";
+                break;
+            }
+        }
+    }
+
     // Set the configuration files
-    config.path_calib_cc = config.path_data + "calib_cam_to_cam.txt";
-    config.path_calib_iv = config.path_data + "calib_imu_to_velo.txt";
-    config.path_calib_vc = config.path_data + "calib_velo_to_cam.txt";
+    config.path_calib_cc = path_calib + "calib_cam_to_cam.txt";
+    config.path_calib_iv = path_calib + "calib_imu_to_velo.txt";
+    config.path_calib_vc = path_calib + "calib_velo_to_cam.txt";
 
     // Check to see if configuration file CAM to CAM
-    if(boost::filesystem::exists(config.path_calib_cc)) {
+    if(loader->exists(config.path_calib_cc)) {
         // Load in the config file
-        YAML::Node temp = YAML::LoadFile(config.path_calib_cc);
+        YAML::Node temp = load_yaml(loader, config.path_calib_cc);
         // Loop through nodes, and load each one into a double array
         for(YAML::const_iterator it=temp.begin();it!=temp.end();++it) {
             // Debug
@@ -88,9 +134,9 @@ Parser::Parser(std::string path) {
     }
 
     // Check to see if configuration file IMU to VELO
-    if(boost::filesystem::exists(config.path_calib_iv)) {
+    if(loader->exists(config.path_calib_iv)) {
         // Load in the config file
-        YAML::Node temp = YAML::LoadFile(config.path_calib_iv);
+        YAML::Node temp = load_yaml(loader, config.path_calib_iv);
         // Loop through nodes, and load each one into a double array
         for(YAML::const_iterator it=temp.begin();it!=temp.end();++it) {
             // Debug
@@ -109,9 +155,9 @@ Parser::Parser(std::string path) {
     }
 
     // Check to see if configuration file VELO to CAM
-    if(boost::filesystem::exists(config.path_calib_vc)) {
+    if(loader->exists(config.path_calib_vc)) {
         // Load in the config file
-        YAML::Node temp = YAML::LoadFile(config.path_calib_vc);
+        YAML::Node temp = load_yaml(loader, config.path_calib_vc);
         // Loop through nodes, and load each one into a double array
         for(YAML::const_iterator it=temp.begin();it!=temp.end();++it) {
             // Debug
@@ -129,51 +175,53 @@ Parser::Parser(std::string path) {
         config.has_calib_vc = true;
     }
 
-    // Create our loader
-    loader = new Loader(&config);
-
-
-    // Loop through all sub folders, assume they are sequential
-    // http://www.boost.org/doc/libs/1_47_0/libs/filesystem/v3/example/tut4.cpp
-    boost::filesystem::path p(config.path_data);
-    vector<boost::filesystem::path> v;
-    copy(boost::filesystem::directory_iterator(p), boost::filesystem::directory_iterator(), back_inserter(v));
-
-    // Sort, since directory iteration
-    // Is not ordered on some file systems
-    sort(v.begin(), v.end());
-
 
     for (vector<boost::filesystem::path>::const_iterator it(v.begin()), it_end(v.end()); it != it_end; ++it) {
 
+        // Packed drives and archives act as a folder
+        if(boost::filesystem::is_regular_file(*it)) {
+            if(!loader->mount((*it).string()))
+                continue;
+        }
         // Skip if file
-        if(!boost::filesystem::is_directory(*it))
+        else if(!boost::filesystem::is_directory(*it)) {
             continue;
+        }
 
         // Next sub folder
         string subfolder = (*it).c_str();
         //std::cout << (*it) << "\n";
 
         // Check to see is gray camera is there
-        if (boost::filesystem::exists(subfolder + "/image_00/")
-            && boost::filesystem::exists(subfolder + "/image_01/")) {
+        bool has_sensor = false;
+        if (loader->exists(subfolder + "/image_00/")
+            && loader->exists(subfolder + "/image_01/")) {
             config.has_stereo_gray = true;
+            has_sensor = true;
         }
 
         // Check to see if color camera is there
-        if (boost::filesystem::exists(subfolder + "/image_02/")
-            && boost::filesystem::exists(subfolder + "/image_03/")) {
+        if (loader->exists(subfolder + "/image_02/")
+            && loader->exists(subfolder + "/image_03/")) {
             config.has_stereo_color = true;
+            has_sensor = true;
         }
 
         // Check to see if lidar is there
-        if (boost::filesystem::exists(subfolder + "/velodyne_points/")) {
+        if (loader->exists(subfolder + "/velodyne_points/")) {
             config.has_lidar = true;
+            has_sensor = true;
         }
 
         // Check to see if IMU is there
-        if (boost::filesystem::exists(subfolder + "/oxts/")) {
+        if (loader->exists(subfolder + "/oxts/")) {
             config.has_gpsimu = true;
+            has_sensor = true;
+        }
+
+        // Skip anything without sensor data, like the calibration archive
+        if(!has_sensor) {
+            continue;
         }
 
         // Done, load all the data
@@ -183,6 +231,30 @@ Parser::Parser(std::string path) {
 }
 
 
+/**
+ * Stops the pull reader, and frees anything it loaded that was not pulled
+ * The loader goes after the reader, and the tracer after the stats stop using it
+ */
+Parser::~Parser() {
+    if(pull_queue != nullptr) {
+        pull_queue->close();
+        pull_reader.join();
+        Loader::message_types* msg;
+        while(pull_queue->try_pop(msg))
+            Message::free(msg);
+        delete pull_queue;
+    }
+    delete loader;
+    metrics.set_tracer(nullptr);
+    delete tracer;
+}
+
+
+bool Parser::valid() const {
+    return loader != nullptr;
+}
+
+
 /**
  * Returns the current config file
  */
@@ -191,6 +263,25 @@ Config Parser::getConfig() {
 }
 
 
+/**
+ * Enables the decoded image cache
+ * The first run will build it, and all runs after will read from it
+ */
+void Parser::enable_image_cache(std::string path_cache) {
+    config.path_image_cache = path_cache;
+}
+
+
+/**
+ * Enables the process wide frame cache
+ * The budget is global, so the last parser to set it wins
+ */
+void Parser::enable_frame_cache(size_t budget_bytes) {
+    config.use_frame_cache = true;
+    FrameCache::instance().set_budget(budget_bytes);
+}
+
+
 void Parser::register_callback_stereo_gray(std::function<void(Config*,long, stereo_t*)> callback) {
     callback_stereo_gray = callback;
 }
@@ -207,68 +298,582 @@ void Parser::register_callback_gpsimu(std::function<void(Config *, long, gpsimu_
     callback_gpsimu = callback;
 }
 
+/**
+ * Subscribers are added to the stream, unlike the callbacks which replace the last one
+ */
+void Parser::subscribe_stereo_gray(std::function<void(Config*,long, std::shared_ptr<const stereo_t>)> callback,
+                                   size_t queue_size, overflow_t overflow) {
+    subscribers_stereo_gray.add(callback, queue_size, overflow);
+}
+
+void Parser::subscribe_stereo_color(std::function<void(Config*,long, std::shared_ptr<const stereo_t>)> callback,
+                                    size_t queue_size, overflow_t overflow) {
+    subscribers_stereo_color.add(callback, queue_size, overflow);
+}
+
+void Parser::subscribe_lidar(std::function<void(Config*,long, std::shared_ptr<const lidar_t>)> callback,
+                             size_t queue_size, overflow_t overflow) {
+    subscribers_lidar.add(callback, queue_size, overflow);
+}
+
+void Parser::subscribe_gpsimu(std::function<void(Config*,long, std::shared_ptr<const gpsimu_t>)> callback,
+                              size_t queue_size, overflow_t overflow) {
+    subscribers_gpsimu.add(callback, queue_size, overflow);
+}
+
+/**
+ * Enables the IMU preintegration between camera frames
+ * Needs the oxts folder, frames are given without it otherwise
+ */
+void Parser::enable_preintegration(bool enabled) {
+    config.preintegrate = enabled;
+}
+
+
+/**
+ * Sets the size of the queue between the reader thread and the callbacks
+ */
+void Parser::set_prefetch_size(size_t size) {
+    config.prefetch_size = std::max(size, (size_t)1);
+}
+
+
+/**
+ * Sets how many upcoming files are read through io_uring, zero to read each one when needed
+ * Falls back to normal reads if the kernel does not have io_uring
+ */
+void Parser::set_io_batch(size_t files) {
+    config.io_batch_size = files;
+}
+
+
+/**
+ * Sets the readahead window
+ * Files are hinted in replay order, and the window follows the measured replay speed
+ */
+void Parser::set_readahead(long window_ms) {
+    config.readahead_ms = std::max(window_ms, 0L);
+}
+
+
+/**
+ * Sets how reads use the page cache
+ * When streaming a dataset once, not caching keeps us from evicting everything else on the machine
+ */
+void Parser::set_cache_mode(cache_mode_t mode) {
+    config.cache_mode = mode;
+}
+
+
+/**
+ * Enables or disables threaded dispatch
+ * Order within a stream is kept, order across streams is only kept to within the skew
+ */
+void Parser::set_threaded_dispatch(bool enabled, long max_skew_ms) {
+    config.threaded_dispatch = enabled;
+    config.max_stream_skew = max_skew_ms;
+}
+
+
+/**
+ * Sets the queue for a single stream when running threaded
+ */
+void Parser::set_stream_policy(sensor_t sensor, size_t queue_size, overflow_t overflow) {
+    if(sensor < 0 || sensor >= SENSOR_COUNT)
+        return;
+    config.stream_queue_size[sensor] = std::max(queue_size, (size_t)1);
+    config.stream_overflow[sensor] = overflow;
+}
+
+
 /**
  * This function will call the callback functions and pass the data
+ * A reader thread loads the messages ahead into a queue, while the callbacks are called on this thread
  * This can be run at double the speed, but will be limited by
- * how fast the program can process, as this is not multi-threaded
+ * how fast the program can process, as callbacks are called one at a time
  */
 void Parser::run(double time_multi) {
 
-    // Load the first message
-    Loader::message_types* next = loader->fetch_latest();
+    // Nothing to replay
+    if(loader == nullptr) {
+        std::cerr << "[kitti_parser]: Unable to run, the dataset was not loaded" << std::endl;
+        return;
+    }
 
-    // Loop till we run out of message to send
-    // http://stackoverflow.com/a/5685578
-    while(next != nullptr) {
-
-        // Call the respective callbacks based on that type
-        switch (next->which()) {
-            // it's an stereo_t
-            case 0: {
-                stereo_t* temp_s = boost::get<stereo_t *>(*next);
-                // Send, and check if valid function
-                if (temp_s->is_color && callback_stereo_color){
-                    callback_stereo_color.operator()(&config, temp_s->timestamp, temp_s);
-                }
-                // Check if function has been set
-                else if(!temp_s->is_color && callback_stereo_gray) {
-                    callback_stereo_gray.operator()(&config, temp_s->timestamp, temp_s);
-                }
-                // Else free it since nobody wants it
-                else {
-                    delete temp_s;
-                }
+    // The pull API already owns the loader
+    if(pull_queue != nullptr) {
+        std::cerr << "[kitti_parser]: Unable to run after next() has been called" << std::endl;
+        return;
+    }
 
-                break;
+    // Each stream on its own thread
+    if(config.threaded_dispatch) {
+        try {
+            run_threaded();
+        } catch(...) {
+            stop_subscribers(false);
+            throw;
+        }
+        stop_subscribers(true);
+        write_trace();
+        return;
+    }
+
+    // Reader thread, fetches messages till we run out or the queue is closed
+    SpscQueue<Loader::message_types*> queue(config.prefetch_size);
+    std::thread reader([&]() {
+        read_all(&queue);
+    });
+
+    // Loop till we run out of message to send
+    Loader::message_types* next;
+    last_dump = std::chrono::steady_clock::now();
+    try {
+        while(true) {
+            {
+                Stats::Timer timer(&metrics, STAGE_QUEUE_WAIT);
+                if(!queue.pop(next))
+                    break;
             }
-            // it's a lidar_t
-            case 1: {
-                lidar_t *temp_v = boost::get<lidar_t *>(*next);
-                // Check if function has been set
-                if(callback_lidar) {
-                    callback_lidar.operator()(&config, temp_v->timestamp, temp_v);
-                } else {
-                    delete temp_v;
-                }
-                break;
+            {
+                Stats::Timer timer(&metrics, STAGE_DISPATCH);
+                timer.timestamp = Message::timestamp_of(next);
+                dispatch(next);
             }
-            // it's a gpsimu_t
-            case 2: {
-                gpsimu_t *temp_g = boost::get<gpsimu_t *>(*next);
-                // Check if function has been set
-                if(callback_gpsimu) {
-                    callback_gpsimu.operator()(&config, temp_g->timestamp, temp_g);
-                } else {
-                    delete temp_g;
+            dump_stats();
+        }
+    } catch(...) {
+        // Stop the reader if a callback throws, and free what it loaded
+        queue.close();
+        reader.join();
+        while(queue.try_pop(next))
+            Message::free(next);
+        stop_subscribers(false);
+        throw;
+    }
+    reader.join();
+    stop_subscribers(true);
+    write_trace();
+
+}
+
+
+/**
+ * Runs each registered callback on its own thread, with its own queue
+ * This thread reads the messages and routes them based on each stream's overflow policy.
+ * Before calling a callback, a stream waits till no other stream is busy with a message
+ * that is more than the max skew older, so cross stream order is kept to within that.
+ */
+void Parser::run_threaded() {
+
+    // Shared state between all the threads
+    std::unique_ptr<MpmcQueue<Loader::message_types*>> queues[SENSOR_COUNT];
+    std::atomic<long> busy[SENSOR_COUNT];
+    WaitStrategy progress;
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mtx;
+
+    // Stops everything, used if a callback throws
+    auto stop = [&]() {
+        failed = true;
+        for(int s=0; s<SENSOR_COUNT; s++) {
+            if(queues[s])
+                queues[s]->close();
+        }
+        progress.notify();
+    };
+
+    // Create a queue for each stream that someone wants
+    bool wanted[SENSOR_COUNT] = {callback_stereo_gray || !subscribers_stereo_gray.empty(),
+                                 callback_stereo_color || !subscribers_stereo_color.empty(),
+                                 callback_lidar || !subscribers_lidar.empty(),
+                                 callback_gpsimu || !subscribers_gpsimu.empty()};
+    for(int s=0; s<SENSOR_COUNT; s++) {
+        busy[s] = LONG_MAX;
+        if(wanted[s])
+            queues[s].reset(new MpmcQueue<Loader::message_types*>(config.stream_queue_size[s]));
+    }
+
+    // Start a dispatch thread for each
+    std::vector<std::thread> workers;
+    for(int s=0; s<SENSOR_COUNT; s++) {
+        if(!wanted[s])
+            continue;
+        workers.emplace_back([&, s]() {
+            Loader::message_types* msg;
+            while(queues[s]->pop(msg)) {
+                // Just free if we are shutting down
+                if(failed) {
+                    Message::free(msg);
+                    continue;
                 }
-                break;
+                // Wait for the slower streams to catch up
+                long t = Message::timestamp_of(msg);
+                busy[s] = t;
+                if(config.max_stream_skew >= 0) {
+                    progress.wait([&]() {
+                        for(int o=0; o<SENSOR_COUNT; o++) {
+                            if(o != s && busy[o] != LONG_MAX && t - busy[o] > config.max_stream_skew)
+                                return (bool)failed;
+                        }
+                        return true;
+                    });
+                }
+                // Send it
+                try {
+                    Stats::Timer timer(&metrics, STAGE_DISPATCH);
+                    timer.timestamp = t;
+                    dispatch(msg);
+                } catch(...) {
+                    std::lock_guard<std::mutex> lock(error_mtx);
+                    if(!error)
+                        error = std::current_exception();
+                    stop();
+                }
+                busy[s] = LONG_MAX;
+                progress.notify();
             }
+        });
+    }
+
+    // Route all the messages
+    last_dump = std::chrono::steady_clock::now();
+    Loader::message_types* next = loader->fetch_latest();
+    while(next != nullptr && !failed) {
+        dump_stats();
+        sensor_t s = Message::sensor_of(next);
+        if(!queues[s]) {
+            Message::free(next);
+        } else if(config.stream_overflow[s] == OVERFLOW_DROP_NEWEST) {
+            if(!queues[s]->try_push(next))
+                Message::free(next);
+        } else if(config.stream_overflow[s] == OVERFLOW_DROP_OLDEST) {
+            if(!queues[s]->push_drop_oldest(next, [](Loader::message_types* old) { Message::free(old); }))
+                Message::free(next);
+        } else if(!queues[s]->push(next)) {
+            Message::free(next);
         }
+        next = loader->fetch_latest();
+    }
+    if(next != nullptr)
+        Message::free(next);
 
+    // Let the streams finish what is queued
+    for(int s=0; s<SENSOR_COUNT; s++) {
+        if(queues[s])
+            queues[s]->close();
+    }
+    for(size_t i=0; i<workers.size(); i++) {
+        workers.at(i).join();
+    }
+    for(int s=0; s<SENSOR_COUNT; s++) {
+        while(queues[s] && queues[s]->try_pop(next))
+            Message::free(next);
+    }
 
-        // Get the next message from the loader
-        next = loader->fetch_latest();
+    // Pass on any callback error
+    if(error)
+        std::rethrow_exception(error);
+
+}
+
+
+/**
+ * Pulls the next message, the first call starts the reader thread
+ * This is the same pipeline as run(), but the caller takes the place of the dispatch loop
+ */
+Message Parser::next() {
+
+    // Nothing to replay, so we are already done
+    if(loader == nullptr)
+        return Message();
+
+    // Start the reader the first time
+    start_pull();
+
+    // Wait for the next one
+    Loader::message_types* msg = nullptr;
+    {
+        Stats::Timer timer(&metrics, STAGE_QUEUE_WAIT);
+        if(!pull_queue->pop(msg))
+            msg = nullptr;
+    }
+    return finish_pull(msg);
+
+}
+
+
+/**
+ * Pulls the next message if the reader has one ready
+ * Once the queue is closed we check it again, since the last push can race the close
+ */
+bool Parser::poll(Message& msg) {
+
+    // Nothing to replay, so we are already done
+    if(loader == nullptr) {
+        msg = Message();
+        return true;
+    }
+
+    // Start the reader the first time
+    start_pull();
+
+    // Take one if it is there
+    Loader::message_types* next = nullptr;
+    if(!pull_queue->try_pop(next)) {
+        if(!pull_queue->closed())
+            return false;
+        if(!pull_queue->try_pop(next))
+            next = nullptr;
+    }
+    msg = finish_pull(next);
+    return true;
+
+}
+
+
+/**
+ * Sets the function the reader calls when a message is ready
+ */
+void Parser::set_ready_callback(std::function<void()> callback) {
+    if(pull_queue != nullptr) {
+        std::cerr << "[kitti_parser]: Unable to set the ready callback after the reader has started" << std::endl;
+        return;
+    }
+    callback_ready = callback;
+}
+
+
+/**
+ * Loads the next message on this thread, without the reader or its queue
+ */
+Message Parser::fetch() {
+
+    // Cannot share the loader with the reader
+    if(pull_queue != nullptr) {
+        std::cerr << "[kitti_parser]: Unable to fetch after next() has been called" << std::endl;
+        return Message();
+    }
+    if(pull_done || loader == nullptr)
+        return Message();
+
+    // Load it right here
+    return finish_pull(loader->fetch_latest());
+
+}
+
+
+/**
+ * Creates the queue and the reader thread that fills it
+ */
+void Parser::start_pull() {
+    if(pull_queue != nullptr)
+        return;
+    pull_queue = new SpscQueue<Loader::message_types*>(config.prefetch_size);
+    last_dump = std::chrono::steady_clock::now();
+    pull_reader = std::thread([this]() {
+        read_all(pull_queue, callback_ready);
+    });
+}
+
+
+/**
+ * Wraps a pulled message, and writes the trace once we run out
+ */
+Message Parser::finish_pull(Loader::message_types* msg) {
+    dump_stats();
+    if(msg == nullptr && !pull_done) {
+        pull_done = true;
+        write_trace();
     }
+    return Message(msg);
+}
 
+
+/**
+ * Fetches messages till we run out or the queue is closed
+ */
+void Parser::read_all(SpscQueue<Loader::message_types*>* queue, const std::function<void()>& notify) {
+    Loader::message_types* msg = loader->fetch_latest();
+    while(msg != nullptr && queue->push(msg)) {
+        if(notify)
+            notify();
+        msg = loader->fetch_latest();
+    }
+    if(msg != nullptr)
+        Message::free(msg);
+    queue->close();
+    if(notify)
+        notify();
 }
 
+
+/**
+ * Looks up the pose in the trajectory computed when loading
+ * Between records the rotation is SLERPed and the position is linear
+ */
+bool Parser::pose_at(long timestamp, pose_t& pose) {
+    return trajectory().pose_at(timestamp, pose);
+}
+
+
+const Trajectory& Parser::trajectory() {
+    static const Trajectory empty;
+    return (loader != nullptr)? loader->trajectory() : empty;
+}
+
+
+const OxtsTable& Parser::oxts() {
+    static const OxtsTable empty;
+    return (loader != nullptr)? loader->oxts() : empty;
+}
+
+
+const std::vector<long>& Parser::times(sensor_t sensor) {
+    static const std::vector<long> empty;
+    return (loader != nullptr)? loader->times(sensor) : empty;
+}
+
+
+/**
+ * Bypasses the batched reads and the frame cache, which belong to the replay
+ */
+std::shared_ptr<const lidar_t> Parser::lidar_at(size_t idx) {
+    if(loader == nullptr)
+        return std::shared_ptr<const lidar_t>();
+    return loader->share(loader->read_lidar(idx));
+}
+
+
+/**
+ * Returns the timings of every stage, summed over all threads
+ */
+Stats::snapshot_t Parser::stats() {
+    return metrics.snapshot();
+}
+
+
+/**
+ * Sets how often the stats are printed while running
+ */
+void Parser::set_stats_interval(double seconds) {
+    config.stats_interval = seconds;
+}
+
+
+/**
+ * Enables tracing, every timed stage is also recorded as an event
+ * Each thread keeps the last events_per_thread events
+ */
+void Parser::enable_tracing(std::string path_trace, size_t events_per_thread) {
+    config.path_trace = path_trace;
+    if(tracer == nullptr)
+        tracer = new Tracer(events_per_thread);
+    metrics.set_tracer(tracer);
+}
+
+
+/**
+ * Writes the trace file if we are tracing
+ */
+void Parser::write_trace() {
+    if(tracer == nullptr || config.path_trace.empty())
+        return;
+    if(!tracer->write(config.path_trace))
+        std::cerr << "[kitti_parser]: Unable to write trace " << config.path_trace << std::endl;
+}
+
+
+/**
+ * Prints the stats if enabled and it has been long enough since the last time
+ */
+void Parser::dump_stats() {
+    if(config.stats_interval <= 0)
+        return;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(std::chrono::duration<double>(now - last_dump).count() < config.stats_interval)
+        return;
+    last_dump = now;
+    std::cout << "[kitti_parser]: Stats" << std::endl << stats().summary() << std::flush;
+}
+
+
+/**
+ * Call the respective callbacks based on that type
+ * Callbacks own the data they get, so we free anything nobody registered for
+ */
+void Parser::dispatch(Loader::message_types* next) {
+
+    // The variant itself is ours, also if a callback throws
+    std::unique_ptr<Loader::message_types> owned(next);
+
+    // http://stackoverflow.com/a/5685578
+    switch (next->which()) {
+        // it's an stereo_t
+        case 0: {
+            stereo_t* temp_s = boost::get<stereo_t *>(*next);
+            if(temp_s->is_color)
+                send(temp_s, STAGE_CALLBACK_STEREO_COLOR, callback_stereo_color, subscribers_stereo_color);
+            else
+                send(temp_s, STAGE_CALLBACK_STEREO_GRAY, callback_stereo_gray, subscribers_stereo_gray);
+            break;
+        }
+        // it's a lidar_t
+        case 1: {
+            lidar_t *temp_v = boost::get<lidar_t *>(*next);
+            send(temp_v, STAGE_CALLBACK_LIDAR, callback_lidar, subscribers_lidar);
+            break;
+        }
+        // it's a gpsimu_t
+        case 2: {
+            gpsimu_t *temp_g = boost::get<gpsimu_t *>(*next);
+            send(temp_g, STAGE_CALLBACK_GPSIMU, callback_gpsimu, subscribers_gpsimu);
+            break;
+        }
+    }
+
+}
+
+
+/**
+ * Sends a measurement to the callback and subscribers of its stream
+ * The callback deletes what it gets, so if there are also subscribers it gets its own deep copy.
+ * Subscribers all share the one we loaded, which is freed after the last of them is done.
+ */
+template<typename T>
+void Parser::send(T* msg, stage_t stage, std::function<void(Config*,long, T*)>& callback, Fanout<T>& subscribers) {
+
+    // Free it since nobody wants it
+    if(!callback && subscribers.empty()) {
+        delete msg;
+        return;
+    }
+
+    // Send, timing all the callbacks
+    Stats::Timer timer(&metrics, stage);
+    timer.timestamp = msg->timestamp;
+    if(subscribers.empty()) {
+        callback.operator()(&config, msg->timestamp, msg);
+        return;
+    }
+    long timestamp = msg->timestamp;
+    std::shared_ptr<const T> shared = loader->share(msg);
+    if(callback)
+        callback.operator()(&config, timestamp, loader->copy(*shared));
+    subscribers.publish(&config, timestamp, shared);
+
+}
+
+
+/**
+ * Waits for all threaded subscribers to finish what they have queued
+ */
+void Parser::stop_subscribers(bool rethrow) {
+    std::exception_ptr errors[SENSOR_COUNT] = {subscribers_stereo_gray.stop(), subscribers_stereo_color.stop(),
+                                               subscribers_lidar.stop(), subscribers_gpsimu.stop()};
+    for(int s=0; s<SENSOR_COUNT && rethrow; s++) {
+        if(errors[s])
+            std::rethrow_exception(errors[s]);
+    }
+}
@@ -28,17 +28,29 @@
 
 #include <string>
 #include <iostream>
+#include <chrono>
 #include <functional>
+#include <thread>
+#include <memory>
 #include "kitti_parser/util/Config.h"
 #include "kitti_parser/util/Loader.h"
+#include "kitti_parser/util/Stats.h"
+#include "kitti_parser/util/Tracer.h"
+#include "kitti_parser/util/Message.h"
+#include "kitti_parser/util/SpscQueue.h"
+#include "kitti_parser/util/Fanout.h"
 #include "kitti_parser/types/stereo_t.h"
 #include "kitti_parser/types/lidar_t.h"
 #include "kitti_parser/types/gpsimu_t.h"
+#include "kitti_parser/types/pose_t.h"
 
 
 
 namespace kitti_parser {
 
+    template<typename... S>
+    class Reader;
+
     class Parser {
 
     public:
@@ -46,26 +58,127 @@ namespace kitti_parser {
         // Default constructor
         Parser(std::string data_path);
 
+        // Stops the reader of the pull API if it is running, and frees everything loaded
+        ~Parser();
+
+        Parser(const Parser&) = delete;
+        Parser& operator=(const Parser&) = delete;
+
+        // True if the dataset was found, nothing can be replayed otherwise
+        bool valid() const;
+
         // Returns the current config
         Config getConfig();
 
+        // Cache decoded images in the given folder, so later replays skip the PNG decode
+        void enable_image_cache(std::string path_cache);
+
+        // Share decoded frames with all other parsers in this process, up to the given number of bytes
+        void enable_frame_cache(size_t budget_bytes);
+
+        // Give each camera frame the IMU preintegrated since the previous frame (stereo_t::imu)
+        void enable_preintegration(bool enabled);
+
         // Register callback functions
         void register_callback_stereo_gray(std::function<void(Config*,long, stereo_t*)> callback);
         void register_callback_stereo_color(std::function<void(Config*,long, stereo_t*)> callback);
         void register_callback_lidar(std::function<void(Config*,long, lidar_t*)> callback);
         void register_callback_gpsimu(std::function<void(Config*,long, gpsimu_t*)> callback);
 
+        // Add subscribers to a stream, which all share one read only message
+        // With a queue size above zero the subscriber is called on its own thread, with that queue and overflow policy
+        void subscribe_stereo_gray(std::function<void(Config*,long, std::shared_ptr<const stereo_t>)> callback,
+                                   size_t queue_size = 0, overflow_t overflow = OVERFLOW_BLOCK);
+        void subscribe_stereo_color(std::function<void(Config*,long, std::shared_ptr<const stereo_t>)> callback,
+                                    size_t queue_size = 0, overflow_t overflow = OVERFLOW_BLOCK);
+        void subscribe_lidar(std::function<void(Config*,long, std::shared_ptr<const lidar_t>)> callback,
+                             size_t queue_size = 0, overflow_t overflow = OVERFLOW_BLOCK);
+        void subscribe_gpsimu(std::function<void(Config*,long, std::shared_ptr<const gpsimu_t>)> callback,
+                              size_t queue_size = 0, overflow_t overflow = OVERFLOW_BLOCK);
+
+        // Set how many messages are loaded ahead of the callbacks
+        void set_prefetch_size(size_t size);
+
+        // Read the next files in batches through io_uring, keeping up to this many in flight
+        void set_io_batch(size_t files);
+
+        // Hint the files needed over the next window of wall time to the kernel, zero to disable
+        void set_readahead(long window_ms);
+
+        // Set how reads use the page cache, CACHE_DROP or CACHE_DIRECT for a single pass over a large dataset
+        void set_cache_mode(cache_mode_t mode);
+
+        // Call each callback on its own thread, streams can get at most max_skew_ms ahead of each other
+        void set_threaded_dispatch(bool enabled, long max_skew_ms = 100);
+
+        // Set the queue size and what to do when full for a stream, only used when threaded
+        void set_stream_policy(sensor_t sensor, size_t queue_size, overflow_t overflow);
+
         // Main run function, will call callbacks
         void run(double time_multi);
 
+        // Pull the next message instead of using callbacks, waits if the reader is behind
+        // Empty once all messages are done, do not mix with run()
+        Message next();
+
+        // Same as next() but never waits, false if the reader is behind
+        // True with an empty message once all messages are done
+        bool poll(Message& msg);
+
+        // Called on the reader thread each time a message is ready to pull, and once when done
+        // Has to be set before the first next() or poll()
+        void set_ready_callback(std::function<void()> callback);
+
+        // Load the next message on the calling thread, for callers that schedule the work themselves
+        // Empty once all messages are done, do not mix with next() or run()
+        Message fetch();
+
+        // Pose of the IMU at any time, relative to the start of its drive, false if there is no OXTS data then
+        bool pose_at(long timestamp, pose_t& pose);
+
+        // Poses of the IMU for every OXTS record
+        const Trajectory& trajectory();
+
+        // Every OXTS record, one column per field
+        const OxtsTable& oxts();
+
+        // Timestamps of every message of a stream, the lidar uses the middle of each scan
+        const std::vector<long>& times(sensor_t sensor);
+
+        // Read one scan straight from storage, safe to call from many threads at once
+        std::shared_ptr<const lidar_t> lidar_at(size_t idx);
+
+        // Timings of each stage so far
+        Stats::snapshot_t stats();
+
+        // Print the stats every so many seconds while running, zero to disable
+        void set_stats_interval(double seconds);
+
+        // Record a timeline of every fetch, decode and callback, written to the file after each run
+        void enable_tracing(std::string path_trace, size_t events_per_thread = 65536);
+
 
     private:
 
+        // Fixed set readers merge the loaded streams themselves
+        template<typename... S>
+        friend class Reader;
+
+        // The Python bindings go through the loaded index directly
+        friend class PythonModule;
+
         // Main config
         Config config;
 
-        // Loader with all the data
-        Loader* loader;
+        // Loader with all the data, null if the path was invalid
+        Loader* loader = nullptr;
+
+        // Timings of all stages
+        Stats metrics;
+        std::chrono::steady_clock::time_point last_dump;
+
+        // Timeline, null if not tracing
+        Tracer* tracer = nullptr;
 
         // List of callback functions to call
         std::function<void(Config*,long, stereo_t*)> callback_stereo_gray;
@@ -73,6 +186,46 @@ namespace kitti_parser {
         std::function<void(Config*,long, lidar_t*)> callback_lidar;
         std::function<void(Config*,long, gpsimu_t*)> callback_gpsimu;
 
+        // Subscribers of each stream
+        Fanout<stereo_t> subscribers_stereo_gray;
+        Fanout<stereo_t> subscribers_stereo_color;
+        Fanout<lidar_t> subscribers_lidar;
+        Fanout<gpsimu_t> subscribers_gpsimu;
+
+        // Prefetched messages for the pull API, and the thread loading them
+        SpscQueue<Loader::message_types*>* pull_queue = nullptr;
+        std::thread pull_reader;
+        bool pull_done = false;
+        std::function<void()> callback_ready;
+
+        // Loads all messages into the queue, till we run out or it is closed
+        // The notify function is called after each push and once closed
+        void read_all(SpscQueue<Loader::message_types*>* queue, const std::function<void()>& notify = nullptr);
+
+        // Starts the reader of the pull API if it is not running
+        void start_pull();
+
+        // Hands out a pulled message, writing the trace once we run out
+        Message finish_pull(Loader::message_types* msg);
+
+        // Run with one thread per stream
+        void run_threaded();
+
+        // Print the stats if the interval has passed
+        void dump_stats();
+
+        // Write the trace file if enabled
+        void write_trace();
+
+        // Sends the message to its callback and subscribers, or frees it
+        void dispatch(Loader::message_types* next);
+
+        // Sends a single measurement of a stream
+        template<typename T>
+        void send(T* msg, stage_t stage, std::function<void(Config*,long, T*)>& callback, Fanout<T>& subscribers);
+
+        // Wait for the threaded subscribers, and pass on their first error if asked
+        void stop_subscribers(bool rethrow);
 
 
     };
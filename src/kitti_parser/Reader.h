@@ -0,0 +1,176 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_READER_H
+#define KITTI_PARSER_READER_H
+
+
+#include <climits>
+#include <iostream>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "kitti_parser/Parser.h"
+#include "kitti_parser/util/Config.h"
+#include "kitti_parser/util/Loader.h"
+#include "kitti_parser/types/sensor_t.h"
+#include "kitti_parser/types/stereo_t.h"
+#include "kitti_parser/types/lidar_t.h"
+#include "kitti_parser/types/gpsimu_t.h"
+
+
+
+namespace kitti_parser {
+
+    /**
+     * Streams a Reader can replay, each knows its measurement type and how to load one
+     */
+    namespace Sensors {
+
+        struct StereoGray {
+            typedef stereo_t type;
+            static const sensor_t id = SENSOR_STEREO_GRAY;
+            static stereo_t* fetch(Loader* loader, size_t idx) { return loader->fetch_stereo(idx, false); }
+        };
+
+        struct StereoColor {
+            typedef stereo_t type;
+            static const sensor_t id = SENSOR_STEREO_COLOR;
+            static stereo_t* fetch(Loader* loader, size_t idx) { return loader->fetch_stereo(idx, true); }
+        };
+
+        struct Lidar {
+            typedef lidar_t type;
+            static const sensor_t id = SENSOR_LIDAR;
+            static lidar_t* fetch(Loader* loader, size_t idx) { return loader->fetch_lidar(idx); }
+        };
+
+        struct Oxts {
+            typedef gpsimu_t type;
+            static const sensor_t id = SENSOR_GPSIMU;
+            static gpsimu_t* fetch(Loader* loader, size_t idx) { return loader->fetch_gpsimu(idx); }
+        };
+
+        // True if the streams are listed in the order of their sensor ids, each once
+        template<typename... S>
+        struct ordered : std::true_type {};
+        template<typename A, typename B, typename... S>
+        struct ordered<A, B, S...> : std::integral_constant<bool, (A::id < B::id) && ordered<B, S...>::value> {};
+
+    }
+
+
+    /**
+     * Replays a fixed set of streams of a parser, like Reader<Sensors::Lidar, Sensors::Oxts>
+     * The streams and handlers are known at compile time, so the merge is over a fixed number of
+     * streams, each handler is called directly, and streams not listed are never loaded.
+     * Handlers take (Config*, long, T*) like the callbacks, and own the measurement.
+     * There is no pacing, messages are handed out as fast as they load, meant for batch tools.
+     * Do not mix with run() or next() of the same parser.
+     */
+    template<typename... S>
+    class Reader {
+
+        static_assert(sizeof...(S) > 0, "Reader needs at least one stream");
+        static_assert(Sensors::ordered<S...>::value, "Reader streams must be listed once each, in the order of Sensors");
+
+    public:
+
+        // Number of streams we replay
+        static const size_t N = sizeof...(S);
+
+        // Replays the drive the parser has loaded, nothing if it did not load
+        explicit Reader(Parser& parser) : parser(parser) {
+            static const std::vector<long> none;
+            const sensor_t ids[N] = {S::id...};
+            for(size_t i=0; i<N; i++) {
+                time[i] = (parser.loader != nullptr)? &parser.loader->times(ids[i]) : &none;
+                idx[i] = 0;
+                curr[i] = (time[i]->empty())? LONG_MAX : time[i]->at(0);
+            }
+        }
+
+        /**
+         * Hands every message to the handler of its stream, one handler per stream in the same order
+         */
+        template<typename... H>
+        void run(H... handlers) {
+
+            static_assert(sizeof...(H) == N, "Reader needs one handler per stream");
+
+            // Cannot share the loader with the reader thread
+            if(parser.pull_queue != nullptr) {
+                std::cerr << "[kitti_parser]: Unable to read after next() has been called" << std::endl;
+                return;
+            }
+
+            while(true) {
+                // Oldest stream, ties go to the later one like Loader::next_stream()
+                size_t k = N;
+                long oldest = LONG_MAX;
+                for(size_t i=0; i<N; i++) {
+                    if(curr[i] != LONG_MAX && curr[i] <= oldest) {
+                        oldest = curr[i];
+                        k = i;
+                    }
+                }
+                if(k == N)
+                    break;
+                emit<0>(k, handlers...);
+            }
+
+        }
+
+    private:
+
+        Parser& parser;
+
+        // Timestamps, index and current timestamp of each stream
+        const std::vector<long>* time[N];
+        size_t idx[N];
+        long curr[N];
+
+        // Loads the next measurement of stream k, and hands it to its handler
+        template<size_t I, typename H0, typename... H>
+        void emit(size_t k, H0& handler, H&... rest) {
+            if(k != I) {
+                emit<I+1>(k, rest...);
+                return;
+            }
+            typedef typename std::tuple_element<I, std::tuple<S...>>::type sensor;
+            handler(&parser.config, curr[I], sensor::fetch(parser.loader, idx[I]));
+            idx[I]++;
+            curr[I] = (idx[I] == time[I]->size())? LONG_MAX : (*time[I])[idx[I]];
+        }
+
+        template<size_t I>
+        void emit(size_t) {}
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_READER_H
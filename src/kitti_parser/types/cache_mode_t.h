@@ -0,0 +1,48 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_CACHE_MODE_H
+#define KITTI_PARSER_CACHE_MODE_H
+
+
+namespace kitti_parser {
+
+    typedef enum {
+
+        // Normal buffered reads, files stay in the page cache
+        CACHE_NORMAL = 0,
+
+        // Buffered reads, but each file is dropped from the page cache once read
+        // and the next files are hinted so the kernel reads them ahead
+        CACHE_DROP = 1,
+
+        // Reads bypass the page cache with O_DIRECT, falls back to dropping if not supported
+        CACHE_DIRECT = 2
+
+    } cache_mode_t;
+
+}
+
+
+#endif //KITTI_PARSER_CACHE_MODE_H
@@ -0,0 +1,59 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_PREINTEGRATION_H
+#define KITTI_PARSER_PREINTEGRATION_H
+
+namespace kitti_parser {
+
+    typedef struct {
+
+        // Interval that was integrated over (ms), from the previous camera frame to this one
+        long timestamp_start;
+        long timestamp_end;
+
+        // Number of OXTS samples used, and the length of the interval (s)
+        int num_samples;
+        double dt;
+
+        // Preintegrated rotation, velocity and position in the IMU frame at the start
+        // All 3x3 matrices are row major, biases are taken as zero
+        double dR[9];
+        double dv[3];
+        double dp[3];
+
+        // Jacobians with respect to the gyroscope (bg) and accelerometer (ba) biases
+        // Used to correct the deltas for a new bias estimate without integrating again
+        double dR_dbg[9];
+        double dv_dba[9];
+        double dv_dbg[9];
+        double dp_dba[9];
+        double dp_dbg[9];
+
+    } preintegration_t;
+
+}
+
+
+#endif //KITTI_PARSER_PREINTEGRATION_H
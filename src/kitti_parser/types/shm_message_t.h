@@ -0,0 +1,63 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_SHM_MESSAGE_H
+#define KITTI_PARSER_SHM_MESSAGE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "kitti_parser/types/sensor_t.h"
+#include "kitti_parser/types/stereo_t.h"
+#include "kitti_parser/types/gpsimu_t.h"
+
+namespace kitti_parser {
+
+    typedef struct {
+
+        // Position in the publisher's stream, starting at zero with no gaps
+        uint64_t seq;
+
+        sensor_t sensor;
+        long timestamp;
+
+        // Stereo frame, the images point into the shared memory and are read only
+        stereo_t stereo;
+
+        // GPS/IMU measurement in the shared memory
+        const gpsimu_t* gpsimu;
+
+        // Lidar scan, the points are in the shared memory
+        long lidar_start;
+        long lidar_end;
+        const std::array<float,4>* points;
+        size_t num_points;
+
+    } shm_message_t;
+
+}
+
+
+#endif //KITTI_PARSER_SHM_MESSAGE_H
@@ -26,6 +26,7 @@
 #define KITTI_PARSER_STEREO_H
 
 #include <opencv2/core/mat.hpp>
+#include "kitti_parser/types/preintegration_t.h"
 
 namespace kitti_parser {
 
@@ -41,6 +42,10 @@ namespace kitti_parser {
         cv::Mat image_left;
         cv::Mat image_right;
 
+        // IMU preintegrated since the previous frame, only set if enabled and there is OXTS data
+        bool has_imu;
+        preintegration_t imu;
+
     } stereo_t;
 
 }
@@ -0,0 +1,175 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_ASYNCREADER_H
+#define KITTI_PARSER_ASYNCREADER_H
+
+// The library itself is C++11, this header only exists for callers built with coroutines
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include "kitti_parser/Parser.h"
+#include "kitti_parser/util/Message.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Awaitable replay over the pull API, for callers running on a coroutine executor
+     * `co_await reader.next_frame()` suspends till the next message is ready instead of
+     * blocking a thread, so one thread can drive many replays at once.
+     * With WORK_LIBRARY the parser's reader thread loads ahead and wakes the coroutine,
+     * with WORK_EXECUTOR each load is posted to the executor and nothing else runs in the background.
+     * Only one next_frame() can be awaited at a time, and the parser cannot be used by anything else.
+     */
+    class AsyncReader {
+
+    public:
+
+        // Runs a job on the caller's executor
+        typedef std::function<void(std::function<void()>)> executor_t;
+
+        // Where the files are read and decoded
+        enum work_t {
+            WORK_LIBRARY,   // reader thread of the parser, prefetching ahead
+            WORK_EXECUTOR,  // as a job on the executor, one message per await
+        };
+
+        // Without an executor the coroutine resumes on the parser's reader thread
+        explicit AsyncReader(Parser& parser, executor_t executor = nullptr, work_t work = WORK_LIBRARY)
+            : parser(parser), work(work), parked(std::make_shared<parked_t>()) {
+            parked->executor = std::move(executor);
+            if(this->work == WORK_EXECUTOR && !parked->executor) {
+                std::cerr << "[kitti_parser]: Loading on the executor needs one, using the reader thread" << std::endl;
+                this->work = WORK_LIBRARY;
+            }
+            if(this->work == WORK_LIBRARY) {
+                // The reader thread can outlive us, so it only holds on to the parked state
+                std::shared_ptr<parked_t> state = parked;
+                parser.set_ready_callback([state]() { wake(*state); });
+            }
+        }
+
+        AsyncReader(const AsyncReader&) = delete;
+        AsyncReader& operator=(const AsyncReader&) = delete;
+
+        /**
+         * Awaiter for the next message, empty once the replay is done
+         */
+        class next_awaiter {
+
+        public:
+
+            explicit next_awaiter(AsyncReader* reader) : reader(reader) {}
+
+            // Skip suspending if the reader is already ahead of us
+            bool await_ready() {
+                if(reader->work == WORK_EXECUTOR)
+                    return false;
+                return reader->parser.poll(msg);
+            }
+
+            // Park the coroutine till the reader pushes, or post the load to the executor
+            bool await_suspend(std::coroutine_handle<> handle) {
+
+                // Load on the executor, then resume there
+                if(reader->work == WORK_EXECUTOR) {
+                    reader->parked->executor([this, handle]() {
+                        msg = reader->parser.fetch();
+                        handle.resume();
+                    });
+                    return true;
+                }
+
+                // Check again under the lock, a push before we park would not wake us
+                std::lock_guard<std::mutex> lock(reader->parked->lock);
+                if(reader->parser.poll(msg))
+                    return false;
+                reader->parked->handle = handle;
+                suspended = true;
+                return true;
+
+            }
+
+            // Once woken the message is in the queue, we only fall back to waiting for it if that broke
+            Message await_resume() {
+                if(suspended && !reader->parser.poll(msg))
+                    msg = reader->parser.next();
+                return std::move(msg);
+            }
+
+        private:
+
+            AsyncReader* reader;
+            Message msg;
+            bool suspended = false;
+
+        };
+
+        // Awaitable next message, empty once the replay is done
+        next_awaiter next_frame() {
+            return next_awaiter(this);
+        }
+
+    private:
+
+        // Coroutine waiting for the reader, and where to resume it
+        typedef struct {
+            std::mutex lock;
+            std::coroutine_handle<> handle;
+            executor_t executor;
+        } parked_t;
+
+        Parser& parser;
+        work_t work;
+        std::shared_ptr<parked_t> parked;
+
+        // Called by the reader after each push, resumes whoever is parked
+        static void wake(parked_t& state) {
+            std::coroutine_handle<> handle;
+            {
+                std::lock_guard<std::mutex> lock(state.lock);
+                std::swap(handle, state.handle);
+            }
+            if(!handle)
+                return;
+            if(state.executor)
+                state.executor([handle]() { handle.resume(); });
+            else
+                handle.resume();
+        }
+
+    };
+
+}
+
+#endif
+
+#endif //KITTI_PARSER_ASYNCREADER_H
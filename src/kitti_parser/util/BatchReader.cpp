@@ -0,0 +1,303 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/BatchReader.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// What a completion was for, kept in the low bits of the request pointer
+static const uint64_t OP_OPEN = 1;
+static const uint64_t OP_STATX = 2;
+static const uint64_t OP_READ = 3;
+static const uint64_t OP_CLOSE = 4;
+static const uint64_t OP_MASK = 7;
+
+
+/**
+ * Sets up the ring, each file can have an open and a stat in flight at the same time
+ * plus the close of a file that is done, so we leave room for that
+ */
+BatchReader::BatchReader(MountStorage* store, size_t size) : ring((unsigned)(4*std::max<size_t>(size, 1))) {
+    storage = store;
+    depth = size;
+}
+
+
+/**
+ * Waits for everything in the ring, since the kernel still writes into our buffers
+ */
+BatchReader::~BatchReader() {
+    while(in_flight > 0 && ring.valid())
+        reap(true);
+    for(std::map<std::string, request_t*>::iterator it=requests.begin(); it!=requests.end(); ++it) {
+        if(it->second->owned && it->second->fd >= 0)
+            close(it->second->fd);
+        delete it->second;
+    }
+}
+
+
+bool BatchReader::batched() const {
+    return ring.valid();
+}
+
+
+/**
+ * Drops what we passed, then starts the new files up to our depth
+ * Everything new goes into the kernel with a single submit
+ */
+void BatchReader::prefetch(const std::vector<std::string>& paths) {
+
+    // Nothing to do without a ring
+    if(!ring.valid())
+        return;
+
+    // Drop requests that are no longer coming up
+    std::map<std::string, bool> wanted;
+    for(size_t i=0; i<paths.size() && i<depth; i++)
+        wanted[paths.at(i)] = true;
+    for(std::map<std::string, request_t*>::iterator it=requests.begin(); it!=requests.end();) {
+        request_t* request = it->second;
+        if(wanted.find(it->first) != wanted.end()) {
+            ++it;
+            continue;
+        }
+        request->stale = true;
+        if(request->pending == 0) {
+            finish(request, request->failed);
+            delete request;
+        }
+        it = requests.erase(it);
+    }
+
+    // Start the new ones
+    for(size_t i=0; i<paths.size() && requests.size()<depth; i++) {
+        if(requests.find(paths.at(i)) != requests.end())
+            continue;
+        request_t* request = new request_t;
+        request->path = paths.at(i);
+        if(!start(request)) {
+            delete request;
+            continue;
+        }
+        requests[request->path] = request;
+    }
+    ring.submit(0);
+
+}
+
+
+/**
+ * Reads the file from its batched request if there is one
+ * Anything that failed in the ring is read through the storage instead
+ */
+bool BatchReader::read(const std::string& path, std::vector<char>& out) {
+
+    // Normal read if we do not have it
+    std::map<std::string, request_t*>::iterator it = requests.find(path);
+    if(it == requests.end())
+        return storage->read_all(path, out);
+
+    // Handle completions until it is done
+    request_t* request = it->second;
+    reap(false);
+    while(!request->finished && request->pending > 0)
+        reap(true);
+    if(!request->finished)
+        finish(request, true);
+    requests.erase(it);
+
+    // Hand over the buffer
+    bool success = request->finished && !request->failed;
+    if(success)
+        out.swap(request->buffer);
+    delete request;
+    return success || storage->read_all(path, out);
+
+}
+
+
+/**
+ * Files in an archive are already open, so we read straight away
+ * Files on disk are opened and sized at the same time
+ */
+bool BatchReader::start(request_t* request) {
+
+    // See where the file is
+    std::string inner;
+    Storage* where = storage->resolve(request->path, inner);
+    ArchiveStorage* archive = dynamic_cast<ArchiveStorage*>(where);
+    if(archive != nullptr) {
+        if(!archive->locate(inner, request->fd, request->offset, request->size))
+            return false;
+        request->opened = true;
+        request->sized = true;
+        next_read(request);
+        return !request->failed;
+    }
+    if(dynamic_cast<PosixStorage*>(where) == nullptr)
+        return false;
+
+    // Open and stat it together, the two do not depend on each other
+    struct io_uring_sqe* sqe_open = ring.get();
+    struct io_uring_sqe* sqe_stat = (sqe_open != nullptr)? ring.get() : nullptr;
+    if(sqe_stat == nullptr) {
+        // Out of room, fill the one we took with a no-op
+        if(sqe_open != nullptr)
+            sqe_open->opcode = IORING_OP_NOP;
+        return false;
+    }
+    sqe_open->opcode = IORING_OP_OPENAT;
+    sqe_open->fd = AT_FDCWD;
+    sqe_open->addr = (uint64_t)(uintptr_t)request->path.c_str();
+    sqe_open->open_flags = O_RDONLY | O_CLOEXEC;
+    sqe_open->user_data = (uint64_t)(uintptr_t)request | OP_OPEN;
+    sqe_stat->opcode = IORING_OP_STATX;
+    sqe_stat->fd = AT_FDCWD;
+    sqe_stat->addr = (uint64_t)(uintptr_t)request->path.c_str();
+    sqe_stat->len = STATX_SIZE;
+    sqe_stat->off = (uint64_t)(uintptr_t)&request->info;
+    sqe_stat->user_data = (uint64_t)(uintptr_t)request | OP_STATX;
+    request->owned = true;
+    request->pending = 2;
+    in_flight += 2;
+    return true;
+
+}
+
+
+/**
+ * Queues a read for the rest of the file
+ * Large files can come back short, so this is called until we have it all
+ */
+void BatchReader::next_read(request_t* request) {
+    if(!request->reading) {
+        request->buffer.resize((size_t)request->size);
+        request->reading = true;
+    }
+    if(request->done >= request->size) {
+        finish(request, false);
+        return;
+    }
+    struct io_uring_sqe* sqe = ring.get();
+    if(sqe == nullptr) {
+        finish(request, true);
+        return;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = request->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(request->buffer.data() + request->done);
+    sqe->len = (uint32_t)std::min<uint64_t>(request->size - request->done, 1u << 30);
+    sqe->off = request->offset + request->done;
+    sqe->user_data = (uint64_t)(uintptr_t)request | OP_READ;
+    request->pending++;
+    in_flight++;
+}
+
+
+/**
+ * Marks the request done and closes its file in the ring, nobody waits on the close
+ * If we are not caching, the file is dropped from the page cache first (reads in the ring are
+ * always buffered, since O_DIRECT would need aligned buffers)
+ */
+void BatchReader::finish(request_t* request, bool failed) {
+    request->finished = true;
+    request->failed = failed;
+    if(request->fd >= 0 && request->reading && storage->cache_mode() != CACHE_NORMAL)
+        posix_fadvise(request->fd, (off_t)request->offset, (off_t)request->size, POSIX_FADV_DONTNEED);
+    if(!request->owned || request->fd < 0)
+        return;
+    struct io_uring_sqe* sqe = ring.get();
+    if(sqe != nullptr) {
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = request->fd;
+        sqe->user_data = OP_CLOSE;
+    }
+    else {
+        close(request->fd);
+    }
+    request->fd = -1;
+}
+
+
+/**
+ * Handles completions, moving each file on to its next step
+ */
+void BatchReader::reap(bool wait) {
+
+    // Submit anything queued, waiting if asked
+    ring.submit(wait? 1 : 0);
+
+    // Handle all that are done
+    uint64_t user_data;
+    int res;
+    while(ring.pop(user_data, res)) {
+
+        // Closes have no request
+        uint64_t op = user_data & OP_MASK;
+        request_t* request = (request_t*)(uintptr_t)(user_data & ~OP_MASK);
+        if(op == OP_CLOSE || request == nullptr)
+            continue;
+        request->pending--;
+        in_flight--;
+
+        // Record the result
+        if(res < 0) {
+            request->failed = true;
+        }
+        else if(op == OP_OPEN) {
+            request->fd = res;
+            request->opened = true;
+        }
+        else if(op == OP_STATX) {
+            request->size = request->info.stx_size;
+            request->sized = true;
+        }
+        else if(op == OP_READ) {
+            request->done += (uint64_t)res;
+            if(res == 0 && request->done < request->size)
+                request->failed = true;
+        }
+
+        // Move on, but only once the open and stat have both landed
+        if(request->pending > 0 || request->finished)
+            continue;
+        if(request->failed || request->stale)
+            finish(request, request->failed);
+        else if(request->opened && request->sized)
+            next_read(request);
+        if(request->stale && request->pending == 0)
+            delete request;
+
+    }
+
+    // Submit the reads and closes we just queued
+    ring.submit(0);
+
+}
@@ -0,0 +1,120 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_BATCHREADER_H
+#define KITTI_PARSER_BATCHREADER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sys/stat.h>
+#include "kitti_parser/util/IoRing.h"
+#include "kitti_parser/util/MountStorage.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Reads the files we will need next in batches through io_uring
+     * Given the next files in replay order, the opens, sizes and reads of all of them are
+     * submitted with a single system call, and completions are collected while we decode.
+     * Reading a file then only waits if its buffer has not landed yet. Files in archives skip
+     * the open and are read straight from the container. Without io_uring every read goes to
+     * the storage as normal. Single threaded, only the thread fetching messages uses it.
+     */
+    class BatchReader {
+
+    public:
+
+        // Default constructor, keeps up to this many files in flight
+        BatchReader(MountStorage* storage, size_t depth);
+        ~BatchReader();
+
+        // True if reads are batched, false if we fell back to the storage
+        bool batched() const;
+
+        // Queue the files that will be read next, in order
+        // Anything queued before that is not in this list is dropped
+        void prefetch(const std::vector<std::string>& paths);
+
+        // Reads a whole file, waiting on its batched read if it has one
+        bool read(const std::string& path, std::vector<char>& out);
+
+    private:
+
+        // Single file being read
+        struct request_t {
+            std::string path;
+            int fd = -1;
+            bool owned = false;
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            uint64_t done = 0;
+            // Operations still in the ring
+            int pending = 0;
+            bool opened = false;
+            bool sized = false;
+            bool reading = false;
+            bool failed = false;
+            bool finished = false;
+            // No longer wanted, deleted once nothing is pending
+            bool stale = false;
+            struct statx info;
+            std::vector<char> buffer;
+        };
+
+        // Where files are read from
+        MountStorage* storage;
+
+        // Most files in flight
+        size_t depth;
+
+        // Our ring
+        IoRing ring;
+
+        // Operations in the ring that write into a request
+        size_t in_flight = 0;
+
+        // Requests by path
+        std::map<std::string, request_t*> requests;
+
+        // Start reading a new file
+        bool start(request_t* request);
+
+        // Queue the next read of a file, once it is open and we know its size
+        void next_read(request_t* request);
+
+        // Done with the file, hand back its descriptor
+        void finish(request_t* request, bool failed);
+
+        // Handle all completions, waiting for at least one if asked
+        void reap(bool wait);
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_BATCHREADER_H
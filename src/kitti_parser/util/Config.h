@@ -28,10 +28,19 @@
 #include <string>
 #include <iostream>
 #include <yaml-cpp/yaml.h>
+#include "kitti_parser/types/sensor_t.h"
+#include "kitti_parser/types/cache_mode_t.h"
 
 
 namespace kitti_parser {
 
+    // What a full stream queue does with a new message
+    typedef enum {
+        OVERFLOW_BLOCK = 0,
+        OVERFLOW_DROP_OLDEST = 1,
+        OVERFLOW_DROP_NEWEST = 2
+    } overflow_t;
+
     class Config {
 
     public:
@@ -55,6 +64,44 @@ namespace kitti_parser {
         bool has_calib_vc = false;
 
 
+        // Folder to cache decoded images in, disabled if empty
+        std::string path_image_cache;
+
+        // Share decoded frames with other parsers through the global frame cache
+        bool use_frame_cache = false;
+
+        // Number of messages the reader thread can load ahead of the callbacks
+        size_t prefetch_size = 16;
+
+        // Call each sensor's callback on its own thread
+        bool threaded_dispatch = false;
+
+        // How far (ms) a stream can get ahead of the others when threaded, negative for no limit
+        long max_stream_skew = 100;
+
+        // Queue size and overflow policy of each stream when threaded, indexed by sensor_t
+        size_t stream_queue_size[SENSOR_COUNT] = {16, 16, 16, 256};
+        overflow_t stream_overflow[SENSOR_COUNT] = {OVERFLOW_BLOCK, OVERFLOW_BLOCK, OVERFLOW_BLOCK, OVERFLOW_BLOCK};
+
+        // Seconds between printing the stats while running, zero to disable
+        double stats_interval = 0.0;
+
+        // Chrome trace file written after each run, disabled if empty
+        std::string path_trace;
+
+        // Number of upcoming files read in batches through io_uring, zero to disable
+        size_t io_batch_size = 0;
+
+        // Preintegrate the IMU between camera frames, and give it with each frame
+        bool preintegrate = false;
+
+        // How reads use the page cache, see cache_mode_t
+        cache_mode_t cache_mode = CACHE_NORMAL;
+
+        // Wall time (ms) of upcoming files hinted to the kernel, scaled by how fast we replay, zero to disable
+        long readahead_ms = 0;
+
+
         // Store the config data here
         YAML::Node calib_cc;
         YAML::Node calib_iv;
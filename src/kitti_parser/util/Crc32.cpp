@@ -0,0 +1,140 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "kitti_parser/util/Crc32.h"
+#include <cstring>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// Lookup tables, table[k][b] is the CRC of byte b followed by k zero bytes
+typedef struct {
+    uint32_t table[8][256];
+} crc_tables_t;
+
+static const crc_tables_t& tables() {
+    static const crc_tables_t t = []() {
+        crc_tables_t t;
+        for(uint32_t b=0; b<256; b++) {
+            uint32_t c = b;
+            for(int k=0; k<8; k++)
+                c = (c & 1)? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t.table[0][b] = c;
+        }
+        for(uint32_t b=0; b<256; b++) {
+            for(int k=1; k<8; k++)
+                t.table[k][b] = (t.table[k-1][b] >> 8) ^ t.table[0][t.table[k-1][b] & 0xFF];
+        }
+        return t;
+    }();
+    return t;
+}
+
+
+/**
+ * Slicing-by-8, reads the data eight bytes at a time (little endian)
+ */
+uint32_t Crc32::update(uint32_t crc, const void* data, size_t length) {
+
+    const crc_tables_t& t = tables();
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+
+    // Eight bytes at a time
+    while(length >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t.table[7][lo & 0xFF] ^ t.table[6][(lo >> 8) & 0xFF] ^ t.table[5][(lo >> 16) & 0xFF] ^ t.table[4][lo >> 24]
+              ^ t.table[3][hi & 0xFF] ^ t.table[2][(hi >> 8) & 0xFF] ^ t.table[1][(hi >> 16) & 0xFF] ^ t.table[0][hi >> 24];
+        p += 8;
+        length -= 8;
+    }
+
+    // Then the rest
+    while(length > 0) {
+        crc = t.table[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+        p++;
+        length--;
+    }
+    return ~crc;
+
+}
+
+
+// Multiply a vector by a matrix over GF(2)
+static uint32_t gf2_times(const uint32_t* mat, uint32_t vec) {
+    uint32_t sum = 0;
+    for(int i=0; vec != 0; i++, vec >>= 1) {
+        if(vec & 1)
+            sum ^= mat[i];
+    }
+    return sum;
+}
+
+static void gf2_square(uint32_t* square, const uint32_t* mat) {
+    for(int i=0; i<32; i++)
+        square[i] = gf2_times(mat, mat[i]);
+}
+
+
+/**
+ * Appends length2 zero bytes to the first CRC by squaring the one zero bit operator,
+ * then xors in the second, this is the same as zlib's crc32_combine()
+ */
+uint32_t Crc32::combine(uint32_t crc1, uint32_t crc2, uint64_t length2) {
+
+    if(length2 == 0)
+        return crc1;
+
+    // Operator for one zero bit, then two and four
+    uint32_t even[32], odd[32];
+    odd[0] = 0xEDB88320u;
+    uint32_t row = 1;
+    for(int i=1; i<32; i++) {
+        odd[i] = row;
+        row <<= 1;
+    }
+    gf2_square(even, odd);
+    gf2_square(odd, even);
+
+    // Apply the zeros, one bit of the length at a time
+    do {
+        gf2_square(even, odd);
+        if(length2 & 1)
+            crc1 = gf2_times(even, crc1);
+        length2 >>= 1;
+        if(length2 == 0)
+            break;
+        gf2_square(odd, even);
+        if(length2 & 1)
+            crc1 = gf2_times(odd, crc1);
+        length2 >>= 1;
+    } while(length2 != 0);
+    return crc1 ^ crc2;
+
+}
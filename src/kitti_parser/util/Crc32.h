@@ -0,0 +1,55 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_CRC32_H
+#define KITTI_PARSER_CRC32_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace kitti_parser {
+
+    /**
+     * CRC-32 as used by zip, png and mcap (reflected, polynomial 0xEDB88320)
+     * Eight bytes are done per step with eight tables (slicing-by-8), and the CRCs of two
+     * blocks can be combined, so large buffers can be summed in parts on different threads.
+     */
+    class Crc32 {
+
+    public:
+
+        // Continue a CRC with more data, start with zero
+        static uint32_t update(uint32_t crc, const void* data, size_t length);
+
+        // CRC of two blocks one after the other, given the CRC of each and the length of the second
+        static uint32_t combine(uint32_t crc1, uint32_t crc2, uint64_t length2);
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_CRC32_H
@@ -0,0 +1,162 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_FANOUT_H
+#define KITTI_PARSER_FANOUT_H
+
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <exception>
+#include <functional>
+#include "kitti_parser/util/Config.h"
+#include "kitti_parser/util/MpmcQueue.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * All subscribers of a single stream, which share one read only message
+     * Subscribers with a queue get their own thread, started on the first message, so a slow one
+     * only holds up the others if its queue is full and it blocks. The rest are called in order
+     * on the publishing thread. Only one thread should publish to a fanout.
+     */
+    template<typename T>
+    class Fanout {
+
+    public:
+
+        typedef std::function<void(Config*, long, std::shared_ptr<const T>)> callback_t;
+
+        Fanout() {}
+        Fanout(const Fanout&) = delete;
+        Fanout& operator=(const Fanout&) = delete;
+
+        // Waits for the threaded subscribers
+        ~Fanout() {
+            stop();
+        }
+
+        // Add a subscriber, a queue size of zero calls it on the publishing thread
+        void add(callback_t callback, size_t queue_size, overflow_t overflow) {
+            std::unique_ptr<subscriber_t> sub(new subscriber_t());
+            sub->callback = callback;
+            sub->queue_size = queue_size;
+            sub->overflow = overflow;
+            subscribers.push_back(std::move(sub));
+        }
+
+        // True if nobody subscribed
+        bool empty() const {
+            return subscribers.empty();
+        }
+
+        // Hand the message to every subscriber
+        void publish(Config* config, long timestamp, const std::shared_ptr<const T>& msg) {
+            for(size_t i=0; i<subscribers.size(); i++) {
+                subscriber_t* sub = subscribers.at(i).get();
+                if(sub->queue_size == 0) {
+                    sub->callback(config, timestamp, msg);
+                    continue;
+                }
+                if(!sub->worker.joinable())
+                    start(sub, config);
+                item_t item(timestamp, msg);
+                if(sub->overflow == OVERFLOW_DROP_NEWEST) {
+                    sub->queue->try_push(item);
+                } else if(sub->overflow == OVERFLOW_DROP_OLDEST) {
+                    item_t old;
+                    while(!sub->queue->try_push(item) && !sub->queue->closed())
+                        sub->queue->try_pop(old);
+                } else {
+                    sub->queue->push(item);
+                }
+            }
+        }
+
+        // Let the threaded subscribers finish what is queued, returns the first error one threw
+        std::exception_ptr stop() {
+            for(size_t i=0; i<subscribers.size(); i++) {
+                subscriber_t* sub = subscribers.at(i).get();
+                if(!sub->worker.joinable())
+                    continue;
+                sub->queue->close();
+                sub->worker.join();
+                sub->queue.reset();
+            }
+            std::exception_ptr err = error;
+            error = nullptr;
+            return err;
+        }
+
+    private:
+
+        // Message waiting for a threaded subscriber
+        typedef std::pair<long, std::shared_ptr<const T>> item_t;
+
+        // Single subscriber, and its queue and thread if it has its own
+        struct subscriber_t {
+            callback_t callback;
+            size_t queue_size;
+            overflow_t overflow;
+            std::unique_ptr<MpmcQueue<item_t>> queue;
+            std::thread worker;
+        };
+        std::vector<std::unique_ptr<subscriber_t>> subscribers;
+
+        // First error of a threaded subscriber, after that it only drains its queue
+        std::mutex error_mtx;
+        std::exception_ptr error;
+
+        // Start the thread of a subscriber
+        void start(subscriber_t* sub, Config* config) {
+            sub->queue.reset(new MpmcQueue<item_t>(sub->queue_size));
+            sub->worker = std::thread([this, sub, config]() {
+                item_t item;
+                bool failed = false;
+                while(sub->queue->pop(item)) {
+                    if(!failed) {
+                        try {
+                            sub->callback(config, item.first, std::move(item.second));
+                        } catch(...) {
+                            std::lock_guard<std::mutex> lock(error_mtx);
+                            if(!error)
+                                error = std::current_exception();
+                            failed = true;
+                        }
+                    }
+                    item.second.reset();
+                }
+            });
+        }
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_FANOUT_H
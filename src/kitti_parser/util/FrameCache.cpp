@@ -0,0 +1,156 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/FrameCache.h"
+
+using namespace std;
+using namespace kitti_parser;
+
+
+/**
+ * Returns the global cache, created on first use
+ */
+FrameCache& FrameCache::instance() {
+    static FrameCache cache;
+    return cache;
+}
+
+
+/**
+ * Sets the budget, and evicts from each shard if we are now over it
+ */
+void FrameCache::set_budget(size_t bytes) {
+    max_bytes = bytes;
+    for(size_t i=0; i<NUM_SHARDS; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].mtx);
+        evict(shards[i]);
+    }
+}
+
+
+size_t FrameCache::budget() {
+    return max_bytes;
+}
+
+
+/**
+ * Total bytes over all shards
+ */
+size_t FrameCache::size() {
+    size_t total = 0;
+    for(size_t i=0; i<NUM_SHARDS; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].mtx);
+        total += shards[i].bytes;
+    }
+    return total;
+}
+
+
+/**
+ * Drops all entries, frames that are still in use stay alive until released
+ */
+void FrameCache::clear() {
+    for(size_t i=0; i<NUM_SHARDS; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].mtx);
+        shards[i].lru.clear();
+        shards[i].table.clear();
+        shards[i].bytes = 0;
+    }
+}
+
+
+/**
+ * Looks up the frame, and moves it to the front of the LRU list
+ * On a miss we load it without holding the lock, and anybody else asking for it waits on us
+ */
+std::shared_ptr<const void> FrameCache::get_or_load_impl(sensor_t sensor, const std::string& path, const loader_t& load) {
+
+    // Just load it if we are disabled
+    if(max_bytes == 0)
+        return load().first;
+
+    // Find our shard
+    std::string key = std::to_string((int)sensor) + ":" + path;
+    shard_t& shard = shards[std::hash<std::string>()(key) & (NUM_SHARDS-1)];
+    std::unique_lock<std::mutex> lock(shard.mtx);
+
+    // Return if we have it
+    std::unordered_map<std::string, std::list<entry_t>::iterator>::iterator it = shard.table.find(key);
+    if(it != shard.table.end()) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return it->second->frame;
+    }
+
+    // Wait if someone else is loading it
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const void>>>::iterator itl = shard.loading.find(key);
+    if(itl != shard.loading.end()) {
+        std::shared_future<std::shared_ptr<const void>> future = itl->second;
+        lock.unlock();
+        return future.get();
+    }
+
+    // Else we load it, let others know
+    std::promise<std::shared_ptr<const void>> promise;
+    shard.loading.insert(std::make_pair(key, promise.get_future().share()));
+    lock.unlock();
+    std::pair<std::shared_ptr<const void>,size_t> loaded;
+    try {
+        loaded = load();
+    } catch(...) {
+        promise.set_exception(std::current_exception());
+        lock.lock();
+        shard.loading.erase(key);
+        throw;
+    }
+    promise.set_value(loaded.first);
+
+    // Insert it, skip frames that are larger than the whole shard
+    lock.lock();
+    shard.loading.erase(key);
+    if(loaded.second <= max_bytes/NUM_SHARDS) {
+        entry_t entry;
+        entry.key = key;
+        entry.frame = loaded.first;
+        entry.bytes = loaded.second;
+        shard.lru.push_front(entry);
+        shard.table[key] = shard.lru.begin();
+        shard.bytes += entry.bytes;
+        evict(shard);
+    }
+    return loaded.first;
+
+}
+
+
+/**
+ * Evicts the least recently used frames until we are in budget
+ */
+void FrameCache::evict(shard_t& shard) {
+    size_t limit = max_bytes/NUM_SHARDS;
+    while(shard.bytes > limit && !shard.lru.empty()) {
+        shard.bytes -= shard.lru.back().bytes;
+        shard.table.erase(shard.lru.back().key);
+        shard.lru.pop_back();
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_FRAMECACHE_H
+#define KITTI_PARSER_FRAMECACHE_H
+
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <future>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include "kitti_parser/types/sensor_t.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Process wide cache of decoded frames, shared by all parsers
+     * Frames are keyed by the sensor and their source file, which names the drive and frame index.
+     * Entries are reference counted, so an evicted frame stays alive until its last user lets go.
+     * The table is split into shards with their own lock and LRU list, each gets an equal part of the budget.
+     * If two parsers miss on the same frame at once, only the first decodes it and the other waits for it.
+     */
+    class FrameCache {
+
+    public:
+
+        // The global cache
+        static FrameCache& instance();
+
+        // Set the max number of bytes to keep, zero disables the cache
+        void set_budget(size_t bytes);
+
+        // Current budget and number of bytes cached
+        size_t budget();
+        size_t size();
+
+        // Remove everything
+        void clear();
+
+        // Return the cached frame, or load it with the function and cache it
+        template<typename T>
+        std::shared_ptr<const T> get_or_load(sensor_t sensor, const std::string& path, std::function<T*()> load,
+                                             std::function<size_t(const T*)> bytes) {
+            std::shared_ptr<const void> val = get_or_load_impl(sensor, path, [&]() {
+                T* frame = load();
+                return std::make_pair(std::shared_ptr<const void>(frame), bytes(frame));
+            });
+            return std::static_pointer_cast<const T>(val);
+        }
+
+    private:
+
+        // Only the global instance
+        FrameCache() {}
+        FrameCache(const FrameCache&) = delete;
+        FrameCache& operator=(const FrameCache&) = delete;
+
+        // Number of shards, power of two
+        static const size_t NUM_SHARDS = 16;
+
+        // Single cached frame
+        struct entry_t {
+            std::string key;
+            std::shared_ptr<const void> frame;
+            size_t bytes;
+        };
+
+        // Each shard has its own lock, lookup table, and LRU list (front is the newest)
+        struct shard_t {
+            std::mutex mtx;
+            std::list<entry_t> lru;
+            std::unordered_map<std::string, std::list<entry_t>::iterator> table;
+            std::unordered_map<std::string, std::shared_future<std::shared_ptr<const void>>> loading;
+            size_t bytes = 0;
+        };
+        shard_t shards[NUM_SHARDS];
+
+        // Max bytes, split evenly over the shards
+        std::atomic<size_t> max_bytes{0};
+
+        // Type erased lookup
+        typedef std::function<std::pair<std::shared_ptr<const void>,size_t>()> loader_t;
+        std::shared_ptr<const void> get_or_load_impl(sensor_t sensor, const std::string& path, const loader_t& load);
+
+        // Pop the oldest entries until the shard is in budget, lock must be held
+        void evict(shard_t& shard);
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_FRAMECACHE_H
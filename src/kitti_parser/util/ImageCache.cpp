@@ -0,0 +1,263 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/ImageCache.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// The header takes a full page so the frames are page aligned
+static const size_t HEADER_SIZE = 4096;
+static const char MAGIC[4] = {'K','I','C','1'};
+
+// Fields stored after the magic
+struct header_t {
+    int32_t count;
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    uint64_t frame_bytes;
+};
+
+
+/**
+ * Default constructor
+ * Will create the cache folder if it does not exist
+ */
+ImageCache::ImageCache(std::string path, counter_t counter) {
+    path_cache = path;
+    count_files = counter;
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(path_cache, ec);
+}
+
+
+/**
+ * Unmaps everything, and removes any cache files that did not get finished
+ */
+ImageCache::~ImageCache() {
+    for(std::map<std::string, camera_t*>::iterator it=cameras.begin(); it!=cameras.end(); ++it) {
+        camera_t* camera = it->second;
+        if(camera->data != nullptr) {
+            munmap(camera->data, camera->size);
+        }
+        if(camera->fd >= 0) {
+            close(camera->fd);
+            unlink(camera->path_temp.c_str());
+        }
+        delete camera;
+    }
+}
+
+
+/**
+ * Returns the image at the given path
+ * If the cache for the camera is complete this is a pointer into the mapping
+ * Otherwise we decode the image, and write it into the cache if we are building one
+ */
+cv::Mat ImageCache::load(const std::string& path_image, const std::function<cv::Mat()>& decode) {
+
+    // Images are in "drive/image_0x/data/0000000000.png", and the name is the frame number
+    boost::filesystem::path p(path_image);
+    int frame = -1;
+    try {
+        frame = std::stoi(p.stem().string());
+    } catch(...) {
+        return decode();
+    }
+    camera_t* camera = get_camera(p.parent_path().parent_path().string());
+
+    // Return from the mapping if we can
+    if(camera->data != nullptr && frame >= 0 && frame < camera->count) {
+        return cv::Mat(camera->rows, camera->cols, camera->type, camera->data + HEADER_SIZE + frame*camera->frame_bytes);
+    }
+
+    // Else decode as normal, and store it
+    cv::Mat image = decode();
+    if(!camera->disabled && camera->fd >= 0) {
+        store(camera, frame, image);
+    }
+    return image;
+
+}
+
+
+/**
+ * Gets the cache for the given camera folder
+ * The first time we see a camera we try to map its cache, else we start building one
+ */
+ImageCache::camera_t* ImageCache::get_camera(const std::string& path_camera) {
+
+    // Return if we already have it
+    std::map<std::string, camera_t*>::iterator it = cameras.find(path_camera);
+    if(it != cameras.end())
+        return it->second;
+
+    // Name the cache file after the drive and camera
+    boost::filesystem::path p(path_camera);
+    camera_t* camera = new camera_t;
+    camera->path_cache = path_cache + "/" + p.parent_path().filename().string() + "_" + p.filename().string() + ".raw";
+    cameras.insert(std::make_pair(path_camera, camera));
+
+    // Done if the cache is already built
+    if(map_camera(camera))
+        return camera;
+
+    // Count the frames we need to fill
+    camera->count = (int)count_files((p / "data").string());
+
+    // Create the file we will write into, unique so other caches and processes can build at the same time
+    if(camera->count > 0) {
+        std::vector<char> name(camera->path_cache.begin(), camera->path_cache.end());
+        const char suffix[] = ".tmp.XXXXXX";
+        name.insert(name.end(), suffix, suffix + sizeof(suffix));
+        camera->fd = mkstemp(name.data());
+        if(camera->fd >= 0) {
+            camera->path_temp = name.data();
+            fchmod(camera->fd, 0644);
+        }
+    }
+    if(camera->fd < 0) {
+        camera->disabled = true;
+        return camera;
+    }
+    camera->written.resize((size_t)camera->count, false);
+    return camera;
+
+}
+
+
+/**
+ * Maps a finished cache file
+ * Will return false if it does not exist or is not valid
+ */
+bool ImageCache::map_camera(camera_t* camera) {
+
+    // Open and check the size
+    int fd = open(camera->path_cache.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    char magic[4];
+    header_t header;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < HEADER_SIZE
+       || pread(fd, magic, 4, 0) != 4 || memcmp(magic, MAGIC, 4) != 0
+       || pread(fd, &header, sizeof(header), 4) != (ssize_t)sizeof(header)
+       || (size_t)st.st_size != HEADER_SIZE + header.count*header.frame_bytes) {
+        close(fd);
+        return false;
+    }
+
+    // Private mapping so any writes to the images are copy-on-write
+    void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return false;
+
+    // Done
+    camera->data = (unsigned char*)data;
+    camera->size = (size_t)st.st_size;
+    camera->count = header.count;
+    camera->rows = header.rows;
+    camera->cols = header.cols;
+    camera->type = header.type;
+    camera->frame_bytes = header.frame_bytes;
+    return true;
+
+}
+
+
+/**
+ * Writes the frame into its slot in the cache we are building
+ * Once all frames are written we move the file into place and map it
+ */
+void ImageCache::store(camera_t* camera, int frame, const cv::Mat& image) {
+
+    // Skip frames that do not match the folder
+    if(frame < 0 || frame >= camera->count || camera->written.at((size_t)frame))
+        return;
+
+    // The first frame sets the size, all the others need to match it
+    bool valid = !image.empty();
+    if(valid && camera->num_written == 0) {
+        camera->rows = image.rows;
+        camera->cols = image.cols;
+        camera->type = image.type();
+        camera->frame_bytes = image.total()*image.elemSize();
+        valid = (ftruncate(camera->fd, (off_t)(HEADER_SIZE + camera->count*camera->frame_bytes)) == 0);
+    } else if(valid) {
+        valid = (image.rows == camera->rows && image.cols == camera->cols && image.type() == camera->type);
+    }
+
+    // Write each row into the slot
+    size_t row_bytes = camera->cols*image.elemSize();
+    off_t offset = (off_t)(HEADER_SIZE + frame*camera->frame_bytes);
+    for(int r=0; valid && r<image.rows; r++) {
+        valid = (pwrite(camera->fd, image.ptr(r), row_bytes, offset + r*row_bytes) == (ssize_t)row_bytes);
+    }
+
+    // Give up on this camera if anything failed
+    const std::string& path_temp = camera->path_temp;
+    if(!valid) {
+        std::cerr << "[kitti_parser]: Unable to cache " << camera->path_cache << std::endl;
+        close(camera->fd);
+        unlink(path_temp.c_str());
+        camera->fd = -1;
+        camera->disabled = true;
+        return;
+    }
+    camera->written.at((size_t)frame) = true;
+    camera->num_written++;
+
+    // If that was the last one, write the header and move it into place
+    if(camera->num_written == camera->count) {
+        header_t header;
+        header.count = camera->count;
+        header.rows = camera->rows;
+        header.cols = camera->cols;
+        header.type = camera->type;
+        header.frame_bytes = camera->frame_bytes;
+        bool success = (pwrite(camera->fd, MAGIC, 4, 0) == 4)
+                       && (pwrite(camera->fd, &header, sizeof(header), 4) == (ssize_t)sizeof(header));
+        close(camera->fd);
+        camera->fd = -1;
+        if(!success || rename(path_temp.c_str(), camera->path_cache.c_str()) != 0) {
+            unlink(path_temp.c_str());
+            camera->disabled = true;
+            return;
+        }
+        map_camera(camera);
+    }
+
+}
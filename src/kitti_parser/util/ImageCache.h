@@ -0,0 +1,108 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_IMAGECACHE_H
+#define KITTI_PARSER_IMAGECACHE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <functional>
+#include <opencv2/core/core.hpp>
+
+
+namespace kitti_parser {
+
+    /**
+     * Cache of decoded images, one memory mapped file per drive and camera
+     * The first replay decodes the PNGs as normal and writes the raw pixels into the cache.
+     * Once every frame of a camera has been written, later reads are a cv::Mat header on the mapping.
+     * The mapping is private copy-on-write, so callbacks can still modify the images they get.
+     * Images returned from the cache point into the mapping, so they must not outlive this cache.
+     */
+    class ImageCache {
+
+    public:
+
+        // Counts the files in a folder, so we know how many frames a camera has
+        typedef std::function<size_t(const std::string&)> counter_t;
+
+        // Default constructor, path is the folder to store the cache files in
+        ImageCache(std::string path_cache, counter_t count_files);
+
+        // Unmaps and closes all cache files
+        ~ImageCache();
+
+        // Returns the image, from the cache if we have it, otherwise it is decoded and stored
+        cv::Mat load(const std::string& path_image, const std::function<cv::Mat()>& decode);
+
+    private:
+
+        // State of a single drive and camera
+        struct camera_t {
+            // Raw file we are building, or the final one once mapped
+            std::string path_cache;
+            int fd = -1;
+            // Unique file we write into, moved to path_cache once complete
+            std::string path_temp;
+            // Size of the frames
+            int count = 0;
+            int rows = 0;
+            int cols = 0;
+            int type = 0;
+            size_t frame_bytes = 0;
+            // Frames written so far, we are done when this hits the count
+            std::vector<bool> written;
+            int num_written = 0;
+            // The mapping once the cache is complete
+            unsigned char* data = nullptr;
+            size_t size = 0;
+            // If something went wrong, then just decode as normal
+            bool disabled = false;
+        };
+
+        // Folder the cache files go in
+        std::string path_cache;
+
+        // How we count the frames of a camera
+        counter_t count_files;
+
+        // All the cameras we have seen, keyed by the camera folder
+        std::map<std::string, camera_t*> cameras;
+
+        // Opens the cache of the camera the image belongs to
+        camera_t* get_camera(const std::string& path_camera);
+
+        // Try to map a finished cache file
+        bool map_camera(camera_t* camera);
+
+        // Writes a decoded frame into the cache we are building
+        void store(camera_t* camera, int frame, const cv::Mat& image);
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_IMAGECACHE_H
@@ -0,0 +1,173 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/IoRing.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+/**
+ * Creates the ring and maps the shared queues
+ * See the io_uring_setup(2) man page for the layout
+ */
+IoRing::IoRing(unsigned entries) {
+
+    // Create the ring
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if(fd < 0)
+        return;
+
+    // Map the submission and completion rings, newer kernels put them in one mapping
+    sq_size = params.sq_off.array + params.sq_entries*sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries*sizeof(struct io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(single && cq_size > sq_size)
+        sq_size = cq_size;
+    sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(sq_ptr == MAP_FAILED) {
+        sq_ptr = nullptr;
+        close(fd);
+        fd = -1;
+        return;
+    }
+    cq_ptr = sq_ptr;
+    if(!single) {
+        cq_ptr = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if(cq_ptr == MAP_FAILED) {
+            cq_ptr = nullptr;
+            munmap(sq_ptr, sq_size);
+            sq_ptr = nullptr;
+            close(fd);
+            fd = -1;
+            return;
+        }
+    }
+
+    // Map the submission entries themselves
+    sqes_size = params.sq_entries*sizeof(struct io_uring_sqe);
+    void* ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(ptr == MAP_FAILED) {
+        if(cq_ptr != sq_ptr)
+            munmap(cq_ptr, cq_size);
+        munmap(sq_ptr, sq_size);
+        sq_ptr = cq_ptr = nullptr;
+        close(fd);
+        fd = -1;
+        return;
+    }
+    sqes = (struct io_uring_sqe*)ptr;
+
+    // Pointers into the rings
+    char* sq = (char*)sq_ptr;
+    sq_head = (unsigned*)(sq + params.sq_off.head);
+    sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    sq_array = (unsigned*)(sq + params.sq_off.array);
+    sq_entries = params.sq_entries;
+    sqe_tail = *sq_tail;
+    char* cq = (char*)cq_ptr;
+    cq_head = (unsigned*)(cq + params.cq_off.head);
+    cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+}
+
+
+IoRing::~IoRing() {
+    if(sqes != nullptr)
+        munmap(sqes, sqes_size);
+    if(cq_ptr != nullptr && cq_ptr != sq_ptr)
+        munmap(cq_ptr, cq_size);
+    if(sq_ptr != nullptr)
+        munmap(sq_ptr, sq_size);
+    if(fd >= 0)
+        close(fd);
+}
+
+
+bool IoRing::valid() const {
+    return fd >= 0;
+}
+
+
+/**
+ * Takes the next submission slot
+ * The kernel moves the head as it consumes entries, so we are full if we are a ring ahead of it
+ */
+struct io_uring_sqe* IoRing::get() {
+    if(fd < 0)
+        return nullptr;
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if(sqe_tail - head >= sq_entries)
+        return nullptr;
+    unsigned index = sqe_tail & *sq_mask;
+    struct io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[index] = index;
+    sqe_tail++;
+    return sqe;
+}
+
+
+/**
+ * Publishes the new tail, then enters the kernel once for all of them
+ */
+int IoRing::submit(unsigned wait) {
+    if(fd < 0)
+        return -EINVAL;
+    unsigned count = sqe_tail - *sq_tail;
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+    if(count == 0 && wait == 0)
+        return 0;
+    while(true) {
+        long res = syscall(__NR_io_uring_enter, fd, count, wait, (wait > 0)? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if(res >= 0)
+            return (int)res;
+        if(errno != EINTR)
+            return -errno;
+    }
+}
+
+
+bool IoRing::pop(uint64_t& user_data, int& res) {
+    if(fd < 0)
+        return false;
+    unsigned head = *cq_head;
+    if(head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+        return false;
+    const struct io_uring_cqe* cqe = &cqes[head & *cq_mask];
+    user_data = cqe->user_data;
+    res = cqe->res;
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
@@ -0,0 +1,94 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_IORING_H
+#define KITTI_PARSER_IORING_H
+
+#include <cstdint>
+#include <cstddef>
+#include <linux/io_uring.h>
+
+
+namespace kitti_parser {
+
+    /**
+     * Minimal io_uring, straight on top of the system calls
+     * We only need to queue entries, submit them in one call and pop completions, so this is
+     * small enough to not pull in liburing. Single threaded, the owner does all of the calls.
+     * If the kernel does not have io_uring (or it is blocked) the ring is not valid.
+     */
+    class IoRing {
+
+    public:
+
+        // Default constructor, sets up a ring with room for this many entries
+        IoRing(unsigned entries);
+        ~IoRing();
+
+        // True if the ring was set up
+        bool valid() const;
+
+        // Next free submission entry, cleared, null if the ring is full
+        struct io_uring_sqe* get();
+
+        // Submits everything queued, and waits for at least this many completions
+        // Returns the number submitted, or -errno
+        int submit(unsigned wait = 0);
+
+        // Pops a completion, false if there are none
+        bool pop(uint64_t& user_data, int& res);
+
+    private:
+
+        // Ring file
+        int fd = -1;
+
+        // Submission ring
+        void* sq_ptr = nullptr;
+        size_t sq_size = 0;
+        unsigned* sq_head = nullptr;
+        unsigned* sq_tail = nullptr;
+        unsigned* sq_mask = nullptr;
+        unsigned* sq_array = nullptr;
+        unsigned sq_entries = 0;
+        struct io_uring_sqe* sqes = nullptr;
+        size_t sqes_size = 0;
+
+        // Entries we have filled in but not handed to the kernel yet
+        unsigned sqe_tail = 0;
+
+        // Completion ring, can share the mapping of the submission ring
+        void* cq_ptr = nullptr;
+        size_t cq_size = 0;
+        unsigned* cq_head = nullptr;
+        unsigned* cq_tail = nullptr;
+        unsigned* cq_mask = nullptr;
+        struct io_uring_cqe* cqes = nullptr;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_IORING_H
@@ -0,0 +1,430 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "kitti_parser/util/LcmPublisher.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <endian.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+const std::string LcmPublisher::DEFAULT_URL = "udpm://239.255.76.67:7667?ttl=0";
+const std::string LcmPublisher::CHANNEL_STEREO_GRAY = "KITTI_STEREO_GRAY";
+const std::string LcmPublisher::CHANNEL_STEREO_COLOR = "KITTI_STEREO_COLOR";
+const std::string LcmPublisher::CHANNEL_LIDAR = "KITTI_LIDAR";
+const std::string LcmPublisher::CHANNEL_GPSIMU = "KITTI_GPSIMU";
+
+// Packet headers of lcm_udpm, "LC02" for a whole message and "LC03" for a fragment
+static const uint32_t MAGIC_SHORT = 0x4c433032;
+static const uint32_t MAGIC_LONG = 0x4c433033;
+static const size_t HEADER_SHORT = 8;
+static const size_t HEADER_LONG = 20;
+static const size_t SHORT_MESSAGE_MAX = 65499;
+static const size_t FRAGMENT_MAX = 65423;
+
+// Most datagrams handed to the kernel in one call
+static const size_t SEND_BATCH = 64;
+
+
+// Big endian writers, which is how LCM encodes everything
+static char* put_u8(char* p, uint8_t v) {
+    *p = (char)v;
+    return p + 1;
+}
+
+static char* put_u16(char* p, uint16_t v) {
+    v = htobe16(v);
+    memcpy(p, &v, 2);
+    return p + 2;
+}
+
+static char* put_u32(char* p, uint32_t v) {
+    v = htobe32(v);
+    memcpy(p, &v, 4);
+    return p + 4;
+}
+
+static char* put_u64(char* p, uint64_t v) {
+    v = htobe64(v);
+    memcpy(p, &v, 8);
+    return p + 8;
+}
+
+static char* put_double(char* p, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, 8);
+    return put_u64(p, bits);
+}
+
+
+/**
+ * Fingerprint of an LCM type, the same as lcm-gen computes from the .lcm file
+ * Member names, primitive types and array sizes are hashed, the type name is not.
+ */
+typedef struct {
+    const char* name;
+    const char* type;
+    const char* size;
+} lcm_member_t;
+
+static int64_t hash_update(int64_t v, char c) {
+    return (int64_t)((((uint64_t)v << 8) ^ (uint64_t)(v >> 55)) + (uint64_t)(int64_t)c);
+}
+
+static int64_t hash_string(int64_t v, const char* s) {
+    v = hash_update(v, (char)strlen(s));
+    for(; *s != '\0'; s++)
+        v = hash_update(v, *s);
+    return v;
+}
+
+static uint64_t fingerprint(const lcm_member_t* members, size_t count) {
+    int64_t v = 0x12345678;
+    for(size_t i=0; i<count; i++) {
+        v = hash_string(v, members[i].name);
+        v = hash_string(v, members[i].type);
+        // Our arrays all have one dimension, sized by an earlier member
+        v = hash_update(v, (members[i].size != nullptr)? 1 : 0);
+        if(members[i].size != nullptr) {
+            v = hash_update(v, 1);
+            v = hash_string(v, members[i].size);
+        }
+    }
+    uint64_t hash = (uint64_t)v;
+    return (hash << 1) + ((hash >> 63) & 1);
+}
+
+static const lcm_member_t TYPE_STEREO[] = {
+    {"timestamp", "int64_t", nullptr}, {"is_color", "boolean", nullptr},
+    {"width", "int32_t", nullptr}, {"height", "int32_t", nullptr},
+    {"channels", "int32_t", nullptr}, {"row_stride", "int32_t", nullptr},
+    {"size_left", "int32_t", nullptr}, {"left", "byte", "size_left"},
+    {"size_right", "int32_t", nullptr}, {"right", "byte", "size_right"},
+};
+
+static const lcm_member_t TYPE_LIDAR[] = {
+    {"timestamp", "int64_t", nullptr}, {"timestamp_start", "int64_t", nullptr},
+    {"timestamp_end", "int64_t", nullptr}, {"num_points", "int32_t", nullptr},
+    {"size", "int32_t", nullptr}, {"points", "byte", "size"},
+};
+
+static const lcm_member_t TYPE_GPSIMU[] = {
+    {"timestamp", "int64_t", nullptr},
+    {"lat", "double", nullptr}, {"lon", "double", nullptr}, {"alt", "double", nullptr},
+    {"roll", "double", nullptr}, {"pitch", "double", nullptr}, {"yaw", "double", nullptr},
+    {"vn", "double", nullptr}, {"ve", "double", nullptr}, {"vf", "double", nullptr},
+    {"vl", "double", nullptr}, {"vu", "double", nullptr},
+    {"ax", "double", nullptr}, {"ay", "double", nullptr}, {"az", "double", nullptr},
+    {"af", "double", nullptr}, {"al", "double", nullptr}, {"au", "double", nullptr},
+    {"wx", "double", nullptr}, {"wy", "double", nullptr}, {"wz", "double", nullptr},
+    {"wf", "double", nullptr}, {"wl", "double", nullptr}, {"wu", "double", nullptr},
+    {"pos_accuracy", "double", nullptr}, {"vel_accuracy", "double", nullptr},
+    {"navstat", "int32_t", nullptr}, {"numsats", "int32_t", nullptr},
+    {"posmode", "int32_t", nullptr}, {"velmode", "int32_t", nullptr}, {"orimode", "int32_t", nullptr},
+};
+
+
+/**
+ * Parses the url and opens a multicast socket for it
+ * Only the address, port and ttl options are used
+ */
+LcmPublisher::LcmPublisher(std::string url) {
+
+    // Split udpm://address:port?options
+    const std::string scheme = "udpm://";
+    if(url.compare(0, scheme.size(), scheme) != 0) {
+        cerr << "[kitti_parser]: Only udpm:// LCM urls are supported, not " << url << endl;
+        return;
+    }
+    std::string rest = url.substr(scheme.size());
+    std::string options;
+    size_t query = rest.find('?');
+    if(query != std::string::npos) {
+        options = rest.substr(query + 1);
+        rest = rest.substr(0, query);
+    }
+    size_t colon = rest.find(':');
+    std::string address = rest.substr(0, colon);
+    int port = (colon != std::string::npos)? atoi(rest.substr(colon + 1).c_str()) : 7667;
+    int ttl = 0;
+    size_t opt = options.find("ttl=");
+    if(opt != std::string::npos)
+        ttl = atoi(options.c_str() + opt + 4);
+
+    // Where we send to
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons((uint16_t)port);
+    if(inet_pton(AF_INET, address.c_str(), &dest.sin_addr) != 1) {
+        cerr << "[kitti_parser]: Invalid LCM address " << address << endl;
+        return;
+    }
+
+    // Multicast socket, connected so each datagram does not need the address
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd < 0) {
+        cerr << "[kitti_parser]: Unable to open LCM socket (" << strerror(errno) << ")" << endl;
+        return;
+    }
+    unsigned char ttl_byte = (unsigned char)ttl;
+    unsigned char loop = 1;
+    int sndbuf = 4 << 20;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl_byte, sizeof(ttl_byte));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    if(connect(fd, (struct sockaddr*)&dest, sizeof(dest)) != 0) {
+        cerr << "[kitti_parser]: Unable to connect LCM socket to " << url << " (" << strerror(errno) << ")" << endl;
+        close(fd);
+        fd = -1;
+    }
+
+}
+
+
+LcmPublisher::~LcmPublisher() {
+    if(fd >= 0)
+        close(fd);
+}
+
+
+bool LcmPublisher::valid() const {
+    return fd >= 0;
+}
+
+
+/**
+ * Splits the message into datagrams and sends them
+ * Small messages are one LC02 datagram with the channel and payload. Large ones are LC03 fragments,
+ * where the first also carries the channel. Each fragment points at its slice of the parts.
+ */
+bool LcmPublisher::send(const std::string& channel, const std::vector<struct iovec>& parts) {
+
+    if(fd < 0)
+        return false;
+
+    // Total size
+    size_t size = 0;
+    for(size_t i=0; i<parts.size(); i++)
+        size += parts.at(i).iov_len;
+    size_t channel_size = channel.size() + 1;
+    uint32_t seq = seqno++;
+    struct iovec name;
+    name.iov_base = (void*)channel.c_str();
+    name.iov_len = channel_size;
+
+    // Number of datagrams, the first fragment has less room since the channel is in it
+    size_t first = FRAGMENT_MAX - channel_size;
+    bool is_short = size + channel_size + HEADER_SHORT < SHORT_MESSAGE_MAX;
+    size_t count = (is_short)? 1 : 1 + (size - first + FRAGMENT_MAX - 1)/FRAGMENT_MAX;
+    if(count > 65535) {
+        cerr << "[kitti_parser]: Message of " << size << " bytes is too large for LCM" << endl;
+        return false;
+    }
+
+    // Build each datagram, the iovecs are collected first since the vector can grow
+    headers.resize(count*HEADER_LONG);
+    iovs.clear();
+    iov_start.clear();
+    size_t part = 0, part_offset = 0, offset = 0;
+    for(size_t f=0; f<count; f++) {
+        iov_start.push_back(iovs.size());
+        char* head = headers.data() + f*HEADER_LONG;
+        struct iovec header;
+        header.iov_base = head;
+        if(is_short) {
+            put_u32(put_u32(head, MAGIC_SHORT), seq);
+            header.iov_len = HEADER_SHORT;
+        } else {
+            char* p = put_u32(head, MAGIC_LONG);
+            p = put_u32(p, seq);
+            p = put_u32(p, (uint32_t)size);
+            p = put_u32(p, (uint32_t)offset);
+            p = put_u16(p, (uint16_t)f);
+            put_u16(p, (uint16_t)count);
+            header.iov_len = HEADER_LONG;
+        }
+        iovs.push_back(header);
+        if(f == 0)
+            iovs.push_back(name);
+        // Slices of the parts that go in this datagram
+        size_t room = (is_short)? size : (f == 0)? first : FRAGMENT_MAX;
+        while(room > 0 && part < parts.size()) {
+            size_t len = std::min(room, parts.at(part).iov_len - part_offset);
+            if(len > 0) {
+                struct iovec slice;
+                slice.iov_base = (char*)parts.at(part).iov_base + part_offset;
+                slice.iov_len = len;
+                iovs.push_back(slice);
+            }
+            room -= len;
+            offset += len;
+            part_offset += len;
+            if(part_offset == parts.at(part).iov_len) {
+                part++;
+                part_offset = 0;
+            }
+        }
+    }
+    iov_start.push_back(iovs.size());
+
+    // Point the messages at their iovecs
+    msgs.resize(count);
+    for(size_t f=0; f<count; f++) {
+        memset(&msgs.at(f), 0, sizeof(struct mmsghdr));
+        msgs.at(f).msg_hdr.msg_iov = &iovs.at(iov_start.at(f));
+        msgs.at(f).msg_hdr.msg_iovlen = iov_start.at(f + 1) - iov_start.at(f);
+    }
+
+    // Send them in batches
+    size_t sent = 0;
+    while(sent < count) {
+        int n = sendmmsg(fd, &msgs.at(sent), (unsigned)std::min(count - sent, SEND_BATCH), 0);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0) {
+            cerr << "[kitti_parser]: Unable to send on " << channel << " (" << strerror(errno) << ")" << endl;
+            return false;
+        }
+        sent += (size_t)n;
+    }
+    return true;
+
+}
+
+
+/**
+ * Stereo frames are the fixed fields, then the rows of each image straight from the frame
+ */
+bool LcmPublisher::publish(const stereo_t& frame) {
+
+    static const uint64_t hash = fingerprint(TYPE_STEREO, sizeof(TYPE_STEREO)/sizeof(lcm_member_t));
+    const cv::Mat& left = frame.image_left;
+    const cv::Mat& right = frame.image_right;
+
+    // Fixed fields up to the size of the left image
+    char head[64];
+    char* p = put_u64(head, hash);
+    p = put_u64(p, (uint64_t)frame.timestamp);
+    p = put_u8(p, frame.is_color? 1 : 0);
+    p = put_u32(p, (uint32_t)frame.width);
+    p = put_u32(p, (uint32_t)frame.height);
+    p = put_u32(p, (uint32_t)left.channels());
+    p = put_u32(p, (uint32_t)(left.cols*left.elemSize()));
+    p = put_u32(p, (uint32_t)(left.total()*left.elemSize()));
+    char mid[4];
+    put_u32(mid, (uint32_t)(right.total()*right.elemSize()));
+
+    // Rows of each image, a single part if it is continuous
+    std::vector<struct iovec> parts;
+    struct iovec part;
+    part.iov_base = head;
+    part.iov_len = (size_t)(p - head);
+    parts.push_back(part);
+    const cv::Mat* images[2] = {&left, &right};
+    for(int i=0; i<2; i++) {
+        const cv::Mat& image = *images[i];
+        size_t row = image.cols*image.elemSize();
+        if(image.isContinuous() && image.rows > 0) {
+            part.iov_base = (void*)image.ptr(0);
+            part.iov_len = row*image.rows;
+            parts.push_back(part);
+        } else {
+            for(int r=0; r<image.rows; r++) {
+                part.iov_base = (void*)image.ptr(r);
+                part.iov_len = row;
+                parts.push_back(part);
+            }
+        }
+        if(i == 0) {
+            part.iov_base = mid;
+            part.iov_len = sizeof(mid);
+            parts.push_back(part);
+        }
+    }
+    return send(frame.is_color? CHANNEL_STEREO_COLOR : CHANNEL_STEREO_GRAY, parts);
+
+}
+
+
+/**
+ * Lidar scans are the fixed fields, then the points as they are in memory, which is little endian
+ */
+bool LcmPublisher::publish(const lidar_t& scan) {
+
+    static const uint64_t hash = fingerprint(TYPE_LIDAR, sizeof(TYPE_LIDAR)/sizeof(lcm_member_t));
+    size_t bytes = scan.points.size()*sizeof(std::array<float,4>);
+
+    // Fixed fields
+    char head[48];
+    char* p = put_u64(head, hash);
+    p = put_u64(p, (uint64_t)scan.timestamp);
+    p = put_u64(p, (uint64_t)scan.timestamp_start);
+    p = put_u64(p, (uint64_t)scan.timestamp_end);
+    p = put_u32(p, (uint32_t)scan.points.size());
+    p = put_u32(p, (uint32_t)bytes);
+
+    // Then the points
+    std::vector<struct iovec> parts(2);
+    parts.at(0).iov_base = head;
+    parts.at(0).iov_len = (size_t)(p - head);
+    parts.at(1).iov_base = (void*)scan.points.data();
+    parts.at(1).iov_len = bytes;
+    return send(CHANNEL_LIDAR, parts);
+
+}
+
+
+bool LcmPublisher::publish(const gpsimu_t& meas) {
+
+    static const uint64_t hash = fingerprint(TYPE_GPSIMU, sizeof(TYPE_GPSIMU)/sizeof(lcm_member_t));
+
+    // Everything is small, so just encode it
+    const double values[25] = {meas.lat, meas.lon, meas.alt, meas.roll, meas.pitch, meas.yaw,
+                               meas.vn, meas.ve, meas.vf, meas.vl, meas.vu,
+                               meas.ax, meas.ay, meas.az, meas.af, meas.al, meas.au,
+                               meas.wx, meas.wy, meas.wz, meas.wf, meas.wl, meas.wu,
+                               meas.pos_accuracy, meas.vel_accuracy};
+    const int ints[5] = {meas.navstat, meas.numsats, meas.posmode, meas.velmode, meas.orimode};
+    char buf[256];
+    char* p = put_u64(buf, hash);
+    p = put_u64(p, (uint64_t)meas.timestamp);
+    for(size_t i=0; i<25; i++)
+        p = put_double(p, values[i]);
+    for(size_t i=0; i<5; i++)
+        p = put_u32(p, (uint32_t)ints[i]);
+
+    std::vector<struct iovec> parts(1);
+    parts.at(0).iov_base = buf;
+    parts.at(0).iov_len = (size_t)(p - buf);
+    return send(CHANNEL_GPSIMU, parts);
+
+}
@@ -0,0 +1,99 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_LCMPUBLISHER_H
+#define KITTI_PARSER_LCMPUBLISHER_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "kitti_parser/types/stereo_t.h"
+#include "kitti_parser/types/lidar_t.h"
+#include "kitti_parser/types/gpsimu_t.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Publishes measurements over UDP multicast in the LCM wire format, so LCM subscribers can read them
+     * The types are in the lcmtypes folder. Only the fixed fields are encoded into a small buffer,
+     * the pixels and points are sent straight from the loaded measurement through iovecs.
+     * Messages too large for one datagram are split into LCM fragments, sent together with sendmmsg.
+     */
+    class LcmPublisher {
+
+    public:
+
+        // Default LCM url, ttl=0 keeps everything on this host
+        static const std::string DEFAULT_URL;
+
+        // Channels of each stream
+        static const std::string CHANNEL_STEREO_GRAY;
+        static const std::string CHANNEL_STEREO_COLOR;
+        static const std::string CHANNEL_LIDAR;
+        static const std::string CHANNEL_GPSIMU;
+
+        // Open a socket for the url, like udpm://239.255.76.67:7667?ttl=0
+        explicit LcmPublisher(std::string url = DEFAULT_URL);
+        ~LcmPublisher();
+
+        LcmPublisher(const LcmPublisher&) = delete;
+        LcmPublisher& operator=(const LcmPublisher&) = delete;
+
+        // True if the socket is open
+        bool valid() const;
+
+        // Encode and send a measurement on the channel of its stream
+        bool publish(const stereo_t& frame);
+        bool publish(const lidar_t& scan);
+        bool publish(const gpsimu_t& meas);
+
+        // Send an encoded message, given as parts that are sent in order without being copied
+        bool send(const std::string& channel, const std::vector<struct iovec>& parts);
+
+    private:
+
+        int fd = -1;
+        struct sockaddr_in dest;
+
+        // Sequence number of the next message
+        uint32_t seqno = 0;
+
+        // Reused for each message, so sending does not allocate once warmed up
+        std::vector<struct mmsghdr> msgs;
+        std::vector<struct iovec> iovs;
+        std::vector<size_t> iov_start;
+        std::vector<char> headers;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_LCMPUBLISHER_H
@@ -0,0 +1,235 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/LidarArchive.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+const std::string LidarArchive::EXTENSION = ".kla";
+constexpr float LidarArchive::DEFAULT_RESOLUTION;
+
+
+// Size of the header: magic, number of points, resolution, coordinate stream size
+static const size_t HEADER_SIZE = 16;
+static const char MAGIC[4] = {'K','L','A','1'};
+
+// Clamp quantized values so the deltas never overflow an int32
+static const int64_t QUANT_LIMIT = (1 << 30) - 1;
+
+
+/**
+ * Write a varint (LEB128) to the buffer, returns the new position
+ */
+static inline uint8_t* write_varint(uint8_t* p, uint32_t v) {
+    while(v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+/**
+ * Read a varint (LEB128) from the buffer, returns false if we run past the end
+ * The single byte case is by far the most common, so it is checked first
+ */
+static inline bool read_varint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    if(p < end && *p < 0x80) {
+        v = *p++;
+        return true;
+    }
+    v = 0;
+    for(int shift=0; shift<35; shift+=7) {
+        if(p >= end)
+            return false;
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if(b < 0x80)
+            return true;
+    }
+    return false;
+}
+
+
+/**
+ * Encodes a raw KITTI point array (x,y,z,r floats) into our compressed format
+ * Layout is the header, the interleaved x,y,z varint deltas, and then one reflectance byte per point
+ */
+void LidarArchive::encode(const float* data, size_t num_points, float resolution, std::vector<uint8_t>& out) {
+
+    // Worst case is a five byte varint for each coordinate
+    out.resize(HEADER_SIZE + num_points*(3*5+1));
+    uint8_t* start = out.data() + HEADER_SIZE;
+    uint8_t* p = start;
+
+    // Delta code each coordinate against the previous point
+    float scale = 1.0f/resolution;
+    int32_t prev[3] = {0,0,0};
+    for(size_t i=0; i<num_points; i++) {
+        for(size_t k=0; k<3; k++) {
+            int64_t q = (int64_t)llroundf(data[4*i+k]*scale);
+            q = std::max(-QUANT_LIMIT, std::min(QUANT_LIMIT, q));
+            int32_t delta = (int32_t)q - prev[k];
+            prev[k] = (int32_t)q;
+            // Zigzag so small negative values stay small
+            p = write_varint(p, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+        }
+    }
+    uint32_t coord_bytes = (uint32_t)(p - start);
+
+    // Reflectance is in [0,1], store as a byte
+    for(size_t i=0; i<num_points; i++) {
+        float r = std::max(0.0f, std::min(1.0f, data[4*i+3]));
+        *p++ = (uint8_t)lroundf(r*255.0f);
+    }
+
+    // Finally the header
+    uint32_t num = (uint32_t)num_points;
+    memcpy(out.data(), MAGIC, 4);
+    memcpy(out.data()+4, &num, 4);
+    memcpy(out.data()+8, &resolution, 4);
+    memcpy(out.data()+12, &coord_bytes, 4);
+    out.resize((size_t)(p - out.data()));
+
+}
+
+
+/**
+ * Decodes a compressed buffer straight into the point vector
+ * Will return false if the buffer is not a valid archive
+ */
+bool LidarArchive::decode(const uint8_t* data, size_t size, std::vector<std::array<float,4>>& points) {
+
+    // Check the header
+    if(size < HEADER_SIZE || memcmp(data, MAGIC, 4) != 0)
+        return false;
+    uint32_t num, coord_bytes;
+    float resolution;
+    memcpy(&num, data+4, 4);
+    memcpy(&resolution, data+8, 4);
+    memcpy(&coord_bytes, data+12, 4);
+    if(HEADER_SIZE + (size_t)coord_bytes + num != size)
+        return false;
+
+    // Our streams
+    const uint8_t* p = data + HEADER_SIZE;
+    const uint8_t* end = p + coord_bytes;
+    const uint8_t* pr = end;
+
+    // Undo the deltas, using unsigned math so corrupt files can't overflow
+    points.resize(num);
+    const float scale_r = 1.0f/255.0f;
+    uint32_t acc[3] = {0,0,0};
+    for(uint32_t i=0; i<num; i++) {
+        std::array<float,4>& pt = points[i];
+        for(size_t k=0; k<3; k++) {
+            uint32_t zz;
+            if(!read_varint(p, end, zz))
+                return false;
+            acc[k] += (zz >> 1) ^ (0u - (zz & 1));
+            pt[k] = (float)(int32_t)acc[k]*resolution;
+        }
+        pt[3] = (float)pr[i]*scale_r;
+    }
+    return (p == end);
+
+}
+
+
+/**
+ * Compresses a single raw velodyne file
+ */
+bool LidarArchive::write(std::string path_bin, std::string path_archive, float resolution) {
+
+    // Read the whole raw file
+    FILE* stream = fopen(path_bin.c_str(), "rb");
+    if(stream == nullptr)
+        return false;
+    fseek(stream, 0, SEEK_END);
+    long size = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+    std::vector<float> data((size_t)std::max(0L, size)/sizeof(float));
+    size_t num = fread(data.data(), sizeof(float), data.size(), stream)/4;
+    fclose(stream);
+
+    // Encode it
+    std::vector<uint8_t> buffer;
+    encode(data.data(), num, resolution, buffer);
+
+    // Write to a temp file first, so a partial write is never picked up by the loader
+    std::string path_temp = path_archive + ".tmp";
+    stream = fopen(path_temp.c_str(), "wb");
+    if(stream == nullptr)
+        return false;
+    bool success = (fwrite(buffer.data(), 1, buffer.size(), stream) == buffer.size());
+    success = (fclose(stream) == 0) && success;
+    if(!success || rename(path_temp.c_str(), path_archive.c_str()) != 0) {
+        remove(path_temp.c_str());
+        return false;
+    }
+    return true;
+
+}
+
+
+/**
+ * Compresses every .bin in the folder into a .kla next to it
+ * The loader will use the compressed ones if they exist
+ */
+int LidarArchive::write_folder(std::string path_folder, bool remove_raw, float resolution) {
+
+    // Get all files in the folder
+    boost::filesystem::path p(path_folder);
+    if(!boost::filesystem::is_directory(p))
+        return 0;
+    vector<boost::filesystem::path> v;
+    copy(boost::filesystem::directory_iterator(p), boost::filesystem::directory_iterator(), back_inserter(v));
+    sort(v.begin(), v.end());
+
+    // Convert each raw file
+    int count = 0;
+    for (vector<boost::filesystem::path>::const_iterator it(v.begin()), it_end(v.end()); it != it_end; ++it) {
+        if((*it).extension() != ".bin")
+            continue;
+        boost::filesystem::path out = *it;
+        out.replace_extension(EXTENSION);
+        if(!write((*it).string(), out.string(), resolution)) {
+            std::cerr << "[kitti_parser]: Unable to compress " << (*it).string() << std::endl;
+            continue;
+        }
+        if(remove_raw)
+            boost::filesystem::remove(*it);
+        count++;
+    }
+    return count;
+
+}
@@ -0,0 +1,70 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_LIDARARCHIVE_H
+#define KITTI_PARSER_LIDARARCHIVE_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+namespace kitti_parser {
+
+    /**
+     * Compressed storage for velodyne scans (.kla files)
+     * Coordinates are quantized to a fixed resolution and reflectance to 8 bits.
+     * Each coordinate is stored as a zigzag varint delta to the previous point,
+     * which is small since the raw files are already in beam order.
+     * The decoder is a single pass over the buffer so it is bound by memory speed.
+     */
+    class LidarArchive {
+
+    public:
+
+        // File extension of compressed scans
+        static const std::string EXTENSION;
+
+        // Default quantization of the coordinates (meters)
+        static constexpr float DEFAULT_RESOLUTION = 0.001f;
+
+        // Encode a raw x,y,z,r float array into a compressed buffer
+        static void encode(const float* data, size_t num_points, float resolution, std::vector<uint8_t>& out);
+
+        // Decode a compressed buffer, returns false if it is corrupt
+        static bool decode(const uint8_t* data, size_t size, std::vector<std::array<float,4>>& points);
+
+        // Convert a raw velodyne .bin file into a compressed one
+        static bool write(std::string path_bin, std::string path_archive, float resolution = DEFAULT_RESOLUTION);
+
+        // Compress all scans in a velodyne_points/data/ folder, returns the number converted
+        static int write_folder(std::string path_folder, bool remove_raw, float resolution = DEFAULT_RESOLUTION);
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_LIDARARCHIVE_H
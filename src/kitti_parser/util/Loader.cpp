@@ -24,6 +24,7 @@
 
 #include "kitti_parser/util/Loader.h"
 #include <fstream>
+#include <cstring>
 #include <sstream>
 #include <boost/date_time.hpp>
 #include <kitti_parser/types/stereo_t.h>
@@ -34,16 +35,48 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem.hpp>
 #include <kitti_parser/types/gpsimu_t.h>
+#include "kitti_parser/util/LidarArchive.h"
+#include "kitti_parser/util/FrameCache.h"
+#include "kitti_parser/util/PackedDrive.h"
+#include "kitti_parser/util/TarStorage.h"
+#include "kitti_parser/util/ZipStorage.h"
 
 using namespace std;
 using namespace kitti_parser;
 
+
+// Number of upcoming files hinted when dropping files from the page cache
+static const size_t HINT_FILES = 8;
+
+// Limits of the readahead window, in files and dataset ms
+static const size_t READAHEAD_MAX_FILES = 512;
+static const double READAHEAD_MIN_MS = 10.0;
+static const double READAHEAD_MAX_MS = 60000.0;
+
+// Free lidar scans kept for reuse, once subscribers let go of them
+static const size_t LIDAR_POOL_SIZE = 16;
+
+// Wall time (ms) between updates of the consumption rate
+static const double RATE_SAMPLE_MS = 50.0;
+
 /**
  * Default constructor for the loader
  * Just saves the config file information
  */
-Loader::Loader(Config* conf) {
+Loader::Loader(Config* conf, Stats* st) {
     config = conf;
+    stats = st;
+    pool_lidar = std::make_shared<Pool<lidar_t>>(LIDAR_POOL_SIZE);
+}
+
+
+/**
+ * The batched reads go first since they read from our storage
+ * Shared scans still out there keep the pool alive on their own
+ */
+Loader::~Loader() {
+    delete batch_reader;
+    delete image_cache;
 }
 
 
@@ -114,13 +147,84 @@ void Loader::load_all(std::string path) {
 }
 
 
+/**
+ * Mounts a packed drive, tar or zip archive at its own path
+ * So "drive.kpack/image_00/data/" will list the images in it
+ */
+bool Loader::mount(std::string path_archive) {
+
+    // Already done
+    if(storage.mounted(path_archive))
+        return true;
+
+    // Pick the storage from the extension
+    boost::filesystem::path p(path_archive);
+    ArchiveStorage* archive = nullptr;
+    if(p.extension() == PackedDrive::EXTENSION)
+        archive = new PackedDrive(path_archive);
+    else if(p.extension() == TarStorage::EXTENSION)
+        archive = new TarStorage(path_archive);
+    else if(p.extension() == ZipStorage::EXTENSION)
+        archive = new ZipStorage(path_archive);
+    else
+        return false;
+
+    // Only keep it if it opened
+    if(!archive->valid()) {
+        std::cerr << "[kitti_parser]: Unable to open " << path_archive << std::endl;
+        delete archive;
+        return false;
+    }
+    storage.mount(path_archive, archive);
+    return true;
+
+}
+
+
+/**
+ * Checks if the file or folder exists
+ */
+bool Loader::exists(const std::string& path) {
+    return storage.exists(path);
+}
+
+
+bool Loader::read(const std::string& path, std::vector<char>& out) {
+    return storage.read_all(path, out);
+}
+
+
+/**
+ * Reads a whole file, waiting on its batched read if it was queued
+ */
+bool Loader::read_file(const std::string& path, std::vector<char>& out) {
+    if(batch_reader != nullptr)
+        return batch_reader->read(path, out);
+    return storage.read_all(path, out);
+}
+
+
+/**
+ * Lists a folder, as full paths
+ */
+std::vector<std::string> Loader::list_folder(const std::string& path) {
+    std::vector<std::string> names = storage.list(path);
+    for(size_t i=0; i<names.size(); i++)
+        names.at(i) = Storage::join(path, names.at(i));
+    return names;
+}
+
+
 /**
  * Loads a timestamp file based on the path given
  */
 void Loader::load_timestamps(std::string path_timestamp, std::vector<long>& time, int& ct) {
+    Stats::Timer timer(stats, STAGE_LOAD_TIMESTAMPS);
     // Open the timestamp file
-    std:string line;
-    ifstream file_time(path_timestamp);
+    std::string line;
+    std::vector<char> buffer;
+    storage.read_all(path_timestamp, buffer);
+    std::istringstream file_time(std::string(buffer.begin(), buffer.end()));
     // Load the timestamps
     while(getline(file_time,line)) {
         // Skip empty lines
@@ -138,8 +242,6 @@ void Loader::load_timestamps(std::string path_timestamp, std::vector<long>& time
         // Debug
         //cout << line << " => " << temp << endl;
     }
-    // Close file
-    file_time.close();
 }
 
 
@@ -153,30 +255,13 @@ void Loader::load_stereo(std::string path_left, std::string path_right, std::vec
     // Load the timestamps for this type
     int count = 0;
     load_timestamps(path_left+"timestamps.txt", time, count);
+    Stats::Timer timer(stats, STAGE_SCAN_FOLDERS);
 
-    // Loop through all sub folders, assume they are sequential
-    // http://www.boost.org/doc/libs/1_47_0/libs/filesystem/v3/example/tut4.cpp
-    boost::filesystem::path p1(path_left+"data/");
-    vector<boost::filesystem::path> v1;
-    copy(boost::filesystem::directory_iterator(p1), boost::filesystem::directory_iterator(), back_inserter(v1));
-    sort(v1.begin(), v1.end());
-
-    // Append them
-    for (vector<boost::filesystem::path>::const_iterator it(v1.begin()), it_end(v1.end()); it != it_end; ++it) {
-        pathL.push_back((*it).c_str());
-    }
-
-    // Loop through all sub folders, assume they are sequential
-    // http://www.boost.org/doc/libs/1_47_0/libs/filesystem/v3/example/tut4.cpp
-    boost::filesystem::path p2(path_right+"data/");
-    vector<boost::filesystem::path> v2;
-    copy(boost::filesystem::directory_iterator(p2), boost::filesystem::directory_iterator(), back_inserter(v2));
-    sort(v2.begin(), v2.end());
-
-    // Append them
-    for (vector<boost::filesystem::path>::const_iterator it(v2.begin()), it_end(v2.end()); it != it_end; ++it) {
-        pathR.push_back((*it).c_str());
-    }
+    // Get all files in the data folders, assume they are sequential
+    std::vector<std::string> v1 = list_folder(path_left+"data/");
+    pathL.insert(pathL.end(), v1.begin(), v1.end());
+    std::vector<std::string> v2 = list_folder(path_right+"data/");
+    pathR.insert(pathR.end(), v2.begin(), v2.end());
 
 }
 
@@ -196,21 +281,27 @@ void Loader::load_lidar(std::string path_lidar,
     load_timestamps(path_lidar+"timestamps.txt", time_avg, count_a);
     load_timestamps(path_lidar+"timestamps_start.txt", time_start, count_s);
     load_timestamps(path_lidar+"timestamps_end.txt", time_end, count_e);
+    Stats::Timer timer(stats, STAGE_SCAN_FOLDERS);
 
 
-    // Loop through all sub folders, assume they are sequential
-    // http://www.boost.org/doc/libs/1_47_0/libs/filesystem/v3/example/tut4.cpp
-    boost::filesystem::path p(path_lidar+"data/");
-    vector<boost::filesystem::path> v;
-    copy(boost::filesystem::directory_iterator(p), boost::filesystem::directory_iterator(), back_inserter(v));
+    // Get all files in the data folder, assume they are sequential
+    std::vector<std::string> v = list_folder(path_lidar+"data/");
 
-    // Sort, since directory iteration
-    // Is not ordered on some file systems
-    sort(v.begin(), v.end());
-
-    // Append them
-    for (vector<boost::filesystem::path>::const_iterator it(v.begin()), it_end(v.end()); it != it_end; ++it) {
-        pathB.push_back((*it).c_str());
+    // Pick one file per scan, the compressed one if it exists, so the list lines up with the timestamps
+    // Anything else, such as a temp file left by a failed compression, is not a scan
+    std::map<std::string,size_t> index;
+    for (vector<std::string>::const_iterator it(v.begin()), it_end(v.end()); it != it_end; ++it) {
+        boost::filesystem::path p(*it);
+        if(p.extension() != ".bin" && p.extension() != LidarArchive::EXTENSION)
+            continue;
+        std::string stem = (p.parent_path() / p.stem()).string();
+        std::map<std::string,size_t>::const_iterator found = index.find(stem);
+        if(found == index.end()) {
+            index[stem] = pathB.size();
+            pathB.push_back(*it);
+        } else if(p.extension() == LidarArchive::EXTENSION) {
+            pathB.at(found->second) = *it;
+        }
     }
 }
 
@@ -224,94 +315,332 @@ void Loader::load_gpsimu(std::string path_gpsimu, std::vector<long>& time, std::
     int count = 0;
     load_timestamps(path_gpsimu+"timestamps.txt", time, count);
 
-    // Loop through all sub folders, assume they are sequential
-    // http://www.boost.org/doc/libs/1_47_0/libs/filesystem/v3/example/tut4.cpp
-    boost::filesystem::path p1(path_gpsimu+"data/");
-    vector<boost::filesystem::path> v1;
-    copy(boost::filesystem::directory_iterator(p1), boost::filesystem::directory_iterator(), back_inserter(v1));
-    sort(v1.begin(), v1.end());
+    // Get all files in the data folder, assume they are sequential
+    std::vector<std::string> v1;
+    {
+        Stats::Timer timer(stats, STAGE_SCAN_FOLDERS);
+        v1 = list_folder(path_gpsimu+"data/");
+    }
 
-    // Append them
-    for (vector<boost::filesystem::path>::const_iterator it(v1.begin()), it_end(v1.end()); it != it_end; ++it) {
-        path.push_back((*it).c_str());
+    // Parse all records now, they are small and this saves reading them while replaying
+    // Records that fail are dropped with their timestamp, so the table, paths and times stay aligned
+    Stats::Timer timer(stats, STAGE_LOAD_OXTS);
+    size_t first = table_gpsimu.size();
+    std::vector<char> buffer;
+    double values[OxtsTable::FIELD_COUNT];
+    for(size_t i=0; i<v1.size(); i++) {
+        size_t idx = path.size();
+        if(idx >= time.size()) {
+            std::cerr << "[kitti_parser]: No timestamp for " << v1.at(i) << std::endl;
+            break;
+        }
+        if(!storage.read_all(v1.at(i), buffer) || !OxtsTable::parse(buffer.data(), buffer.size(), values)) {
+            std::cerr << "[kitti_parser]: Unable to parse " << v1.at(i) << std::endl;
+            time.erase(time.begin() + idx);
+            continue;
+        }
+        table_gpsimu.append(time.at(idx), values);
+        path.push_back(v1.at(i));
+        timer.bytes += buffer.size();
     }
-}
+    time.resize(path.size());
 
+    // Poses of this drive
+    poses_gpsimu.add_drive(table_gpsimu, first, table_gpsimu.size());
 
+}
 
-Loader::message_types* Loader::fetch_latest() {
 
-    // Return value
-    message_types* next;
 
+/**
+ * Finds the stream with the oldest measurement
+ * Ties go to the stereo gray, then stereo color, then lidar
+ */
+int Loader::next_stream(long sg, long sc, long lidar, long gps) const {
 
     // Compare stereo timestamps
-    if((curr_sg < curr_sc || !config->has_stereo_color)
-       && (curr_sg < curr_lidar || !config->has_lidar)
-       && (curr_sg < curr_gps || !config->has_gpsimu) && curr_sg != LONG_MAX) {
-        // Get the next measurement
-        next = new message_types(fetch_stereo(idx_sg, false));
-        // Move time forward
-        idx_sg++;
-        curr_sg = (idx_sg == time_stereo_gray.size())? LONG_MAX : time_stereo_gray.at(idx_sg);
-        return next;
+    if((sg < sc || !config->has_stereo_color)
+       && (sg < lidar || !config->has_lidar)
+       && (sg < gps || !config->has_gpsimu) && sg != LONG_MAX) {
+        return SENSOR_STEREO_GRAY;
     }
     // See about colored stereo timetamp
-    else if((curr_sc < curr_lidar || !config->has_lidar)
-            && (curr_sc < curr_gps || !config->has_gpsimu) && curr_sc != LONG_MAX) {
-        // Get the next measurement
-        next = new message_types(fetch_stereo(idx_sc, true));
-        // Move time forward
-        idx_sc++;
-        curr_sc = (idx_sc == time_stereo_color.size())? LONG_MAX : time_stereo_color.at(idx_sc);
-        return next;
+    else if((sc < lidar || !config->has_lidar)
+            && (sc < gps || !config->has_gpsimu) && sc != LONG_MAX) {
+        return SENSOR_STEREO_COLOR;
     }
     // See if LIDAR vs GPS is better
-    else if((curr_lidar < curr_gps || !config->has_gpsimu) && curr_lidar != LONG_MAX) {
-        // Get next measurement
-        next = new message_types(fetch_lidar(idx_lidar));
-        // Move time forward
-        idx_lidar++;
-        curr_lidar = (idx_lidar == time_lidar_avg.size())? LONG_MAX : time_lidar_avg.at(idx_lidar);
-        return next;
+    else if((lidar < gps || !config->has_gpsimu) && lidar != LONG_MAX) {
+        return SENSOR_LIDAR;
     }
     // See if GPS/IMU measurement is there
-    else if(curr_gps != LONG_MAX) {
-        // Get next measurement
-        next = new message_types(fetch_gpsimu(idx_gps));
-        // Move time forward
-        idx_gps++;
-        curr_gps = (idx_gps == time_gpsimu.size())? LONG_MAX : time_gpsimu.at(idx_gps);
-        return next;
+    else if(gps != LONG_MAX) {
+        return SENSOR_GPSIMU;
     }
 
     // Default, we have no measurment to give
-    return nullptr;
+    return -1;
+
+}
+
+
+Loader::message_types* Loader::fetch_latest() {
+
+    // Use the page cache as asked, this can change between runs
+    if(storage.cache_mode() != config->cache_mode)
+        storage.set_cache_mode(config->cache_mode);
+
+    // Have the kernel read the next files ahead, over the next window of wall time
+    // The window is turned into dataset time with how fast we have been going
+    long cursor = std::min(std::min(curr_sg, curr_sc), std::min(curr_lidar, curr_gps));
+    if(config->readahead_ms > 0 && cursor != LONG_MAX) {
+        update_rate(cursor);
+        double window = std::max(READAHEAD_MIN_MS, std::min(READAHEAD_MAX_MS, config->readahead_ms*readahead_rate));
+        hint_ahead(READAHEAD_MAX_FILES, cursor + (long)window);
+    }
+    // When dropping files from the page cache, at least hint the next few
+    else if(config->cache_mode == CACHE_DROP && config->io_batch_size == 0) {
+        hint_ahead(HINT_FILES);
+    }
+
+    // Queue the reads of what comes after this one
+    if(config->io_batch_size > 0) {
+        if(batch_reader == nullptr)
+            batch_reader = new BatchReader(&storage, config->io_batch_size);
+        if(batch_reader->batched()) {
+            std::vector<std::string> paths;
+            schedule(config->io_batch_size, paths);
+            batch_reader->prefetch(paths);
+        }
+    }
+
+    // Return value
+    message_types* next;
+
+    // Get the oldest measurement, and move its stream forward
+    switch(next_stream(curr_sg, curr_sc, curr_lidar, curr_gps)) {
+        case SENSOR_STEREO_GRAY:
+            next = new message_types(fetch_stereo(idx_sg, false));
+            idx_sg++;
+            curr_sg = (idx_sg == time_stereo_gray.size())? LONG_MAX : time_stereo_gray.at(idx_sg);
+            return next;
+        case SENSOR_STEREO_COLOR:
+            next = new message_types(fetch_stereo(idx_sc, true));
+            idx_sc++;
+            curr_sc = (idx_sc == time_stereo_color.size())? LONG_MAX : time_stereo_color.at(idx_sc);
+            return next;
+        case SENSOR_LIDAR:
+            next = new message_types(fetch_lidar(idx_lidar));
+            idx_lidar++;
+            curr_lidar = (idx_lidar == time_lidar_avg.size())? LONG_MAX : time_lidar_avg.at(idx_lidar);
+            return next;
+        case SENSOR_GPSIMU:
+            next = new message_types(fetch_gpsimu(idx_gps));
+            idx_gps++;
+            curr_gps = (idx_gps == time_gpsimu.size())? LONG_MAX : time_gpsimu.at(idx_gps);
+            return next;
+        default:
+            return nullptr;
+    }
 
 }
 
 
+/**
+ * Hints the next files that have not been hinted yet
+ * The last one we hinted is still in the schedule unless we passed it, or the window shrank
+ */
+void Loader::hint_ahead(size_t count, long until) {
+
+    // Files coming up
+    std::vector<std::string> paths;
+    std::vector<long> times;
+    schedule(count, paths, until, &times);
+
+    // Start after the last one we hinted
+    size_t start = 0;
+    for(size_t i=0; i<paths.size(); i++) {
+        if(paths.at(i) == last_hint)
+            start = i + 1;
+    }
+    if(start == 0 && last_hint_time > until)
+        return;
+
+    // Hint the rest
+    for(size_t i=start; i<paths.size(); i++)
+        storage.will_need(paths.at(i));
+    if(start < paths.size()) {
+        last_hint = paths.back();
+        last_hint_time = times.back();
+    }
+
+}
+
+
+/**
+ * Measures how much dataset time we get through per wall time
+ * Samples are smoothed so a single slow callback does not collapse the window
+ */
+void Loader::update_rate(long timestamp) {
+
+    // Start over on the first call, or when we jump back to an earlier drive
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(rate_timestamp < 0 || timestamp < rate_timestamp) {
+        rate_timestamp = timestamp;
+        rate_wall = now;
+        return;
+    }
+
+    // Wait until we have a long enough sample
+    double wall = std::chrono::duration<double, std::milli>(now - rate_wall).count();
+    if(wall < RATE_SAMPLE_MS)
+        return;
+
+    // Smooth it into the rate
+    double rate = (double)(timestamp - rate_timestamp)/wall;
+    readahead_rate = 0.8*readahead_rate + 0.2*rate;
+    rate_timestamp = timestamp;
+    rate_wall = now;
+
+}
+
+
+/**
+ * Walks the merge forward from the current position without fetching anything
+ * Images are skipped when the image cache is enabled, since it does not read them once built
+ */
+void Loader::schedule(size_t count, std::vector<std::string>& paths, long until, std::vector<long>* times) const {
+    long sg = curr_sg, sc = curr_sc, lidar = curr_lidar, gps = curr_gps;
+    size_t i_sg = idx_sg, i_sc = idx_sc, i_lidar = idx_lidar, i_gps = idx_gps;
+    bool images = config->path_image_cache.empty();
+    paths.clear();
+    if(times != nullptr)
+        times->clear();
+    while(paths.size() < count) {
+        long time = std::min(std::min(sg, sc), std::min(lidar, gps));
+        if(time > until)
+            return;
+        switch(next_stream(sg, sc, lidar, gps)) {
+            case SENSOR_STEREO_GRAY:
+                if(images) {
+                    paths.push_back(path_stereo_gray_L.at(i_sg));
+                    paths.push_back(path_stereo_gray_R.at(i_sg));
+                }
+                i_sg++;
+                sg = (i_sg == time_stereo_gray.size())? LONG_MAX : time_stereo_gray.at(i_sg);
+                break;
+            case SENSOR_STEREO_COLOR:
+                if(images) {
+                    paths.push_back(path_stereo_color_L.at(i_sc));
+                    paths.push_back(path_stereo_color_R.at(i_sc));
+                }
+                i_sc++;
+                sc = (i_sc == time_stereo_color.size())? LONG_MAX : time_stereo_color.at(i_sc);
+                break;
+            case SENSOR_LIDAR:
+                paths.push_back(path_lidar.at(i_lidar));
+                i_lidar++;
+                lidar = (i_lidar == time_lidar_avg.size())? LONG_MAX : time_lidar_avg.at(i_lidar);
+                break;
+            case SENSOR_GPSIMU:
+                // Records are parsed when loading, so there is no file to read
+                i_gps++;
+                gps = (i_gps == time_gpsimu.size())? LONG_MAX : time_gpsimu.at(i_gps);
+                break;
+            default:
+                return;
+        }
+        if(times != nullptr)
+            times->resize(paths.size(), time);
+    }
+}
+
+
 
 /**
  * This gets both colored and gray scaled stere images
- * It loads both images and timestamp into the stereo_t data type
+ * If the frame cache is enabled we copy the shared frame, cloning the images so the caller can change them
  */
 stereo_t* Loader::fetch_stereo(size_t idx, bool is_color) {
 
+    // Decode if not shared
+    Stats::Timer timer(stats, STAGE_FETCH_STEREO);
+    timer.timestamp = (is_color)? time_stereo_color.at(idx) : time_stereo_gray.at(idx);
+    if(!config->use_frame_cache) {
+        stereo_t* next = decode_stereo(idx, is_color);
+        timer.bytes = next->image_left.total()*next->image_left.elemSize()
+                      + next->image_right.total()*next->image_right.elemSize();
+        preintegrate(next, idx, is_color);
+        return next;
+    }
+
+    // Else get it from the cache
+    std::shared_ptr<const stereo_t> frame = FrameCache::instance().get_or_load<stereo_t>(
+            (is_color)? SENSOR_STEREO_COLOR : SENSOR_STEREO_GRAY,
+            (is_color)? path_stereo_color_L.at(idx) : path_stereo_gray_L.at(idx),
+            [&]() {
+                // Images from the image cache are views into its mapping, which goes away with this loader
+                stereo_t* loaded = decode_stereo(idx, is_color);
+                if(!config->path_image_cache.empty()) {
+                    loaded->image_left = loaded->image_left.clone();
+                    loaded->image_right = loaded->image_right.clone();
+                }
+                return loaded;
+            },
+            [](const stereo_t* s) { return s->image_left.total()*s->image_left.elemSize()
+                                           + s->image_right.total()*s->image_right.elemSize(); });
+    timer.bytes = frame->image_left.total()*frame->image_left.elemSize()
+                  + frame->image_right.total()*frame->image_right.elemSize();
+    stereo_t* next = copy(*frame);
+    preintegrate(next, idx, is_color);
+    return next;
+
+}
+
+
+/**
+ * Preintegrates the OXTS samples from the previous frame of this camera up to this one
+ * Nothing is added for the first frame of a drive
+ */
+void Loader::preintegrate(stereo_t* frame, size_t idx, bool is_color) {
+
+    // Only if enabled, and there is a previous frame
+    frame->has_imu = false;
+    if(!config->preintegrate || idx == 0)
+        return;
+
+    // Both frames need to be in the same drive
+    const std::vector<long>& time = (is_color)? time_stereo_color : time_stereo_gray;
+    size_t begin0, end0, begin1, end1;
+    if(!poses_gpsimu.drive_range(time.at(idx-1), begin0, end0)
+       || !poses_gpsimu.drive_range(time.at(idx), begin1, end1) || begin0 != begin1)
+        return;
+    frame->has_imu = preintegrator.integrate(table_gpsimu, begin1, end1, time.at(idx-1), time.at(idx), frame->imu);
+
+}
+
+
+/**
+ * This decodes both colored and gray scaled stere images
+ * It loads both images and timestamp into the stereo_t data type
+ */
+stereo_t* Loader::decode_stereo(size_t idx, bool is_color) {
+
     stereo_t* next = new stereo_t;
+    next->has_imu = false;
 
     if(is_color) {
         next->is_color = true;
         next->timestamp = time_stereo_color.at(idx);
-        next->image_left = cv::imread(path_stereo_color_L.at(idx), CV_LOAD_IMAGE_COLOR);
-        next->image_right = cv::imread(path_stereo_color_R.at(idx), CV_LOAD_IMAGE_COLOR);
+        next->image_left = read_image(path_stereo_color_L.at(idx), CV_LOAD_IMAGE_COLOR);
+        next->image_right = read_image(path_stereo_color_R.at(idx), CV_LOAD_IMAGE_COLOR);
         next->width = next->image_left.cols;
         next->height = next->image_left.rows;
     } else {
         next->is_color = false;
         next->timestamp = time_stereo_gray.at(idx);
-        next->image_left = cv::imread(path_stereo_gray_L.at(idx), CV_LOAD_IMAGE_GRAYSCALE);
-        next->image_right = cv::imread(path_stereo_gray_R.at(idx), CV_LOAD_IMAGE_GRAYSCALE);
+        next->image_left = read_image(path_stereo_gray_L.at(idx), CV_LOAD_IMAGE_GRAYSCALE);
+        next->image_right = read_image(path_stereo_gray_R.at(idx), CV_LOAD_IMAGE_GRAYSCALE);
         next->width = next->image_left.cols;
         next->height = next->image_left.rows;
     }
@@ -324,44 +653,148 @@ stereo_t* Loader::fetch_stereo(size_t idx, bool is_color) {
 
 
 
+/**
+ * Reads a single image from disk
+ * If the image cache is enabled this goes through it, which skips the decode once the cache is built
+ */
+cv::Mat Loader::read_image(const std::string& path, int flags) {
+
+    // Time the read and decode
+    Stats::Timer timer(stats, STAGE_DECODE_IMAGE);
+
+    // Normal decode if not enabled
+    if(config->path_image_cache.empty())
+        return decode_image(path, flags);
+
+    // Create the cache the first time, it counts the frames of a camera through us
+    if(image_cache == nullptr) {
+        image_cache = new ImageCache(config->path_image_cache, [this](const std::string& folder) {
+            return list_folder(folder).size();
+        });
+    }
+    return image_cache->load(path, [&]() { return decode_image(path, flags); });
+
+}
+
+
+/**
+ * Decodes a single image
+ * The file is read through the storage in one go, and decoded from memory
+ */
+cv::Mat Loader::decode_image(const std::string& path, int flags) {
+    std::vector<char> buffer;
+    if(!read_file(path, buffer))
+        return cv::Mat();
+    return cv::imdecode(buffer, flags);
+}
+
+
+
+/**
+ * This gets a velodyne scan, through the frame cache if enabled
+ */
+lidar_t* Loader::fetch_lidar(size_t idx) {
+
+    // Decode if not shared
+    Stats::Timer timer(stats, STAGE_FETCH_LIDAR);
+    timer.timestamp = time_lidar_avg.at(idx);
+    if(!config->use_frame_cache) {
+        lidar_t* next = decode_lidar(idx);
+        timer.bytes = next->points.size()*sizeof(std::array<float,4>);
+        return next;
+    }
+
+    // Else copy the shared one, which is still much cheaper than reading it
+    std::shared_ptr<const lidar_t> frame = FrameCache::instance().get_or_load<lidar_t>(
+            SENSOR_LIDAR, path_lidar.at(idx),
+            [&]() { return decode_lidar(idx); },
+            [](const lidar_t* l) { return sizeof(lidar_t) + l->points.size()*sizeof(std::array<float,4>); });
+    timer.bytes = frame->points.size()*sizeof(std::array<float,4>);
+    lidar_t* next = pool_lidar->take();
+    *next = *frame;
+    return next;
+
+}
+
+
+/**
+ * Random access outside of the replay, the batched reads only expect the files they have scheduled
+ */
+lidar_t* Loader::read_lidar(size_t idx) {
+    Stats::Timer timer(stats, STAGE_FETCH_LIDAR);
+    timer.timestamp = time_lidar_avg.at(idx);
+    lidar_t* next = decode_lidar(idx, false);
+    timer.bytes = next->points.size()*sizeof(std::array<float,4>);
+    return next;
+}
+
+
 /**
  * This loads velodyne point data from the LIDAR
  * This loads it into the lidar_t data type
- * Code was taken from the devkit_raw_data.zip provided by KITTI
+ * Raw scans are float x,y,z,r as in the devkit_raw_data.zip provided by KITTI
  */
-lidar_t* Loader::fetch_lidar(size_t idx) {
+lidar_t* Loader::decode_lidar(size_t idx, bool batched) {
 
-    // Main data type
-    lidar_t* temp = new lidar_t;
+    // Main data type, reusing the point buffer of an old scan if there is one
+    lidar_t* temp = pool_lidar->take();
     temp->timestamp = time_lidar_avg.at(idx);
     temp->timestamp_start = time_lidar_start.at(idx);
     temp->timestamp_end = time_lidar_end.at(idx);
 
+    // Compressed scans decode straight into the point vector
+    // We map them if the storage can, else read them whole
+    const std::string& path = path_lidar.at(idx);
+    batched = batched && batch_reader != nullptr;
+    if(path.size() > LidarArchive::EXTENSION.size()
+       && path.compare(path.size()-LidarArchive::EXTENSION.size(), std::string::npos, LidarArchive::EXTENSION) == 0) {
+        std::shared_ptr<const mapping_t> mapping;
+        std::vector<char> buffer;
+        if(!batched)
+            mapping = storage.map(path);
+        bool found = (batched)? read_file(path, buffer) : (mapping || storage.read_all(path, buffer));
+        // The pooled scan still has the old points, so it is emptied if anything fails
+        if(!found) {
+            std::cerr << "[kitti_parser]: Unable to read " << path << std::endl;
+            temp->points.clear();
+        } else {
+            const uint8_t* data = (mapping)? (const uint8_t*)mapping->data : (const uint8_t*)buffer.data();
+            size_t size = (mapping)? mapping->size : buffer.size();
+            if(!LidarArchive::decode(data, size, temp->points)) {
+                std::cerr << "[kitti_parser]: Unable to decode " << path << std::endl;
+                temp->points.clear();
+            }
+        }
+        temp->num_points = (int)temp->points.size();
+        return temp;
+    }
 
-    // allocate 4 MB buffer (only ~130*4*4 KB are needed)
-    int32_t num = 1000000;
-    float *data = (float*)malloc(num*sizeof(float));
-
-    // pointers
-    float *px = data+0;
-    float *py = data+1;
-    float *pz = data+2;
-    float *pr = data+3;
-
-    // load point cloud
-    FILE *stream;
-    stream = fopen(path_lidar.at(idx).c_str(),"rb");
-    num = fread(data,sizeof(float),num,stream)/4;
-    // Loop through and append points
-    for (int32_t i=0; i<num; i++) {
-        // Append
-        std::array<float,4> vals = {*px,*py,*pz,*pr};
-        temp->points.push_back(vals);
-        // Move forward
-        px+=4; py+=4; pz+=4; pr+=4;
+    // Raw scans are x,y,z,r floats, which is the same layout as our points
+    // Batched reads already have the bytes, else we read them straight into the point vector
+    if(batched) {
+        std::vector<char> buffer;
+        if(!read_file(path, buffer)) {
+            std::cerr << "[kitti_parser]: Unable to read " << path << std::endl;
+            buffer.clear();
+        }
+        size_t num = buffer.size()/sizeof(std::array<float,4>);
+        temp->points.resize(num);
+        if(num > 0)
+            memcpy(temp->points.data(), buffer.data(), num*sizeof(std::array<float,4>));
+    }
+    else {
+        stat_t st;
+        size_t num = 0;
+        if(storage.stat(path, st))
+            num = (size_t)(st.size/sizeof(std::array<float,4>));
+        else
+            std::cerr << "[kitti_parser]: Unable to read " << path << std::endl;
+        temp->points.resize(num);
+        if(num > 0 && !storage.read(path, 0, num*sizeof(std::array<float,4>), (char*)temp->points.data())) {
+            std::cerr << "[kitti_parser]: Unable to read " << path << std::endl;
+            temp->points.clear();
+        }
     }
-    fclose(stream);
-    free(data);
 
     // Return
     temp->num_points = (int)temp->points.size();
@@ -370,63 +803,94 @@ lidar_t* Loader::fetch_lidar(size_t idx) {
 }
 
 
+/**
+ * This gets a GPS/IMU measurement
+ */
 gpsimu_t* Loader::fetch_gpsimu(size_t idx) {
 
+    // Records are already in memory, so there is nothing to share through the frame cache
+    Stats::Timer timer(stats, STAGE_FETCH_GPSIMU);
+    timer.timestamp = time_gpsimu.at(idx);
+    timer.bytes = sizeof(gpsimu_t);
+    return decode_gpsimu(idx);
+
+}
+
+
+/**
+ * This gets a GPS/IMU measurement from the table of records parsed when loading
+ */
+gpsimu_t* Loader::decode_gpsimu(size_t idx) {
+
     // Make new measurement
     gpsimu_t* next = new gpsimu_t;
+    table_gpsimu.record(idx, *next);
     next->timestamp = time_gpsimu.at(idx);
 
-    // Read in file of doubles
-    std::vector<double> values;
-    std::ifstream ifile(path_gpsimu.at(idx), std::ios::in);
+    // Return it
+    return next;
+
+}
+
+
+const OxtsTable& Loader::oxts() const {
+    return table_gpsimu;
+}
 
-    // Keep storing values from the text file so long as data exists:
-    double num = 0.0;
-    while (ifile >> num) {
-        values.push_back(num);
+
+const Trajectory& Loader::trajectory() const {
+    return poses_gpsimu;
+}
+
+
+const std::vector<long>& Loader::times(sensor_t sensor) const {
+    switch(sensor) {
+        case SENSOR_STEREO_GRAY:
+            return time_stereo_gray;
+        case SENSOR_STEREO_COLOR:
+            return time_stereo_color;
+        case SENSOR_LIDAR:
+            return time_lidar_avg;
+        default:
+            return time_gpsimu;
     }
+}
+
 
+/**
+ * Shared read only handles for subscribers
+ * Lidar scans go back to the pool once the last subscriber lets go, so their point buffers are reused
+ */
+std::shared_ptr<const stereo_t> Loader::share(stereo_t* frame) {
+    return std::shared_ptr<const stereo_t>(frame);
+}
 
-    // Set values, see the file for details on each one
-    next->lat = values.at(0);
-    next->lon = values.at(1);
-    next->alt = values.at(2);
-    next->roll = values.at(3);
-    next->pitch = values.at(4);
-    next->yaw = values.at(5);
-
-    next->vn = values.at(6);
-    next->ve = values.at(7);
-    next->vf = values.at(8);
-    next->vl = values.at(9);
-    next->vu = values.at(10);
-
-    next->ax = values.at(11);
-    next->ay = values.at(12);
-    next->az = values.at(13);
-    next->af = values.at(14);
-    next->al = values.at(15);
-    next->au = values.at(16);
-    next->wx = values.at(17);
-    next->wy = values.at(18);
-    next->wz = values.at(19);
-    next->wf = values.at(20);
-    next->wl = values.at(21);
-    next->wu = values.at(22);
-
-    next->pos_accuracy = values.at(23);
-    next->vel_accuracy = values.at(24);
-
-
-    next->navstat = (int)values.at(25);
-    next->numsats = (int)values.at(26);
-    next->posmode = (int)values.at(27);
-    next->velmode = (int)values.at(28);
-    next->orimode = (int)values.at(29);
+std::shared_ptr<const lidar_t> Loader::share(lidar_t* scan) {
+    return Pool<lidar_t>::share(pool_lidar, scan);
+}
 
+std::shared_ptr<const gpsimu_t> Loader::share(gpsimu_t* meas) {
+    return std::shared_ptr<const gpsimu_t>(meas);
+}
 
-    // Return it
+
+/**
+ * Deep copies of a measurement, so whoever gets it can draw on the images without others seeing it
+ * Scans reuse a pooled point buffer.
+ */
+stereo_t* Loader::copy(const stereo_t& frame) {
+    stereo_t* next = new stereo_t(frame);
+    next->image_left = frame.image_left.clone();
+    next->image_right = frame.image_right.clone();
     return next;
+}
 
+lidar_t* Loader::copy(const lidar_t& scan) {
+    lidar_t* next = pool_lidar->take();
+    *next = scan;
+    return next;
 }
 
+gpsimu_t* Loader::copy(const gpsimu_t& meas) {
+    return new gpsimu_t(meas);
+}
@@ -27,13 +27,25 @@
 
 #include <string>
 #include <iostream>
+#include <map>
 #include <vector>
 #include <string>
+#include <chrono>
+#include <memory>
 #include <boost/variant.hpp>
 #include "kitti_parser/util/Config.h"
+#include "kitti_parser/util/ImageCache.h"
+#include "kitti_parser/util/Stats.h"
+#include "kitti_parser/util/MountStorage.h"
+#include "kitti_parser/util/BatchReader.h"
+#include "kitti_parser/util/OxtsTable.h"
+#include "kitti_parser/util/Trajectory.h"
+#include "kitti_parser/util/Preintegrator.h"
+#include "kitti_parser/util/Pool.h"
 #include "kitti_parser/types/stereo_t.h"
 #include "kitti_parser/types/lidar_t.h"
 #include "kitti_parser/types/gpsimu_t.h"
+#include "kitti_parser/types/sensor_t.h"
 
 
 namespace kitti_parser {
@@ -42,17 +54,60 @@ namespace kitti_parser {
 
     public:
 
-        // Default constructor
-        Loader(Config* config);
+        // Default constructor, stats are recorded if given
+        Loader(Config* config, Stats* stats = nullptr);
+
+        // Frees the caches, readers and mounted archives
+        ~Loader();
+
+        Loader(const Loader&) = delete;
+        Loader& operator=(const Loader&) = delete;
 
         // Load all text files, and need paths
         void load_all(std::string path);
 
+        // Mount a packed drive or archive, after this its path can be used like the drive folder
+        bool mount(std::string path_archive);
+
+        // True if the file or folder exists, either on disk or in a mounted archive
+        bool exists(const std::string& path);
+
+        // Reads a whole file, either on disk or in a mounted archive
+        bool read(const std::string& path, std::vector<char>& out);
+
 
         // Fetches the latest measurement that should be processed
         typedef boost::variant<stereo_t*, lidar_t*, gpsimu_t*> message_types;
         message_types* fetch_latest();
 
+        // All OXTS records of the loaded drives, by column
+        const OxtsTable& oxts() const;
+
+        // Poses of the IMU for all OXTS records
+        const Trajectory& trajectory() const;
+
+        // Timestamps of one stream, the lidar uses the middle of each scan
+        const std::vector<long>& times(sensor_t sensor) const;
+
+        // Fetch commands, constructs the actual datatype at an index of its stream
+        // For callers that merge the streams themselves, fetch_latest() does this for everything loaded
+        stereo_t* fetch_stereo(size_t idx, bool is_color);
+        lidar_t* fetch_lidar(size_t idx);
+        gpsimu_t* fetch_gpsimu(size_t idx);
+
+        // Reads a scan straight from storage, skipping the batched reads of the replay, so any thread can call it
+        lidar_t* read_lidar(size_t idx);
+
+        // Read only handle of a fetched measurement for many owners, freed or pooled after the last one
+        std::shared_ptr<const stereo_t> share(stereo_t* frame);
+        std::shared_ptr<const lidar_t> share(lidar_t* scan);
+        std::shared_ptr<const gpsimu_t> share(gpsimu_t* meas);
+
+        // Copy of a shared measurement for a single owner that may change it, the images are cloned
+        stereo_t* copy(const stereo_t& frame);
+        lidar_t* copy(const lidar_t& scan);
+        gpsimu_t* copy(const gpsimu_t& meas);
+
 
 
     private:
@@ -60,6 +115,9 @@ namespace kitti_parser {
         // Main config
         Config* config;
 
+        // Where we record our timings, can be null
+        Stats* stats;
+
         // Main arrays of timestamps
         std::vector<long> time_stereo_gray;
         std::vector<long> time_stereo_color;
@@ -77,6 +135,18 @@ namespace kitti_parser {
         std::vector<std::string> path_lidar;
         std::vector<std::string> path_gpsimu;
 
+        // OXTS records, parsed when loading, one per entry of path_gpsimu
+        OxtsTable table_gpsimu;
+
+        // Poses computed from the records
+        Trajectory poses_gpsimu;
+
+        // Preintegrates the records between camera frames
+        Preintegrator preintegrator;
+
+        // Free scans, so their point buffers are reused
+        std::shared_ptr<Pool<lidar_t>> pool_lidar;
+
 
         // Master index values
         long curr_sg = LONG_MAX;
@@ -89,6 +159,45 @@ namespace kitti_parser {
         size_t idx_gps = 0;
 
 
+        // Decoded image cache, created on first use if enabled
+        ImageCache* image_cache = nullptr;
+
+        // Where all files are read from, disk plus any mounted archives
+        MountStorage storage;
+
+        // Batched reads of the upcoming files, created on first use if enabled
+        BatchReader* batch_reader = nullptr;
+
+        // Sorted paths of everything in a folder
+        std::vector<std::string> list_folder(const std::string& path);
+
+        // Reads a whole file, from the batched reads if enabled
+        bool read_file(const std::string& path, std::vector<char>& out);
+
+        // Stream with the next measurement given the current timestamps, -1 if all are done
+        int next_stream(long sg, long sc, long lidar, long gps) const;
+
+        // Files that the next measurements will read, in order, up to count files or the timestamp
+        // The timestamp of the measurement each file is for is also given if asked
+        void schedule(size_t count, std::vector<std::string>& paths, long until = LONG_MAX,
+                      std::vector<long>* times = nullptr) const;
+
+        // Last file we hinted to the storage and its timestamp, so each file is only hinted once
+        std::string last_hint;
+        long last_hint_time = -1;
+
+        // Hint the storage about the next files it will read
+        void hint_ahead(size_t count, long until = LONG_MAX);
+
+        // How fast we move through the dataset, in dataset ms per wall ms
+        double readahead_rate = 1.0;
+        long rate_timestamp = -1;
+        std::chrono::steady_clock::time_point rate_wall;
+
+        // Update the rate from the timestamp we are at now
+        void update_rate(long timestamp);
+
+
         // Private functions to load each type
         void load_timestamps(std::string path_timestamp, std::vector<long>& time, int& ct);
         void load_stereo(std::string path_left, std::string path_right, std::vector<long>& time,
@@ -98,10 +207,17 @@ namespace kitti_parser {
                         std::vector<long>& time_end, std::vector<std::string>& pathB);
         void load_gpsimu(std::string path_gpsimu, std::vector<long>& time, std::vector<std::string>& path);
 
-        // Fetch commands, constructs the actual datatype
-        stereo_t* fetch_stereo(size_t idx, bool is_color);
-        lidar_t* fetch_lidar(size_t idx);
-        gpsimu_t* fetch_gpsimu(size_t idx);
+        // Reads an image, through the cache if enabled
+        cv::Mat read_image(const std::string& path, int flags);
+        cv::Mat decode_image(const std::string& path, int flags);
+
+        // Adds the IMU preintegrated since the previous frame of the same camera
+        void preintegrate(stereo_t* frame, size_t idx, bool is_color);
+
+        // Decode commands, reads the datatype from disk
+        stereo_t* decode_stereo(size_t idx, bool is_color);
+        lidar_t* decode_lidar(size_t idx, bool batched = true);
+        gpsimu_t* decode_gpsimu(size_t idx);
 
 
     };
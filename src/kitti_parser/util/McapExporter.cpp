@@ -0,0 +1,317 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "kitti_parser/util/McapExporter.h"
+#include <cmath>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// Topics that are written
+const std::string McapExporter::TOPIC_GRAY_LEFT = "/kitti/camera_gray_left/image_raw";
+const std::string McapExporter::TOPIC_GRAY_RIGHT = "/kitti/camera_gray_right/image_raw";
+const std::string McapExporter::TOPIC_COLOR_LEFT = "/kitti/camera_color_left/image_raw";
+const std::string McapExporter::TOPIC_COLOR_RIGHT = "/kitti/camera_color_right/image_raw";
+const std::string McapExporter::TOPIC_LIDAR = "/kitti/velo/pointcloud";
+const std::string McapExporter::TOPIC_GPS = "/kitti/oxts/gps/fix";
+const std::string McapExporter::TOPIC_IMU = "/kitti/oxts/imu";
+
+
+// Message definitions in the ros2msg format, each used type follows after a separator line
+static const std::string SEPARATOR = "\n" + std::string(80, '=') + "\n";
+static const std::string DEF_HEADER =
+    "MSG: std_msgs/Header\n"
+    "builtin_interfaces/Time stamp\n"
+    "string frame_id" + SEPARATOR +
+    "MSG: builtin_interfaces/Time\n"
+    "int32 sec\n"
+    "uint32 nanosec";
+static const std::string DEF_IMAGE =
+    "std_msgs/Header header\n"
+    "uint32 height\n"
+    "uint32 width\n"
+    "string encoding\n"
+    "uint8 is_bigendian\n"
+    "uint32 step\n"
+    "uint8[] data" + SEPARATOR + DEF_HEADER;
+static const std::string DEF_POINTCLOUD =
+    "std_msgs/Header header\n"
+    "uint32 height\n"
+    "uint32 width\n"
+    "sensor_msgs/PointField[] fields\n"
+    "bool is_bigendian\n"
+    "uint32 point_step\n"
+    "uint32 row_step\n"
+    "uint8[] data\n"
+    "bool is_dense" + SEPARATOR + DEF_HEADER + SEPARATOR +
+    "MSG: sensor_msgs/PointField\n"
+    "uint8 INT8=1\n"
+    "uint8 UINT8=2\n"
+    "uint8 INT16=3\n"
+    "uint8 UINT16=4\n"
+    "uint8 INT32=5\n"
+    "uint8 UINT32=6\n"
+    "uint8 FLOAT32=7\n"
+    "uint8 FLOAT64=8\n"
+    "string name\n"
+    "uint32 offset\n"
+    "uint8 datatype\n"
+    "uint32 count";
+static const std::string DEF_NAVSATFIX =
+    "uint8 COVARIANCE_TYPE_UNKNOWN=0\n"
+    "uint8 COVARIANCE_TYPE_APPROXIMATED=1\n"
+    "uint8 COVARIANCE_TYPE_DIAGONAL_KNOWN=2\n"
+    "uint8 COVARIANCE_TYPE_KNOWN=3\n"
+    "std_msgs/Header header\n"
+    "sensor_msgs/NavSatStatus status\n"
+    "float64 latitude\n"
+    "float64 longitude\n"
+    "float64 altitude\n"
+    "float64[9] position_covariance\n"
+    "uint8 position_covariance_type" + SEPARATOR + DEF_HEADER + SEPARATOR +
+    "MSG: sensor_msgs/NavSatStatus\n"
+    "int8 STATUS_NO_FIX=-1\n"
+    "int8 STATUS_FIX=0\n"
+    "int8 STATUS_SBAS_FIX=1\n"
+    "int8 STATUS_GBAS_FIX=2\n"
+    "int8 status\n"
+    "uint16 SERVICE_GPS=1\n"
+    "uint16 SERVICE_GLONASS=2\n"
+    "uint16 SERVICE_COMPASS=4\n"
+    "uint16 SERVICE_GALILEO=8\n"
+    "uint16 service";
+static const std::string DEF_IMU =
+    "std_msgs/Header header\n"
+    "geometry_msgs/Quaternion orientation\n"
+    "float64[9] orientation_covariance\n"
+    "geometry_msgs/Vector3 angular_velocity\n"
+    "float64[9] angular_velocity_covariance\n"
+    "geometry_msgs/Vector3 linear_acceleration\n"
+    "float64[9] linear_acceleration_covariance" + SEPARATOR + DEF_HEADER + SEPARATOR +
+    "MSG: geometry_msgs/Quaternion\n"
+    "float64 x 0\n"
+    "float64 y 0\n"
+    "float64 z 0\n"
+    "float64 w 1" + SEPARATOR +
+    "MSG: geometry_msgs/Vector3\n"
+    "float64 x\n"
+    "float64 y\n"
+    "float64 z";
+
+
+// CDR encoding as rosbag2 writes it, little endian, which is also how we have everything in memory
+// Values are aligned to their size, counted from after the four byte encapsulation header
+static void cdr_begin(std::vector<char>& b) {
+    static const char encapsulation[4] = {0x00, 0x01, 0x00, 0x00};
+    b.assign(encapsulation, encapsulation + 4);
+}
+
+static void cdr_align(std::vector<char>& b, size_t size) {
+    while((b.size() - 4) % size != 0)
+        b.push_back(0);
+}
+
+template<typename T>
+static void cdr_put(std::vector<char>& b, T v) {
+    cdr_align(b, sizeof(T));
+    b.insert(b.end(), (const char*)&v, (const char*)&v + sizeof(T));
+}
+
+static void cdr_string(std::vector<char>& b, const std::string& s) {
+    cdr_put<uint32_t>(b, (uint32_t)(s.size() + 1));
+    b.insert(b.end(), s.begin(), s.end());
+    b.push_back(0);
+}
+
+// Header with the stamp from our timestamp (ms)
+static void cdr_header(std::vector<char>& b, long timestamp, const std::string& frame) {
+    cdr_put<int32_t>(b, (int32_t)(timestamp/1000));
+    cdr_put<uint32_t>(b, (uint32_t)((timestamp%1000)*1000000));
+    cdr_string(b, frame);
+}
+
+// Log time (ns) of a timestamp (ms)
+static uint64_t log_time(long timestamp) {
+    return (uint64_t)timestamp*1000000ull;
+}
+
+
+/**
+ * Creates the file with a schema per message type and all topics
+ */
+McapExporter::McapExporter(std::string path, size_t chunk_size, size_t workers) :
+    writer(path, "ros2", chunk_size, workers) {
+
+    uint16_t image = writer.add_schema("sensor_msgs/msg/Image", "ros2msg", DEF_IMAGE);
+    uint16_t cloud = writer.add_schema("sensor_msgs/msg/PointCloud2", "ros2msg", DEF_POINTCLOUD);
+    uint16_t fix = writer.add_schema("sensor_msgs/msg/NavSatFix", "ros2msg", DEF_NAVSATFIX);
+    uint16_t imu = writer.add_schema("sensor_msgs/msg/Imu", "ros2msg", DEF_IMU);
+
+    channel_gray[0] = writer.add_channel(image, TOPIC_GRAY_LEFT, "cdr");
+    channel_gray[1] = writer.add_channel(image, TOPIC_GRAY_RIGHT, "cdr");
+    channel_color[0] = writer.add_channel(image, TOPIC_COLOR_LEFT, "cdr");
+    channel_color[1] = writer.add_channel(image, TOPIC_COLOR_RIGHT, "cdr");
+    channel_lidar = writer.add_channel(cloud, TOPIC_LIDAR, "cdr");
+    channel_gps = writer.add_channel(fix, TOPIC_GPS, "cdr");
+    channel_imu = writer.add_channel(imu, TOPIC_IMU, "cdr");
+
+}
+
+
+bool McapExporter::valid() const {
+    return writer.valid();
+}
+
+
+/**
+ * Each image of the frame is its own message, the rows come straight from the image
+ */
+void McapExporter::write(const stereo_t& frame) {
+
+    static const std::string frames_gray[2] = {"camera_gray_left", "camera_gray_right"};
+    static const std::string frames_color[2] = {"camera_color_left", "camera_color_right"};
+    const cv::Mat* images[2] = {&frame.image_left, &frame.image_right};
+
+    for(int i=0; i<2; i++) {
+
+        const cv::Mat& image = *images[i];
+        if(image.empty())
+            continue;
+        size_t row = image.cols*image.elemSize();
+
+        // Fields up to the pixels
+        cdr_begin(head);
+        cdr_header(head, frame.timestamp, frame.is_color? frames_color[i] : frames_gray[i]);
+        cdr_put<uint32_t>(head, (uint32_t)image.rows);
+        cdr_put<uint32_t>(head, (uint32_t)image.cols);
+        cdr_string(head, (image.channels() == 3)? "bgr8" : "mono8");
+        cdr_put<uint8_t>(head, 0);
+        cdr_put<uint32_t>(head, (uint32_t)row);
+        cdr_put<uint32_t>(head, (uint32_t)(row*image.rows));
+
+        // Then the rows, a single part if it is continuous
+        parts.clear();
+        struct iovec part;
+        part.iov_base = head.data();
+        part.iov_len = head.size();
+        parts.push_back(part);
+        if(image.isContinuous()) {
+            part.iov_base = (void*)image.ptr(0);
+            part.iov_len = row*image.rows;
+            parts.push_back(part);
+        } else {
+            for(int r=0; r<image.rows; r++) {
+                part.iov_base = (void*)image.ptr(r);
+                part.iov_len = row;
+                parts.push_back(part);
+            }
+        }
+        uint16_t channel = frame.is_color? channel_color[i] : channel_gray[i];
+        writer.write(channel, log_time(frame.timestamp), parts.data(), parts.size());
+
+    }
+
+}
+
+
+/**
+ * Points are x, y, z and intensity floats, which is exactly how we have them
+ */
+void McapExporter::write(const lidar_t& scan) {
+
+    static const char* names[4] = {"x", "y", "z", "intensity"};
+    size_t bytes = scan.points.size()*sizeof(std::array<float,4>);
+
+    // Fields up to the points
+    cdr_begin(head);
+    cdr_header(head, scan.timestamp, "velo_link");
+    cdr_put<uint32_t>(head, 1);
+    cdr_put<uint32_t>(head, (uint32_t)scan.points.size());
+    cdr_put<uint32_t>(head, 4);
+    for(uint32_t i=0; i<4; i++) {
+        cdr_string(head, names[i]);
+        cdr_put<uint32_t>(head, 4*i);
+        cdr_put<uint8_t>(head, 7);
+        cdr_put<uint32_t>(head, 1);
+    }
+    cdr_put<uint8_t>(head, 0);
+    cdr_put<uint32_t>(head, (uint32_t)sizeof(std::array<float,4>));
+    cdr_put<uint32_t>(head, (uint32_t)bytes);
+    cdr_put<uint32_t>(head, (uint32_t)bytes);
+
+    // Dense after the points
+    tail.assign(1, 1);
+
+    struct iovec all[3] = {{head.data(), head.size()}, {(void*)scan.points.data(), bytes}, {tail.data(), tail.size()}};
+    writer.write(channel_lidar, log_time(scan.timestamp), all, 3);
+
+}
+
+
+/**
+ * The OXTS gives both the fix and the imu, the orientation is from its roll, pitch and yaw
+ */
+void McapExporter::write(const gpsimu_t& meas) {
+
+    // Fix, the accuracy is taken for all axes
+    cdr_begin(head);
+    cdr_header(head, meas.timestamp, "imu_link");
+    cdr_put<int8_t>(head, 0);
+    cdr_put<uint16_t>(head, 1);
+    cdr_put<double>(head, meas.lat);
+    cdr_put<double>(head, meas.lon);
+    cdr_put<double>(head, meas.alt);
+    double var = meas.pos_accuracy*meas.pos_accuracy;
+    for(int i=0; i<9; i++)
+        cdr_put<double>(head, (i%4 == 0)? var : 0.0);
+    cdr_put<uint8_t>(head, 2);
+    struct iovec part = {head.data(), head.size()};
+    writer.write(channel_gps, log_time(meas.timestamp), &part, 1);
+
+    // Imu, covariances are unknown
+    double cr = std::cos(0.5*meas.roll), sr = std::sin(0.5*meas.roll);
+    double cp = std::cos(0.5*meas.pitch), sp = std::sin(0.5*meas.pitch);
+    double cy = std::cos(0.5*meas.yaw), sy = std::sin(0.5*meas.yaw);
+    const double values[10] = {sr*cp*cy - cr*sp*sy, cr*sp*cy + sr*cp*sy, cr*cp*sy - sr*sp*cy, cr*cp*cy + sr*sp*sy,
+                               meas.wf, meas.wl, meas.wu, meas.af, meas.al, meas.au};
+    cdr_begin(head);
+    cdr_header(head, meas.timestamp, "imu_link");
+    for(int i=0; i<3; i++) {
+        for(int j=0; j<(i == 0? 4 : 3); j++)
+            cdr_put<double>(head, values[(i == 0)? j : 1 + 3*i + j]);
+        for(int j=0; j<9; j++)
+            cdr_put<double>(head, 0.0);
+    }
+    part.iov_base = head.data();
+    part.iov_len = head.size();
+    writer.write(channel_imu, log_time(meas.timestamp), &part, 1);
+
+}
+
+
+bool McapExporter::close() {
+    return writer.close();
+}
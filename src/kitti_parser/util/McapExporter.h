@@ -0,0 +1,97 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_MCAPEXPORTER_H
+#define KITTI_PARSER_MCAPEXPORTER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sys/uio.h>
+#include "kitti_parser/util/McapWriter.h"
+#include "kitti_parser/types/stereo_t.h"
+#include "kitti_parser/types/lidar_t.h"
+#include "kitti_parser/types/gpsimu_t.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Exports measurements into an MCAP file that rosbag2 can read, as CDR encoded sensor_msgs
+     * Each camera gets an Image topic, the lidar a PointCloud2, and the OXTS both a NavSatFix and an Imu.
+     * Only the message fields are encoded here, the pixels and points are copied once straight into the chunk.
+     */
+    class McapExporter {
+
+    public:
+
+        // Topics that are written
+        static const std::string TOPIC_GRAY_LEFT;
+        static const std::string TOPIC_GRAY_RIGHT;
+        static const std::string TOPIC_COLOR_LEFT;
+        static const std::string TOPIC_COLOR_RIGHT;
+        static const std::string TOPIC_LIDAR;
+        static const std::string TOPIC_GPS;
+        static const std::string TOPIC_IMU;
+
+        // Create the file with all schemas and topics, see McapWriter for the chunk size and workers
+        explicit McapExporter(std::string path, size_t chunk_size = 4 << 20, size_t workers = 0);
+
+        McapExporter(const McapExporter&) = delete;
+        McapExporter& operator=(const McapExporter&) = delete;
+
+        // True if the file is open and nothing failed
+        bool valid() const;
+
+        // Write a measurement to the topics of its stream
+        void write(const stereo_t& frame);
+        void write(const lidar_t& scan);
+        void write(const gpsimu_t& meas);
+
+        // Finish the file, false if anything failed
+        bool close();
+
+    private:
+
+        McapWriter writer;
+
+        // Channel ids of each topic
+        uint16_t channel_gray[2];
+        uint16_t channel_color[2];
+        uint16_t channel_lidar;
+        uint16_t channel_gps;
+        uint16_t channel_imu;
+
+        // Reused for the encoded fields and the parts of each message
+        std::vector<char> head;
+        std::vector<char> tail;
+        std::vector<struct iovec> parts;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_MCAPEXPORTER_H
@@ -0,0 +1,488 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "kitti_parser/util/McapWriter.h"
+#include "kitti_parser/util/Crc32.h"
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <iostream>
+#include <algorithm>
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// File magic, at the start and the end
+static const char MAGIC[8] = {(char)0x89, 'M', 'C', 'A', 'P', '0', '\r', '\n'};
+
+// Record opcodes
+static const uint8_t OP_HEADER = 0x01;
+static const uint8_t OP_FOOTER = 0x02;
+static const uint8_t OP_SCHEMA = 0x03;
+static const uint8_t OP_CHANNEL = 0x04;
+static const uint8_t OP_MESSAGE = 0x05;
+static const uint8_t OP_CHUNK = 0x06;
+static const uint8_t OP_MESSAGE_INDEX = 0x07;
+static const uint8_t OP_CHUNK_INDEX = 0x08;
+static const uint8_t OP_STATISTICS = 0x0B;
+static const uint8_t OP_SUMMARY_OFFSET = 0x0E;
+static const uint8_t OP_DATA_END = 0x0F;
+
+// Most iovecs in a single write
+static const size_t MAX_IOVECS = 64;
+
+
+// Little endian writers, which is how MCAP encodes everything
+static void put_u8(std::vector<char>& b, uint8_t v) {
+    b.push_back((char)v);
+}
+
+static void put_u16(std::vector<char>& b, uint16_t v) {
+    v = htole16(v);
+    b.insert(b.end(), (const char*)&v, (const char*)&v + 2);
+}
+
+static void put_u32(std::vector<char>& b, uint32_t v) {
+    v = htole32(v);
+    b.insert(b.end(), (const char*)&v, (const char*)&v + 4);
+}
+
+static void put_u64(std::vector<char>& b, uint64_t v) {
+    v = htole64(v);
+    b.insert(b.end(), (const char*)&v, (const char*)&v + 8);
+}
+
+static void put_string(std::vector<char>& b, const std::string& s) {
+    put_u32(b, (uint32_t)s.size());
+    b.insert(b.end(), s.begin(), s.end());
+}
+
+// Start a record, returns where its length goes
+static size_t begin_record(std::vector<char>& b, uint8_t opcode) {
+    put_u8(b, opcode);
+    size_t at = b.size();
+    put_u64(b, 0);
+    return at;
+}
+
+// Fill in the length of a record once its content is done
+static void end_record(std::vector<char>& b, size_t at) {
+    uint64_t length = htole64((uint64_t)(b.size() - at - 8));
+    memcpy(b.data() + at, &length, 8);
+}
+
+
+/**
+ * Opens the file and writes the magic and header
+ */
+McapWriter::McapWriter(std::string path, std::string profile, size_t chunk, size_t num) {
+
+    chunk_size = std::max(chunk, (size_t)4096);
+    num_workers = (num > 0)? num : std::max(2u, std::thread::hardware_concurrency()) - 1;
+    pool = std::make_shared<Pool<chunk_t>>(2*num_workers + 4);
+
+    // Create the file
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        cerr << "[kitti_parser]: Unable to create " << path << " (" << strerror(errno) << ")" << endl;
+        failed = true;
+        return;
+    }
+
+    // Magic and header
+    std::vector<char> buf(MAGIC, MAGIC + sizeof(MAGIC));
+    size_t at = begin_record(buf, OP_HEADER);
+    put_string(buf, profile);
+    put_string(buf, "kitti_parser");
+    end_record(buf, at);
+    struct iovec part = {buf.data(), buf.size()};
+    crc_data = Crc32::update(crc_data, buf.data(), buf.size());
+    append(&part, 1);
+
+}
+
+
+McapWriter::~McapWriter() {
+    close();
+}
+
+
+bool McapWriter::valid() const {
+    return !failed && fd >= 0;
+}
+
+
+/**
+ * Schemas are written to the data section right away, and kept for the summary
+ */
+uint16_t McapWriter::add_schema(const std::string& name, const std::string& encoding, const std::string& data) {
+    if(!valid() || num_messages > 0) {
+        cerr << "[kitti_parser]: Schemas have to be added before the first message" << endl;
+        return 0;
+    }
+    uint16_t id = ++num_schemas;
+    std::vector<char> buf;
+    size_t at = begin_record(buf, OP_SCHEMA);
+    put_u16(buf, id);
+    put_string(buf, name);
+    put_string(buf, encoding);
+    put_string(buf, data);
+    end_record(buf, at);
+    schemas.insert(schemas.end(), buf.begin(), buf.end());
+    struct iovec part = {buf.data(), buf.size()};
+    crc_data = Crc32::update(crc_data, buf.data(), buf.size());
+    append(&part, 1);
+    return id;
+}
+
+
+uint16_t McapWriter::add_channel(uint16_t schema, const std::string& topic, const std::string& encoding,
+                                 const std::map<std::string, std::string>& metadata) {
+    if(!valid() || num_messages > 0) {
+        cerr << "[kitti_parser]: Channels have to be added before the first message" << endl;
+        return 0;
+    }
+    uint16_t id = ++num_channels;
+    std::vector<char> buf;
+    size_t at = begin_record(buf, OP_CHANNEL);
+    put_u16(buf, id);
+    put_u16(buf, schema);
+    put_string(buf, topic);
+    put_string(buf, encoding);
+    std::vector<char> map;
+    for(std::map<std::string, std::string>::const_iterator it=metadata.begin(); it!=metadata.end(); ++it) {
+        put_string(map, it->first);
+        put_string(map, it->second);
+    }
+    put_u32(buf, (uint32_t)map.size());
+    buf.insert(buf.end(), map.begin(), map.end());
+    end_record(buf, at);
+    channels.insert(channels.end(), buf.begin(), buf.end());
+    struct iovec part = {buf.data(), buf.size()};
+    crc_data = Crc32::update(crc_data, buf.data(), buf.size());
+    append(&part, 1);
+    channel_counts[id] = 0;
+    return id;
+}
+
+
+/**
+ * Appends the message record to the current chunk, and hands the chunk off once it is full
+ * The message index only needs the offset of the record in the chunk, which we know here.
+ */
+void McapWriter::write(uint16_t channel, uint64_t log_time, const struct iovec* parts, size_t count) {
+
+    if(!valid() || closed)
+        return;
+
+    // Get a chunk to write into, reusing the buffers of an old one
+    if(current == nullptr) {
+        current = pool->take();
+        current->records.clear();
+        current->records.reserve(chunk_size + (chunk_size >> 2));
+        current->index.clear();
+        current->start = UINT64_MAX;
+        current->end = 0;
+        current->messages = 0;
+        current->done.store(false);
+    }
+
+    // Record header, publish time is the same as the log time
+    size_t size = 0;
+    for(size_t i=0; i<count; i++)
+        size += parts[i].iov_len;
+    std::vector<char>& records = current->records;
+    current->index[channel].push_back(std::make_pair(log_time, (uint64_t)records.size()));
+    put_u8(records, OP_MESSAGE);
+    put_u64(records, 2 + 4 + 8 + 8 + size);
+    put_u16(records, channel);
+    put_u32(records, sequences[channel]++);
+    put_u64(records, log_time);
+    put_u64(records, log_time);
+
+    // Then the data itself
+    for(size_t i=0; i<count; i++)
+        records.insert(records.end(), (const char*)parts[i].iov_base, (const char*)parts[i].iov_base + parts[i].iov_len);
+
+    // Statistics
+    current->start = std::min(current->start, log_time);
+    current->end = std::max(current->end, log_time);
+    current->messages++;
+    time_start = std::min(time_start, log_time);
+    time_end = std::max(time_end, log_time);
+    channel_counts[channel]++;
+    num_messages++;
+
+    // Full, so off to the workers
+    if(records.size() >= chunk_size)
+        flush();
+
+}
+
+
+/**
+ * Queues the chunk for the workers, and for the writer in the same order
+ * The writer queue is what limits how many chunks are in memory, so we wait here if the disk is behind.
+ */
+void McapWriter::flush() {
+
+    if(current == nullptr || current->messages == 0)
+        return;
+
+    // Start the pipeline with the first chunk
+    if(!jobs) {
+        jobs.reset(new MpmcQueue<chunk_t*>(2*num_workers));
+        ordered.reset(new SpscQueue<chunk_t*>(2*num_workers + 2));
+        for(size_t i=0; i<num_workers; i++) {
+            workers.emplace_back([this]() {
+                chunk_t* chunk;
+                while(jobs->pop(chunk)) {
+                    build(chunk);
+                    chunk->done.store(true, std::memory_order_release);
+                    finished.notify();
+                }
+            });
+        }
+        writer = std::thread([this]() {
+            chunk_t* chunk;
+            while(ordered->pop(chunk)) {
+                finished.wait([&]() { return chunk->done.load(std::memory_order_acquire); });
+                commit(chunk);
+                pool->give(chunk);
+            }
+        });
+    }
+
+    ordered->push(current);
+    jobs->push(current);
+    current = nullptr;
+
+}
+
+
+/**
+ * Builds the chunk record header and the message index records after it
+ * The CRC of the records is the big one, the CRC of the whole thing as written is combined from the parts.
+ */
+void McapWriter::build(chunk_t* chunk) {
+
+    uint32_t crc_records = Crc32::update(0, chunk->records.data(), chunk->records.size());
+
+    // Chunk record, up to the records
+    std::vector<char>& head = chunk->head;
+    head.clear();
+    put_u8(head, OP_CHUNK);
+    put_u64(head, 8 + 8 + 8 + 4 + 4 + 8 + chunk->records.size());
+    put_u64(head, chunk->start);
+    put_u64(head, chunk->end);
+    put_u64(head, chunk->records.size());
+    put_u32(head, crc_records);
+    put_string(head, "");
+    put_u64(head, chunk->records.size());
+
+    // Message index of each channel
+    std::vector<char>& tail = chunk->tail;
+    tail.clear();
+    chunk->tail_offsets.clear();
+    for(std::map<uint16_t, std::vector<std::pair<uint64_t, uint64_t>>>::const_iterator it=chunk->index.begin();
+        it!=chunk->index.end(); ++it) {
+        chunk->tail_offsets[it->first] = tail.size();
+        size_t at = begin_record(tail, OP_MESSAGE_INDEX);
+        put_u16(tail, it->first);
+        put_u32(tail, (uint32_t)(16*it->second.size()));
+        for(size_t i=0; i<it->second.size(); i++) {
+            put_u64(tail, it->second.at(i).first);
+            put_u64(tail, it->second.at(i).second);
+        }
+        end_record(tail, at);
+    }
+
+    // CRC of everything we will write
+    uint32_t crc = Crc32::update(0, head.data(), head.size());
+    crc = Crc32::combine(crc, crc_records, chunk->records.size());
+    chunk->crc = Crc32::combine(crc, Crc32::update(0, tail.data(), tail.size()), tail.size());
+
+}
+
+
+/**
+ * Writes the chunk and its message indexes, and adds its chunk index to the summary
+ */
+void McapWriter::commit(chunk_t* chunk) {
+
+    // Write it out
+    uint64_t start = offset;
+    struct iovec parts[3] = {{chunk->head.data(), chunk->head.size()},
+                             {chunk->records.data(), chunk->records.size()},
+                             {chunk->tail.data(), chunk->tail.size()}};
+    if(!append(parts, 3))
+        write_failed = true;
+    crc_data = Crc32::combine(crc_data, chunk->crc, chunk->head.size() + chunk->records.size() + chunk->tail.size());
+    num_chunks++;
+
+    // Index of it for the summary
+    uint64_t length = chunk->head.size() + chunk->records.size();
+    size_t at = begin_record(chunk_indexes, OP_CHUNK_INDEX);
+    put_u64(chunk_indexes, chunk->start);
+    put_u64(chunk_indexes, chunk->end);
+    put_u64(chunk_indexes, start);
+    put_u64(chunk_indexes, length);
+    put_u32(chunk_indexes, (uint32_t)(10*chunk->tail_offsets.size()));
+    for(std::map<uint16_t, uint64_t>::const_iterator it=chunk->tail_offsets.begin(); it!=chunk->tail_offsets.end(); ++it) {
+        put_u16(chunk_indexes, it->first);
+        put_u64(chunk_indexes, start + length + it->second);
+    }
+    put_u64(chunk_indexes, chunk->tail.size());
+    put_string(chunk_indexes, "");
+    put_u64(chunk_indexes, chunk->records.size());
+    put_u64(chunk_indexes, chunk->records.size());
+    end_record(chunk_indexes, at);
+
+}
+
+
+/**
+ * Writes all parts, handling short writes
+ */
+bool McapWriter::append(const struct iovec* parts, size_t count) {
+
+    if(fd < 0)
+        return false;
+    std::vector<struct iovec> left(parts, parts + count);
+    size_t idx = 0;
+    while(idx < left.size()) {
+        ssize_t n = writev(fd, &left.at(idx), (int)std::min(left.size() - idx, MAX_IOVECS));
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0) {
+            cerr << "[kitti_parser]: Unable to write mcap file (" << strerror(errno) << ")" << endl;
+            return false;
+        }
+        offset += (uint64_t)n;
+        // Skip what was written
+        size_t done = (size_t)n;
+        while(idx < left.size() && done >= left.at(idx).iov_len) {
+            done -= left.at(idx).iov_len;
+            idx++;
+        }
+        if(idx < left.size()) {
+            left.at(idx).iov_base = (char*)left.at(idx).iov_base + done;
+            left.at(idx).iov_len -= done;
+        }
+    }
+    return true;
+
+}
+
+
+/**
+ * Waits for the chunks to be written, then writes the data end, summary, summary offsets and footer
+ */
+bool McapWriter::close() {
+
+    if(closed || fd < 0)
+        return !failed;
+    closed = true;
+
+    // Finish the pipeline
+    flush();
+    if(jobs) {
+        jobs->close();
+        ordered->close();
+        for(size_t i=0; i<workers.size(); i++)
+            workers.at(i).join();
+        writer.join();
+        if(write_failed)
+            failed = true;
+    }
+    delete current;
+    current = nullptr;
+    pool.reset();
+
+    // End of the data section, with its CRC
+    std::vector<char> buf;
+    size_t at = begin_record(buf, OP_DATA_END);
+    put_u32(buf, crc_data);
+    end_record(buf, at);
+    struct iovec part = {buf.data(), buf.size()};
+    if(!append(&part, 1))
+        failed = true;
+
+    // Summary, one group per record type
+    uint64_t summary_start = offset;
+    std::vector<char> summary;
+    std::vector<char> offsets;
+    std::vector<char> stats;
+    at = begin_record(stats, OP_STATISTICS);
+    put_u64(stats, num_messages);
+    put_u16(stats, num_schemas);
+    put_u32(stats, num_channels);
+    put_u32(stats, 0);
+    put_u32(stats, 0);
+    put_u32(stats, num_chunks);
+    put_u64(stats, (num_messages > 0)? time_start : 0);
+    put_u64(stats, (num_messages > 0)? time_end : 0);
+    put_u32(stats, (uint32_t)(10*channel_counts.size()));
+    for(std::map<uint16_t, uint64_t>::const_iterator it=channel_counts.begin(); it!=channel_counts.end(); ++it) {
+        put_u16(stats, it->first);
+        put_u64(stats, it->second);
+    }
+    end_record(stats, at);
+    const std::vector<char>* groups[4] = {&schemas, &channels, &stats, &chunk_indexes};
+    const uint8_t opcodes[4] = {OP_SCHEMA, OP_CHANNEL, OP_STATISTICS, OP_CHUNK_INDEX};
+    for(int i=0; i<4; i++) {
+        if(groups[i]->empty())
+            continue;
+        at = begin_record(offsets, OP_SUMMARY_OFFSET);
+        put_u8(offsets, opcodes[i]);
+        put_u64(offsets, summary_start + summary.size());
+        put_u64(offsets, groups[i]->size());
+        end_record(offsets, at);
+        summary.insert(summary.end(), groups[i]->begin(), groups[i]->end());
+    }
+
+    // Footer, its CRC covers the summary up to its own field
+    uint64_t summary_offset_start = summary_start + summary.size();
+    summary.insert(summary.end(), offsets.begin(), offsets.end());
+    put_u8(summary, OP_FOOTER);
+    put_u64(summary, 8 + 8 + 4);
+    put_u64(summary, summary_start);
+    put_u64(summary, summary_offset_start);
+    put_u32(summary, Crc32::update(0, summary.data(), summary.size()));
+    summary.insert(summary.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    part.iov_base = summary.data();
+    part.iov_len = summary.size();
+    if(!append(&part, 1))
+        failed = true;
+
+    ::close(fd);
+    fd = -1;
+    return !failed;
+
+}
@@ -0,0 +1,153 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_MCAPWRITER_H
+#define KITTI_PARSER_MCAPWRITER_H
+
+#include <map>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <sys/uio.h>
+#include "kitti_parser/util/Pool.h"
+#include "kitti_parser/util/SpscQueue.h"
+#include "kitti_parser/util/MpmcQueue.h"
+#include "kitti_parser/util/WaitStrategy.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Writes an MCAP file, see https://mcap.dev/spec
+     * Messages are appended into the current chunk on the calling thread. Full chunks go to worker
+     * threads, which build the chunk record and its message indexes and compute the CRCs, and a writer
+     * thread writes them in order, keeping the chunk index. The summary has the schemas, channels,
+     * statistics and chunk indexes, so readers can seek without scanning the file.
+     * Chunks are not compressed, since neither lz4 nor zstd is a dependency.
+     */
+    class McapWriter {
+
+    public:
+
+        // Create the file, with the profile in its header (ros2 for rosbag2)
+        McapWriter(std::string path, std::string profile, size_t chunk_size = 4 << 20, size_t workers = 0);
+
+        // Closes the file if not yet done
+        ~McapWriter();
+
+        McapWriter(const McapWriter&) = delete;
+        McapWriter& operator=(const McapWriter&) = delete;
+
+        // True if the file is open and nothing failed
+        bool valid() const;
+
+        // Add schemas and channels, all before the first message, ids start at one
+        uint16_t add_schema(const std::string& name, const std::string& encoding, const std::string& data);
+        uint16_t add_channel(uint16_t schema, const std::string& topic, const std::string& encoding,
+                             const std::map<std::string, std::string>& metadata = std::map<std::string, std::string>());
+
+        // Append a message, its data given as parts that are copied into the chunk in order
+        void write(uint16_t channel, uint64_t log_time, const struct iovec* parts, size_t count);
+
+        // Write the last chunk, the summary and footer, false if anything failed
+        bool close();
+
+    private:
+
+        // Chunk being filled, and then written
+        struct chunk_t {
+            std::vector<char> records;
+            uint64_t start = 0;
+            uint64_t end = 0;
+            size_t messages = 0;
+            std::map<uint16_t, std::vector<std::pair<uint64_t, uint64_t>>> index;
+            // Built by a worker, the records go in between
+            std::vector<char> head;
+            std::vector<char> tail;
+            std::map<uint16_t, uint64_t> tail_offsets;
+            uint32_t crc = 0;
+            std::atomic<bool> done{false};
+        };
+
+        // Output file and where we are in it
+        int fd = -1;
+        uint64_t offset = 0;
+        bool failed = false;
+        bool closed = false;
+
+        // CRC of the data section so far
+        uint32_t crc_data = 0;
+
+        // Target size of the chunk records
+        size_t chunk_size;
+
+        // Records of the summary, kept as we go
+        std::vector<char> schemas;
+        std::vector<char> channels;
+        std::vector<char> chunk_indexes;
+        uint16_t num_schemas = 0;
+        uint16_t num_channels = 0;
+        uint32_t num_chunks = 0;
+
+        // Statistics
+        uint64_t num_messages = 0;
+        uint64_t time_start = UINT64_MAX;
+        uint64_t time_end = 0;
+        std::map<uint16_t, uint64_t> channel_counts;
+        std::map<uint16_t, uint32_t> sequences;
+
+        // Pipeline, started with the first full chunk
+        std::shared_ptr<Pool<chunk_t>> pool;
+        chunk_t* current = nullptr;
+        size_t num_workers;
+        std::unique_ptr<MpmcQueue<chunk_t*>> jobs;
+        std::unique_ptr<SpscQueue<chunk_t*>> ordered;
+        std::vector<std::thread> workers;
+        std::thread writer;
+        WaitStrategy finished;
+        std::atomic<bool> write_failed{false};
+
+        // Write directly, only before the pipeline is started or after it stopped
+        bool append(const struct iovec* parts, size_t count);
+
+        // Hand the current chunk to the workers
+        void flush();
+
+        // Build the records around the chunk and their CRCs, on a worker
+        void build(chunk_t* chunk);
+
+        // Write a built chunk, on the writer thread
+        void commit(chunk_t* chunk);
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_MCAPWRITER_H
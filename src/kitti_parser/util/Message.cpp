@@ -0,0 +1,160 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/Message.h"
+
+using namespace std;
+using namespace kitti_parser;
+
+
+Message::Message() {
+}
+
+
+Message::Message(Loader::message_types* loaded) {
+    msg = loaded;
+}
+
+
+Message::Message(Message&& other) {
+    msg = other.msg;
+    other.msg = nullptr;
+}
+
+
+Message& Message::operator=(Message&& other) {
+    if(this != &other) {
+        if(msg != nullptr)
+            free(msg);
+        msg = other.msg;
+        other.msg = nullptr;
+    }
+    return *this;
+}
+
+
+Message::~Message() {
+    if(msg != nullptr)
+        free(msg);
+}
+
+
+Message::operator bool() const {
+    return msg != nullptr;
+}
+
+
+sensor_t Message::sensor() const {
+    return sensor_of(msg);
+}
+
+
+long Message::timestamp() const {
+    return timestamp_of(msg);
+}
+
+
+stereo_t* Message::stereo() const {
+    return (msg != nullptr && msg->which() == 0)? boost::get<stereo_t*>(*msg) : nullptr;
+}
+
+
+lidar_t* Message::lidar() const {
+    return (msg != nullptr && msg->which() == 1)? boost::get<lidar_t*>(*msg) : nullptr;
+}
+
+
+gpsimu_t* Message::gpsimu() const {
+    return (msg != nullptr && msg->which() == 2)? boost::get<gpsimu_t*>(*msg) : nullptr;
+}
+
+
+/**
+ * Releasing leaves the message empty, so only the variant is freed
+ */
+stereo_t* Message::release_stereo() {
+    stereo_t* out = stereo();
+    if(out != nullptr) {
+        delete msg;
+        msg = nullptr;
+    }
+    return out;
+}
+
+
+lidar_t* Message::release_lidar() {
+    lidar_t* out = lidar();
+    if(out != nullptr) {
+        delete msg;
+        msg = nullptr;
+    }
+    return out;
+}
+
+
+gpsimu_t* Message::release_gpsimu() {
+    gpsimu_t* out = gpsimu();
+    if(out != nullptr) {
+        delete msg;
+        msg = nullptr;
+    }
+    return out;
+}
+
+
+/**
+ * Returns which stream the message is from
+ */
+sensor_t Message::sensor_of(Loader::message_types* next) {
+    switch (next->which()) {
+        case 0: return (boost::get<stereo_t *>(*next)->is_color)? SENSOR_STEREO_COLOR : SENSOR_STEREO_GRAY;
+        case 1: return SENSOR_LIDAR;
+        default: return SENSOR_GPSIMU;
+    }
+}
+
+
+/**
+ * Returns the timestamp of the message
+ */
+long Message::timestamp_of(Loader::message_types* next) {
+    switch (next->which()) {
+        case 0: return boost::get<stereo_t *>(*next)->timestamp;
+        case 1: return boost::get<lidar_t *>(*next)->timestamp;
+        default: return boost::get<gpsimu_t *>(*next)->timestamp;
+    }
+}
+
+
+/**
+ * Frees both the data and the variant
+ */
+void Message::free(Loader::message_types* next) {
+    switch (next->which()) {
+        case 0: delete boost::get<stereo_t *>(*next); break;
+        case 1: delete boost::get<lidar_t *>(*next); break;
+        case 2: delete boost::get<gpsimu_t *>(*next); break;
+    }
+    delete next;
+}
@@ -0,0 +1,90 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_MESSAGE_H
+#define KITTI_PARSER_MESSAGE_H
+
+#include "kitti_parser/util/Loader.h"
+#include "kitti_parser/types/sensor_t.h"
+#include "kitti_parser/types/stereo_t.h"
+#include "kitti_parser/types/lidar_t.h"
+#include "kitti_parser/types/gpsimu_t.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * A single message pulled from the parser
+     * Owns the measurement, which is freed with the message unless it is released first.
+     * Move only, and empty (false) once the replay is done.
+     */
+    class Message {
+
+    public:
+
+        // Empty message
+        Message();
+
+        // Takes ownership of a loaded message
+        explicit Message(Loader::message_types* msg);
+
+        Message(Message&& other);
+        Message& operator=(Message&& other);
+        Message(const Message&) = delete;
+        Message& operator=(const Message&) = delete;
+        ~Message();
+
+        // True if there is a measurement
+        explicit operator bool() const;
+
+        // Sensor and timestamp (ms) of the measurement
+        sensor_t sensor() const;
+        long timestamp() const;
+
+        // The measurement, null if the message is of another type
+        stereo_t* stereo() const;
+        lidar_t* lidar() const;
+        gpsimu_t* gpsimu() const;
+
+        // Takes the measurement, the caller has to delete it, null if the message is of another type
+        stereo_t* release_stereo();
+        lidar_t* release_lidar();
+        gpsimu_t* release_gpsimu();
+
+        // Helpers for loaded messages
+        static sensor_t sensor_of(Loader::message_types* msg);
+        static long timestamp_of(Loader::message_types* msg);
+        static void free(Loader::message_types* msg);
+
+    private:
+
+        // What we own, null if empty
+        Loader::message_types* msg = nullptr;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_MESSAGE_H
@@ -0,0 +1,118 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/MountStorage.h"
+
+using namespace std;
+using namespace kitti_parser;
+
+
+MountStorage::~MountStorage() {
+    for(std::map<std::string, Storage*>::iterator it=mounts.begin(); it!=mounts.end(); ++it)
+        delete it->second;
+}
+
+
+void MountStorage::mount(const std::string& path, Storage* storage) {
+    std::string root = path;
+    while(root.size() > 1 && root.back() == '/')
+        root.pop_back();
+    std::map<std::string, Storage*>::iterator it = mounts.find(root);
+    if(it != mounts.end())
+        delete it->second;
+    storage->set_cache_mode(cache);
+    mounts[root] = storage;
+}
+
+
+bool MountStorage::mounted(const std::string& path) const {
+    std::string root = path;
+    while(root.size() > 1 && root.back() == '/')
+        root.pop_back();
+    return mounts.find(root) != mounts.end();
+}
+
+
+/**
+ * Finds the mount that the path is inside of
+ * Returns the disk if it is a normal file
+ */
+Storage* MountStorage::resolve(const std::string& path, std::string& inner) {
+    for(std::map<std::string, Storage*>::iterator it=mounts.begin(); it!=mounts.end(); ++it) {
+        const std::string& root = it->first;
+        if(path.compare(0, root.size(), root) == 0 && (path.size() == root.size() || path[root.size()] == '/')) {
+            inner = clean(path.substr(root.size()));
+            return it->second;
+        }
+    }
+    inner = path;
+    return &disk;
+}
+
+
+std::vector<std::string> MountStorage::list(const std::string& path) {
+    std::string inner;
+    return resolve(path, inner)->list(inner);
+}
+
+
+bool MountStorage::stat(const std::string& path, stat_t& st) {
+    std::string inner;
+    return resolve(path, inner)->stat(inner, st);
+}
+
+
+bool MountStorage::read(const std::string& path, uint64_t offset, size_t length, char* out) {
+    std::string inner;
+    return resolve(path, inner)->read(inner, offset, length, out);
+}
+
+
+bool MountStorage::read_all(const std::string& path, std::vector<char>& out) {
+    std::string inner;
+    return resolve(path, inner)->read_all(inner, out);
+}
+
+
+std::shared_ptr<const mapping_t> MountStorage::map(const std::string& path) {
+    std::string inner;
+    return resolve(path, inner)->map(inner);
+}
+
+
+void MountStorage::will_need(const std::string& path) {
+    std::string inner;
+    resolve(path, inner)->will_need(inner);
+}
+
+
+/**
+ * Every storage we route to uses the same mode
+ */
+void MountStorage::set_cache_mode(cache_mode_t mode) {
+    cache = mode;
+    disk.set_cache_mode(mode);
+    for(std::map<std::string, Storage*>::iterator it=mounts.begin(); it!=mounts.end(); ++it)
+        it->second->set_cache_mode(mode);
+}
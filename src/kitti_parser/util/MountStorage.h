@@ -0,0 +1,77 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_MOUNTSTORAGE_H
+#define KITTI_PARSER_MOUNTSTORAGE_H
+
+#include <map>
+#include <string>
+#include "kitti_parser/util/Storage.h"
+#include "kitti_parser/util/PosixStorage.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Routes each path to the storage it is in
+     * Archives are mounted at their own path, so "drive.tar/image_00/data/" lists the images
+     * inside of it. Everything else goes to disk. Mount before reading, lookups are not locked.
+     */
+    class MountStorage : public Storage {
+
+    public:
+
+        ~MountStorage() override;
+
+        // Use a storage for everything under the path, we take ownership of it
+        void mount(const std::string& path, Storage* storage);
+
+        // True if the path has a storage mounted on it
+        bool mounted(const std::string& path) const;
+
+        // Storage a path is in, and the path inside of it
+        Storage* resolve(const std::string& path, std::string& inner);
+
+        std::vector<std::string> list(const std::string& path) override;
+        bool stat(const std::string& path, stat_t& st) override;
+        bool read(const std::string& path, uint64_t offset, size_t length, char* out) override;
+        bool read_all(const std::string& path, std::vector<char>& out) override;
+        std::shared_ptr<const mapping_t> map(const std::string& path) override;
+        void will_need(const std::string& path) override;
+        void set_cache_mode(cache_mode_t mode) override;
+
+    private:
+
+        // Files on disk
+        PosixStorage disk;
+
+        // Mounted storages, keyed by their path without a trailing slash
+        std::map<std::string, Storage*> mounts;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_MOUNTSTORAGE_H
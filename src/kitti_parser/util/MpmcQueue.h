@@ -0,0 +1,209 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_MPMCQUEUE_H
+#define KITTI_PARSER_MPMCQUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include "kitti_parser/util/WaitStrategy.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Bounded lock-free queue for any number of producers and consumers
+     * This is Dmitry Vyukov's bounded queue, where every cell has a sequence number
+     * that tells a producer or consumer if it is its turn on that cell.
+     * http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+     * The blocking calls spin and then sleep, and return false once the queue is closed.
+     */
+    template<typename T>
+    class MpmcQueue {
+
+    public:
+
+        // Default constructor, capacity is rounded up to a power of two
+        explicit MpmcQueue(size_t capacity) {
+            size_t size = 2;
+            while(size < capacity)
+                size <<= 1;
+            cells.reset(new cell_t[size]);
+            mask = size - 1;
+            for(size_t i=0; i<size; i++)
+                cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        // Push if there is room
+        bool try_push(T& val) {
+            cell_t* cell;
+            size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+            while(true) {
+                cell = &cells[pos & mask];
+                size_t seq = cell->seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if(diff == 0) {
+                    if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if(diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+            cell->data = std::move(val);
+            cell->seq.store(pos + 1, std::memory_order_release);
+            not_empty.notify();
+            return true;
+        }
+
+        // Pop if there is anything
+        bool try_pop(T& val) {
+            cell_t* cell;
+            size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+            while(true) {
+                cell = &cells[pos & mask];
+                size_t seq = cell->seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+                if(diff == 0) {
+                    if(dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if(diff < 0) {
+                    return false;
+                } else {
+                    pos = dequeue_pos.load(std::memory_order_relaxed);
+                }
+            }
+            val = std::move(cell->data);
+            cell->seq.store(pos + mask + 1, std::memory_order_release);
+            not_full.notify();
+            return true;
+        }
+
+        // Push, waiting till there is room, returns false if closed
+        bool push(T val) {
+            while(!is_closed.load(std::memory_order_acquire)) {
+                if(try_push(val))
+                    return true;
+                not_full.wait([&]() {
+                    return is_closed.load(std::memory_order_acquire) || size() <= mask;
+                });
+            }
+            return false;
+        }
+
+        // Push, popping the oldest items to make room, returns false if closed
+        // Popped items are handed to drop, and we only wait while a consumer is releasing the cell we need
+        template<typename F>
+        bool push_drop_oldest(T val, F drop) {
+            while(!is_closed.load(std::memory_order_acquire)) {
+                if(try_push(val))
+                    return true;
+                T old;
+                if(try_pop(old)) {
+                    drop(old);
+                    continue;
+                }
+                not_full.wait([&]() {
+                    return is_closed.load(std::memory_order_acquire) || has_room();
+                });
+            }
+            return false;
+        }
+
+        // Pop, waiting till there is something, returns false once closed and empty
+        bool pop(T& val) {
+            while(true) {
+                if(try_pop(val))
+                    return true;
+                if(is_closed.load(std::memory_order_acquire))
+                    return try_pop(val);
+                not_empty.wait([&]() {
+                    return is_closed.load(std::memory_order_acquire) || size() > 0;
+                });
+            }
+        }
+
+        // Stop the queue, wakes anybody that is waiting
+        void close() {
+            is_closed.store(true, std::memory_order_release);
+            not_empty.notify();
+            not_full.notify();
+        }
+
+        bool closed() const {
+            return is_closed.load(std::memory_order_acquire);
+        }
+
+        // Approximate number of items
+        size_t size() const {
+            size_t e = enqueue_pos.load(std::memory_order_acquire);
+            size_t d = dequeue_pos.load(std::memory_order_acquire);
+            return (e > d)? e - d : 0;
+        }
+
+        size_t capacity() const {
+            return mask + 1;
+        }
+
+    private:
+
+        // Single slot, the sequence says whose turn it is
+        struct cell_t {
+            std::atomic<size_t> seq;
+            T data;
+        };
+
+        // Ring storage
+        std::unique_ptr<cell_t[]> cells;
+        size_t mask;
+
+        // Producer and consumer positions, padded so they don't share a cache line
+        char pad0[64];
+        std::atomic<size_t> enqueue_pos{0};
+        char pad1[64];
+        std::atomic<size_t> dequeue_pos{0};
+        char pad2[64];
+
+        // True if the cell at the producer position is free, or another producer already took it
+        bool has_room() const {
+            size_t pos = enqueue_pos.load(std::memory_order_acquire);
+            size_t seq = cells[pos & mask].seq.load(std::memory_order_acquire);
+            return (intptr_t)seq - (intptr_t)pos >= 0;
+        }
+
+        // Blocking
+        std::atomic<bool> is_closed{false};
+        WaitStrategy not_empty;
+        WaitStrategy not_full;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_MPMCQUEUE_H
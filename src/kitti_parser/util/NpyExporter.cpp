@@ -0,0 +1,225 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "kitti_parser/util/NpyExporter.h"
+#include "kitti_parser/util/WaitStrategy.h"
+#include "kitti_parser/Parser.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// File names of the OXTS fields, in the order of the table columns
+static const char* FIELD_NAMES[OxtsTable::FIELD_COUNT] = {
+    "lat", "lon", "alt", "roll", "pitch", "yaw",
+    "vn", "ve", "vf", "vl", "vu",
+    "ax", "ay", "az", "af", "al", "au",
+    "wx", "wy", "wz", "wf", "wl", "wu",
+    "pos_accuracy", "vel_accuracy",
+    "navstat", "numsats", "posmode", "velmode", "orimode"
+};
+
+
+// Write all bytes at the offset, handling short writes
+static bool write_all(int fd, const void* data, size_t size, uint64_t offset) {
+    const char* ptr = (const char*)data;
+    while(size > 0) {
+        ssize_t n = pwrite(fd, ptr, size, (off_t)offset);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        ptr += n;
+        size -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+// Create a file with the header and the data after it
+static bool write_array(const std::string& path, const std::string& header, const void* data, size_t size) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        cerr << "[kitti_parser]: Unable to create " << path << " (" << strerror(errno) << ")" << endl;
+        return false;
+    }
+    bool success = write_all(fd, header.data(), header.size(), 0) && write_all(fd, data, size, header.size());
+    if(!success)
+        cerr << "[kitti_parser]: Unable to write " << path << " (" << strerror(errno) << ")" << endl;
+    close(fd);
+    return success;
+}
+
+
+NpyExporter::NpyExporter(Parser& parser, size_t workers) : parser(parser) {
+    num_workers = (workers > 0)? workers : std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+/**
+ * Version 1.0 header, see numpy.lib.format
+ * The dict is padded with spaces so the data starts on a 64 byte boundary
+ */
+std::string NpyExporter::header(const std::string& descr, const std::vector<size_t>& shape) {
+
+    std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (";
+    for(size_t i=0; i<shape.size(); i++) {
+        if(i > 0)
+            dict += ", ";
+        dict += std::to_string(shape.at(i));
+    }
+    if(shape.size() == 1)
+        dict += ",";
+    dict += "), }";
+
+    // Magic, version and length come first, and the dict ends with a newline
+    size_t total = (10 + dict.size() + 1 + 63)/64*64;
+    dict.append(total - 10 - dict.size() - 1, ' ');
+    dict += '\n';
+    std::string out("\x93NUMPY\x01\x00", 8);
+    out += (char)(dict.size() & 0xff);
+    out += (char)(dict.size() >> 8);
+    return out + dict;
+
+}
+
+
+/**
+ * Workers take the scans in order and read them in parallel
+ * Each then waits for the scan before it to know where its points go, and writes them there.
+ * The point count is only known at the end, so the header space is reserved for the largest count.
+ * Once out of scans, the workers write the OXTS columns and timestamps.
+ */
+bool NpyExporter::write(const std::string& folder) {
+
+    if(!parser.valid()) {
+        cerr << "[kitti_parser]: Unable to export, the dataset was not loaded" << endl;
+        return false;
+    }
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(folder, ec);
+    std::string base = (!folder.empty() && *folder.rbegin() == '/')? folder : folder + "/";
+
+    // Point file, with room for the header
+    std::string path_points = base + "lidar_points.npy";
+    int fd = open(path_points.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        cerr << "[kitti_parser]: Unable to create " << path_points << " (" << strerror(errno) << ")" << endl;
+        return false;
+    }
+    const size_t reserved = header("<f4", {SIZE_MAX, 4}).size();
+
+    // What we know about each scan
+    size_t num_scans = parser.times(SENSOR_LIDAR).size();
+    std::vector<int64_t> offsets(num_scans + 1, 0);
+    std::vector<int64_t> time(num_scans), time_start(num_scans), time_end(num_scans);
+
+    // Small arrays, written once the scans are done
+    const OxtsTable& table = parser.oxts();
+    std::vector<std::function<bool()>> jobs;
+    for(int f=0; f<OxtsTable::FIELD_COUNT; f++) {
+        jobs.push_back([&, f]() {
+            const std::vector<double>& column = table.column((OxtsTable::field_t)f);
+            std::string path = base + "oxts_" + FIELD_NAMES[f] + ".npy";
+            if(f < OxtsTable::NAVSTAT)
+                return write_array(path, header("<f8", {column.size()}), column.data(), column.size()*sizeof(double));
+            std::vector<int32_t> values(column.begin(), column.end());
+            return write_array(path, header("<i4", {values.size()}), values.data(), values.size()*sizeof(int32_t));
+        });
+    }
+    const sensor_t sensors[3] = {SENSOR_STEREO_GRAY, SENSOR_STEREO_COLOR, SENSOR_GPSIMU};
+    const char* names[3] = {"stereo_gray_time.npy", "stereo_color_time.npy", "oxts_time.npy"};
+    for(int s=0; s<3; s++) {
+        jobs.push_back([&, s]() {
+            const std::vector<long>& times = parser.times(sensors[s]);
+            std::vector<int64_t> values(times.begin(), times.end());
+            return write_array(base + names[s], header("<i8", {values.size()}), values.data(), values.size()*sizeof(int64_t));
+        });
+    }
+
+    // Hand everything to the workers
+    std::atomic<size_t> next_scan{0};
+    std::atomic<size_t> placed{0};
+    std::atomic<size_t> next_job{0};
+    std::atomic<bool> success{true};
+    WaitStrategy turn;
+    std::vector<std::thread> workers;
+    for(size_t w=0; w<num_workers; w++) {
+        workers.emplace_back([&]() {
+            // Scans, the pool reuses their point buffers
+            for(size_t idx=next_scan.fetch_add(1); idx<num_scans; idx=next_scan.fetch_add(1)) {
+                std::shared_ptr<const lidar_t> scan = parser.lidar_at(idx);
+                time.at(idx) = scan->timestamp;
+                time_start.at(idx) = scan->timestamp_start;
+                time_end.at(idx) = scan->timestamp_end;
+                turn.wait([&]() { return placed.load(std::memory_order_acquire) == idx; });
+                offsets.at(idx+1) = offsets.at(idx) + (int64_t)scan->points.size();
+                placed.store(idx + 1, std::memory_order_release);
+                turn.notify();
+                size_t bytes = scan->points.size()*sizeof(std::array<float,4>);
+                if(!write_all(fd, scan->points.data(), bytes, reserved + offsets.at(idx)*sizeof(std::array<float,4>))) {
+                    cerr << "[kitti_parser]: Unable to write " << path_points << " (" << strerror(errno) << ")" << endl;
+                    success = false;
+                }
+            }
+            // Then the small arrays
+            for(size_t job=next_job.fetch_add(1); job<jobs.size(); job=next_job.fetch_add(1)) {
+                if(!jobs.at(job)())
+                    success = false;
+            }
+        });
+    }
+    for(size_t w=0; w<workers.size(); w++)
+        workers.at(w).join();
+
+    // Now that we know the count, the header of the points, padded to the space we left
+    std::string head = header("<f4", {(size_t)offsets.back(), 4});
+    head.insert(head.size() - 1, reserved - head.size(), ' ');
+    head[8] = (char)((head.size() - 10) & 0xff);
+    head[9] = (char)((head.size() - 10) >> 8);
+    if(!write_all(fd, head.data(), head.size(), 0)) {
+        cerr << "[kitti_parser]: Unable to write " << path_points << " (" << strerror(errno) << ")" << endl;
+        success = false;
+    }
+    close(fd);
+
+    // And the arrays of each scan
+    success = write_array(base + "lidar_offsets.npy", header("<i8", {offsets.size()}), offsets.data(), offsets.size()*sizeof(int64_t)) && success;
+    success = write_array(base + "lidar_time.npy", header("<i8", {time.size()}), time.data(), time.size()*sizeof(int64_t)) && success;
+    success = write_array(base + "lidar_time_start.npy", header("<i8", {time_start.size()}), time_start.data(), time_start.size()*sizeof(int64_t)) && success;
+    success = write_array(base + "lidar_time_end.npy", header("<i8", {time_end.size()}), time_end.data(), time_end.size()*sizeof(int64_t)) && success;
+    return success;
+
+}
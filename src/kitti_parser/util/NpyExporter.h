@@ -0,0 +1,68 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_NPYEXPORTER_H
+#define KITTI_PARSER_NPYEXPORTER_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+
+namespace kitti_parser {
+
+    class Parser;
+
+    /**
+     * Exports the lidar and OXTS streams of a parser into NumPy .npy files, for np.load(path, mmap_mode='r')
+     * Every header is padded to 64 bytes, so the data after it is aligned and maps without a copy.
+     * The OXTS table has one file per field, the lidar scans are one (N,4) float32 array of all points
+     * with the start of each scan in an offsets array, and each stream has its timestamps (ms).
+     * Scans are read and written by worker threads, each straight to its place in the point file.
+     */
+    class NpyExporter {
+
+    public:
+
+        // Exports the streams of this parser, the scans are read straight from storage so it can even be replaying
+        explicit NpyExporter(Parser& parser, size_t workers = 0);
+
+        // Write all arrays into the folder, created if needed, false if anything failed
+        bool write(const std::string& folder);
+
+        // Header of an array with this type (like <f4) and shape, padded to a multiple of 64 bytes
+        static std::string header(const std::string& descr, const std::vector<size_t>& shape);
+
+    private:
+
+        Parser& parser;
+        size_t num_workers;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_NPYEXPORTER_H
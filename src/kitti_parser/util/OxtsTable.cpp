@@ -0,0 +1,116 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/OxtsTable.h"
+#include <cstdlib>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+/**
+ * Reads the space separated values, the text does not need to be terminated
+ */
+bool OxtsTable::parse(const char* text, size_t length, double values[FIELD_COUNT]) {
+    std::string copy(text, length);
+    const char* p = copy.c_str();
+    int count = 0;
+    for(; count<FIELD_COUNT; count++) {
+        char* end;
+        values[count] = strtod(p, &end);
+        if(end == p)
+            break;
+        p = end;
+    }
+    for(int i=count; i<FIELD_COUNT; i++)
+        values[i] = 0.0;
+    return count == FIELD_COUNT;
+}
+
+
+void OxtsTable::append(long timestamp, const double values[FIELD_COUNT]) {
+    timestamps.push_back(timestamp);
+    for(int i=0; i<FIELD_COUNT; i++)
+        columns[i].push_back(values[i]);
+}
+
+
+size_t OxtsTable::size() const {
+    return timestamps.size();
+}
+
+
+const std::vector<long>& OxtsTable::time() const {
+    return timestamps;
+}
+
+
+const std::vector<double>& OxtsTable::column(field_t field) const {
+    return columns[field];
+}
+
+
+/**
+ * Gathers a row back into the measurement type
+ */
+void OxtsTable::record(size_t idx, gpsimu_t& out) const {
+
+    out.timestamp = timestamps.at(idx);
+
+    out.lat = columns[LAT][idx];
+    out.lon = columns[LON][idx];
+    out.alt = columns[ALT][idx];
+    out.roll = columns[ROLL][idx];
+    out.pitch = columns[PITCH][idx];
+    out.yaw = columns[YAW][idx];
+
+    out.vn = columns[VN][idx];
+    out.ve = columns[VE][idx];
+    out.vf = columns[VF][idx];
+    out.vl = columns[VL][idx];
+    out.vu = columns[VU][idx];
+
+    out.ax = columns[AX][idx];
+    out.ay = columns[AY][idx];
+    out.az = columns[AZ][idx];
+    out.af = columns[AF][idx];
+    out.al = columns[AL][idx];
+    out.au = columns[AU][idx];
+    out.wx = columns[WX][idx];
+    out.wy = columns[WY][idx];
+    out.wz = columns[WZ][idx];
+    out.wf = columns[WF][idx];
+    out.wl = columns[WL][idx];
+    out.wu = columns[WU][idx];
+
+    out.pos_accuracy = columns[POS_ACCURACY][idx];
+    out.vel_accuracy = columns[VEL_ACCURACY][idx];
+
+    out.navstat = (int)columns[NAVSTAT][idx];
+    out.numsats = (int)columns[NUMSATS][idx];
+    out.posmode = (int)columns[POSMODE][idx];
+    out.velmode = (int)columns[VELMODE][idx];
+    out.orimode = (int)columns[ORIMODE][idx];
+
+}
@@ -0,0 +1,84 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_OXTSTABLE_H
+#define KITTI_PARSER_OXTSTABLE_H
+
+#include <string>
+#include <vector>
+#include "kitti_parser/types/gpsimu_t.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * All OXTS records, stored by column
+     * Each field is its own contiguous array, so passes over the whole trajectory (poses,
+     * preintegration) walk memory in order. The columns are in the order of the OXTS files,
+     * see gpsimu_t for the meaning and units of each one.
+     */
+    class OxtsTable {
+
+    public:
+
+        // Columns, in the order they are in the files
+        typedef enum {
+            LAT = 0, LON, ALT, ROLL, PITCH, YAW,
+            VN, VE, VF, VL, VU,
+            AX, AY, AZ, AF, AL, AU,
+            WX, WY, WZ, WF, WL, WU,
+            POS_ACCURACY, VEL_ACCURACY,
+            NAVSTAT, NUMSATS, POSMODE, VELMODE, ORIMODE,
+            FIELD_COUNT
+        } field_t;
+
+        // Parses the text of a single OXTS file, returns false if it did not have all fields
+        static bool parse(const char* text, size_t length, double values[FIELD_COUNT]);
+
+        // Adds a record to the end
+        void append(long timestamp, const double values[FIELD_COUNT]);
+
+        // Number of records
+        size_t size() const;
+
+        // Timestamps of all records
+        const std::vector<long>& time() const;
+
+        // Whole column of a field
+        const std::vector<double>& column(field_t field) const;
+
+        // Single record as a measurement
+        void record(size_t idx, gpsimu_t& out) const;
+
+    private:
+
+        std::vector<long> timestamps;
+        std::vector<double> columns[FIELD_COUNT];
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_OXTSTABLE_H
@@ -0,0 +1,275 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/PackedDrive.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+#include <boost/date_time.hpp>
+#include "kitti_parser/types/sensor_t.h"
+#include "kitti_parser/util/LidarArchive.h"
+
+using namespace std;
+using namespace kitti_parser;
+
+
+const std::string PackedDrive::EXTENSION = ".kpack";
+
+// Payloads of a page or more start on page boundaries, the header has the first page to itself
+static const uint64_t PAGE_SIZE = 4096;
+static const char MAGIC[4] = {'K','P','K','1'};
+static const uint32_t VERSION = 1;
+
+// Folders of a drive, and the sensor they belong to
+static const char* FOLDERS[6] = {"image_00", "image_01", "image_02", "image_03", "velodyne_points", "oxts"};
+static const int FOLDER_SENSORS[6] = {SENSOR_STEREO_GRAY, SENSOR_STEREO_GRAY, SENSOR_STEREO_COLOR,
+                                      SENSOR_STEREO_COLOR, SENSOR_LIDAR, SENSOR_GPSIMU};
+
+
+/**
+ * Opens the container and loads the index
+ */
+PackedDrive::PackedDrive(std::string path_pack) {
+
+    // Open and check the header
+    fd = open(path_pack.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+    char header[24];
+    uint64_t index_offset, index_count;
+    if(pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header) || memcmp(header, MAGIC, 4) != 0) {
+        std::cerr << "[kitti_parser]: Invalid packed drive " << path_pack << std::endl;
+        close(fd);
+        fd = -1;
+        return;
+    }
+    uint32_t version;
+    memcpy(&version, header+4, 4);
+    if(version != VERSION) {
+        std::cerr << "[kitti_parser]: Unsupported packed drive version " << version << " in " << path_pack << std::endl;
+        close(fd);
+        fd = -1;
+        return;
+    }
+    memcpy(&index_offset, header+8, 8);
+    memcpy(&index_count, header+16, 8);
+
+    // Read the whole index, it runs to the end of the file
+    off_t size = lseek(fd, 0, SEEK_END);
+    if(size < 0 || (uint64_t)size < index_offset) {
+        close(fd);
+        fd = -1;
+        return;
+    }
+    std::vector<char> index((size_t)((uint64_t)size - index_offset));
+    if(pread(fd, index.data(), index.size(), (off_t)index_offset) != (ssize_t)index.size()) {
+        close(fd);
+        fd = -1;
+        return;
+    }
+
+    // Parse each entry
+    const char* p = index.data();
+    const char* end = p + index.size();
+    for(uint64_t i=0; i<index_count; i++) {
+        entry_t entry;
+        int32_t sensor;
+        int64_t timestamp;
+        uint32_t name_len;
+        if(end - p < 32)
+            break;
+        memcpy(&sensor, p, 4);
+        memcpy(&timestamp, p+4, 8);
+        memcpy(&entry.offset, p+12, 8);
+        memcpy(&entry.length, p+20, 8);
+        memcpy(&name_len, p+28, 4);
+        p += 32;
+        if((size_t)(end - p) < name_len)
+            break;
+        entry.size = entry.length;
+        entry.sensor = sensor;
+        entry.timestamp = (long)timestamp;
+        entries[std::string(p, name_len)] = entry;
+        p += name_len;
+    }
+
+}
+
+
+/**
+ * Parses a KITTI timestamp file into ms, same as the loader
+ */
+static std::vector<long> read_timestamps(std::string path) {
+    std::vector<long> time;
+    std::string line;
+    ifstream file_time(path);
+    while(getline(file_time,line)) {
+        if(line.empty())
+            continue;
+        boost::posix_time::ptime pt(boost::posix_time::time_from_string(line));
+        time.push_back((pt - boost::posix_time::ptime{{1970,1,1}, {}}).total_milliseconds());
+    }
+    return time;
+}
+
+
+/**
+ * Packs all sensor folders of a drive
+ * Metadata goes first, then all measurements in timestamp order
+ */
+int PackedDrive::write(std::string path_drive, std::string path_pack) {
+
+    // Files to pack, with their source path
+    std::vector<std::pair<std::string, entry_t>> files;
+    std::vector<std::string> sources;
+    boost::filesystem::path drive(path_drive);
+    for(int f=0; f<6; f++) {
+
+        // Skip sensors that are not there
+        boost::filesystem::path folder = drive / FOLDERS[f];
+        if(!boost::filesystem::is_directory(folder))
+            continue;
+
+        // Timestamp files and anything else in the folder
+        vector<boost::filesystem::path> v;
+        copy(boost::filesystem::directory_iterator(folder), boost::filesystem::directory_iterator(), back_inserter(v));
+        sort(v.begin(), v.end());
+        for(size_t i=0; i<v.size(); i++) {
+            if(!boost::filesystem::is_regular_file(v.at(i)))
+                continue;
+            entry_t entry;
+            entry.sensor = FOLDER_SENSORS[f];
+            files.push_back(std::make_pair(std::string(FOLDERS[f]) + "/" + v.at(i).filename().string(), entry));
+            sources.push_back(v.at(i).string());
+        }
+
+        // Data files, one per measurement with the compressed scan if there is one, each gets its timestamp
+        std::vector<long> time = read_timestamps((folder / "timestamps.txt").string());
+        v.clear();
+        if(boost::filesystem::is_directory(folder / "data"))
+            copy(boost::filesystem::directory_iterator(folder / "data"), boost::filesystem::directory_iterator(), back_inserter(v));
+        sort(v.begin(), v.end());
+        std::map<std::string,size_t> index;
+        size_t count = 0;
+        for(size_t i=0; i<v.size(); i++) {
+            // Scans are only raw or compressed, anything else (like a temp file of a failed compression) would shift them
+            if(FOLDER_SENSORS[f] == SENSOR_LIDAR && v.at(i).extension() != ".bin" && v.at(i).extension() != LidarArchive::EXTENSION)
+                continue;
+            std::map<std::string,size_t>::const_iterator found = index.find(v.at(i).stem().string());
+            if(found == index.end()) {
+                index[v.at(i).stem().string()] = count;
+                v.at(count++) = v.at(i);
+            } else if(v.at(i).extension() == LidarArchive::EXTENSION) {
+                v.at(found->second) = v.at(i);
+            }
+        }
+        v.resize(count);
+        for(size_t i=0; i<v.size(); i++) {
+            entry_t entry;
+            entry.sensor = FOLDER_SENSORS[f];
+            entry.timestamp = (i < time.size())? time.at(i) : -1;
+            files.push_back(std::make_pair(std::string(FOLDERS[f]) + "/data/" + v.at(i).filename().string(), entry));
+            sources.push_back(v.at(i).string());
+        }
+    }
+
+    // Order so a replay reads front to back
+    std::vector<size_t> order(files.size());
+    for(size_t i=0; i<order.size(); i++)
+        order.at(i) = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return files.at(a).second.timestamp < files.at(b).second.timestamp;
+    });
+
+    // Write to a temp file, and move into place when done
+    std::string path_temp = path_pack + ".tmp";
+    int out = open(path_temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(out < 0)
+        return -1;
+    bool success = true;
+    uint64_t pos = PAGE_SIZE;
+    std::vector<char> buffer;
+    for(size_t k=0; k<order.size() && success; k++) {
+        size_t i = order.at(k);
+        ifstream file(sources.at(i), std::ios::binary);
+        if(!file.is_open()) {
+            std::cerr << "[kitti_parser]: Unable to read " << sources.at(i) << std::endl;
+            success = false;
+            break;
+        }
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if(file.bad()) {
+            std::cerr << "[kitti_parser]: Unable to read " << sources.at(i) << std::endl;
+            success = false;
+            break;
+        }
+        // Images and scans start on a page, small files such as the OXTS records go right after the previous one
+        entry_t& entry = files.at(i).second;
+        entry.offset = (buffer.size() >= PAGE_SIZE)? (pos + PAGE_SIZE - 1)/PAGE_SIZE*PAGE_SIZE : pos;
+        entry.length = buffer.size();
+        success = buffer.empty() || pwrite(out, buffer.data(), buffer.size(), (off_t)entry.offset) == (ssize_t)buffer.size();
+        pos = entry.offset + entry.length;
+    }
+
+    // Index at the end
+    std::vector<char> index;
+    for(size_t i=0; i<files.size(); i++) {
+        const entry_t& entry = files.at(i).second;
+        const std::string& name = files.at(i).first;
+        int32_t sensor = entry.sensor;
+        int64_t timestamp = entry.timestamp;
+        uint32_t name_len = (uint32_t)name.size();
+        char rec[32];
+        memcpy(rec, &sensor, 4);
+        memcpy(rec+4, &timestamp, 8);
+        memcpy(rec+12, &entry.offset, 8);
+        memcpy(rec+20, &entry.length, 8);
+        memcpy(rec+28, &name_len, 4);
+        index.insert(index.end(), rec, rec+32);
+        index.insert(index.end(), name.begin(), name.end());
+    }
+    success = success && pwrite(out, index.data(), index.size(), (off_t)pos) == (ssize_t)index.size();
+
+    // Header last, so a partial file is never valid
+    char header[24];
+    uint64_t count = files.size();
+    memcpy(header, MAGIC, 4);
+    memcpy(header+4, &VERSION, 4);
+    memcpy(header+8, &pos, 8);
+    memcpy(header+16, &count, 8);
+    success = success && pwrite(out, header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    success = (close(out) == 0) && success;
+    if(!success || rename(path_temp.c_str(), path_pack.c_str()) != 0) {
+        unlink(path_temp.c_str());
+        return -1;
+    }
+    return (int)files.size();
+
+}
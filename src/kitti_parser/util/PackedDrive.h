@@ -0,0 +1,60 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_PACKEDDRIVE_H
+#define KITTI_PARSER_PACKEDDRIVE_H
+
+#include <string>
+#include "kitti_parser/util/Storage.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * A whole KITTI drive packed into a single file (.kpack)
+     * Every file of the drive is stored as-is in timestamp order, so a replay reads the container front to back.
+     * Images and scans start on their own page, small files like the OXTS records are packed back to back. The index
+     * at the end has the sensor, timestamp, offset, length and original relative path of each file, and the header at
+     * the front points to it. Reads are a single pread, so there is no open or lookup per file.
+     * Use it through the Storage interface, with paths relative to the drive folder.
+     */
+    class PackedDrive : public ArchiveStorage {
+
+    public:
+
+        // File extension of packed drives
+        static const std::string EXTENSION;
+
+        // Default constructor, opens the container and reads its index
+        PackedDrive(std::string path_pack);
+
+        // Pack a drive folder into a container, returns the number of files packed or -1 on error
+        static int write(std::string path_drive, std::string path_pack);
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_PACKEDDRIVE_H
@@ -0,0 +1,99 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_POOL_H
+#define KITTI_PARSER_POOL_H
+
+#include <mutex>
+#include <memory>
+#include <vector>
+
+
+namespace kitti_parser {
+
+    /**
+     * Free list of measurements, so their buffers are reused instead of allocated for each message
+     * Anything taken from the pool is a plain new'ed object, so it can also just be deleted.
+     * Given back objects keep their contents, the loader overwrites them.
+     */
+    template<typename T>
+    class Pool {
+
+    public:
+
+        // Keeps at most this many free objects around
+        explicit Pool(size_t capacity) : capacity(capacity) {}
+
+        ~Pool() {
+            for(size_t i=0; i<free.size(); i++)
+                delete free.at(i);
+        }
+
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        // A free object if there is one, else a new one
+        T* take() {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if(!free.empty()) {
+                    T* val = free.back();
+                    free.pop_back();
+                    return val;
+                }
+            }
+            return new T();
+        }
+
+        // Return an object, deleted if the pool is full
+        void give(T* val) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if(free.size() < capacity) {
+                    free.push_back(val);
+                    return;
+                }
+            }
+            delete val;
+        }
+
+        // Shared read only handle that goes back to the pool once the last owner lets go
+        // The handle keeps the pool alive, so it can outlive whoever made it
+        static std::shared_ptr<const T> share(const std::shared_ptr<Pool>& pool, T* val) {
+            return std::shared_ptr<const T>(val, [pool](const T* p) { pool->give(const_cast<T*>(p)); });
+        }
+
+    private:
+
+        size_t capacity;
+        std::mutex mtx;
+        std::vector<T*> free;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_POOL_H
@@ -0,0 +1,257 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/PosixStorage.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// O_DIRECT needs the buffer, offset and length aligned, a page covers all common block sizes
+static const uint64_t DIRECT_ALIGN = 4096;
+
+// Most aligned buffers kept for reuse, enough for a few readers at once
+static const size_t MAX_POOLED = 8;
+
+
+/**
+ * Reads until we have all the bytes, or the file ends
+ */
+static bool pread_all(int fd, char* out, size_t length, uint64_t offset) {
+    size_t done = 0;
+    while(done < length) {
+        ssize_t n = pread(fd, out + done, length - done, (off_t)(offset + done));
+        if(n <= 0)
+            return false;
+        done += (size_t)n;
+    }
+    return true;
+}
+
+
+PosixStorage::~PosixStorage() {
+    for(size_t i=0; i<pool.size(); i++)
+        free(pool.at(i).first);
+}
+
+
+/**
+ * Opens with O_DIRECT when bypassing the cache
+ * Some file systems (such as tmpfs) do not support it, those are opened normally
+ */
+int PosixStorage::open_file(const std::string& path, bool& direct) const {
+    direct = false;
+    if(cache == CACHE_DIRECT) {
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECT);
+        if(fd >= 0) {
+            direct = true;
+            return fd;
+        }
+        if(errno != EINVAL)
+            return fd;
+    }
+    return open(path.c_str(), O_RDONLY);
+}
+
+
+/**
+ * Reads the aligned range around what we want into a pooled buffer, then copies it out
+ * The last block can come back short at the end of the file
+ */
+bool PosixStorage::read_direct(int fd, uint64_t offset, size_t length, char* out) {
+
+    // Aligned range to read
+    uint64_t start = offset/DIRECT_ALIGN*DIRECT_ALIGN;
+    size_t size = (size_t)((offset + length - start + DIRECT_ALIGN - 1)/DIRECT_ALIGN*DIRECT_ALIGN);
+
+    // Take the smallest pooled buffer that fits, else make one
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    {
+        std::lock_guard<std::mutex> guard(lock_pool);
+        size_t best = pool.size();
+        for(size_t i=0; i<pool.size(); i++) {
+            if(pool.at(i).second >= size && (best == pool.size() || pool.at(i).second < pool.at(best).second))
+                best = i;
+        }
+        if(best < pool.size()) {
+            buffer = pool.at(best).first;
+            capacity = pool.at(best).second;
+            pool.erase(pool.begin() + best);
+        }
+    }
+    if(buffer == nullptr) {
+        // Sizes are rounded up to a power of two, so a buffer fits the files of similar size after it
+        capacity = DIRECT_ALIGN;
+        while(capacity < size)
+            capacity *= 2;
+        void* ptr = nullptr;
+        if(posix_memalign(&ptr, DIRECT_ALIGN, capacity) != 0)
+            return false;
+        buffer = (char*)ptr;
+    }
+
+    // Read until we have what we want, or the file ends
+    size_t done = 0;
+    size_t want = (size_t)(offset - start) + length;
+    while(done < want) {
+        ssize_t n = pread(fd, buffer + done, size - done, (off_t)(start + done));
+        if(n <= 0)
+            break;
+        done += (size_t)n;
+    }
+    bool success = (done >= want);
+    if(success)
+        memcpy(out, buffer + (offset - start), length);
+
+    // Back into the pool, if full we drop the smallest buffer since the larger one fits more files
+    std::lock_guard<std::mutex> guard(lock_pool);
+    pool.push_back(std::make_pair(buffer, capacity));
+    if(pool.size() > MAX_POOLED) {
+        size_t smallest = 0;
+        for(size_t i=1; i<pool.size(); i++) {
+            if(pool.at(i).second < pool.at(smallest).second)
+                smallest = i;
+        }
+        free(pool.at(smallest).first);
+        pool.erase(pool.begin() + smallest);
+    }
+    return success;
+
+}
+
+
+void PosixStorage::close_file(int fd) const {
+    if(cache == CACHE_DROP || cache == CACHE_DIRECT)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+
+/**
+ * Lists a folder, sorted since directory iteration is not ordered on some file systems
+ */
+std::vector<std::string> PosixStorage::list(const std::string& path) {
+    std::vector<std::string> names;
+    DIR* dir = opendir(path.c_str());
+    if(dir == nullptr)
+        return names;
+    struct dirent* entry;
+    while((entry = readdir(dir)) != nullptr) {
+        std::string name(entry->d_name);
+        if(name == "." || name == "..")
+            continue;
+        names.push_back(name);
+    }
+    closedir(dir);
+    sort(names.begin(), names.end());
+    return names;
+}
+
+
+bool PosixStorage::stat(const std::string& path, stat_t& st) {
+    struct stat info;
+    if(::stat(path.c_str(), &info) != 0)
+        return false;
+    st.is_folder = S_ISDIR(info.st_mode);
+    st.size = (uint64_t)info.st_size;
+    return true;
+}
+
+
+bool PosixStorage::read(const std::string& path, uint64_t offset, size_t length, char* out) {
+    bool direct;
+    int fd = open_file(path, direct);
+    if(fd < 0)
+        return false;
+    bool success = (direct)? read_direct(fd, offset, length, out) : pread_all(fd, out, length, offset);
+    close_file(fd);
+    return success;
+}
+
+
+/**
+ * Opens once, and sizes the buffer from the open file
+ */
+bool PosixStorage::read_all(const std::string& path, std::vector<char>& out) {
+    out.clear();
+    bool direct;
+    int fd = open_file(path, direct);
+    if(fd < 0)
+        return false;
+    struct stat info;
+    bool success = (fstat(fd, &info) == 0 && !S_ISDIR(info.st_mode));
+    if(success) {
+        out.resize((size_t)info.st_size);
+        success = (direct)? read_direct(fd, 0, out.size(), out.data()) : pread_all(fd, out.data(), out.size(), 0);
+    }
+    close_file(fd);
+    return success;
+}
+
+
+/**
+ * Maps the file, it is unmapped once nothing points to it
+ * A mapping goes through the page cache, so we do not map when we are not caching
+ */
+std::shared_ptr<const mapping_t> PosixStorage::map(const std::string& path) {
+    if(cache != CACHE_NORMAL)
+        return std::shared_ptr<const mapping_t>();
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return std::shared_ptr<const mapping_t>();
+    struct stat info;
+    void* data = MAP_FAILED;
+    if(fstat(fd, &info) == 0 && info.st_size > 0)
+        data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return std::shared_ptr<const mapping_t>();
+    mapping_t* mapping = new mapping_t{(const char*)data, (size_t)info.st_size};
+    return std::shared_ptr<const mapping_t>(mapping, [](const mapping_t* m) {
+        munmap((void*)m->data, m->size);
+        delete m;
+    });
+}
+
+
+/**
+ * Asks the kernel to start reading the file
+ */
+void PosixStorage::will_need(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}
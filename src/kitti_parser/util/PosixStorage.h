@@ -0,0 +1,75 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_POSIXSTORAGE_H
+#define KITTI_PARSER_POSIXSTORAGE_H
+
+#include <mutex>
+#include <vector>
+#include "kitti_parser/util/Storage.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Plain files and folders on disk
+     * Paths are used as given, so they can be absolute or relative to the working directory.
+     * Whole files are read with a single pread into a buffer of the right size, and files can
+     * be mapped so large ones are not copied at all. When not caching, each file is dropped from
+     * the page cache once read, or read with O_DIRECT through a pool of aligned buffers.
+     */
+    class PosixStorage : public Storage {
+
+    public:
+
+        ~PosixStorage() override;
+
+        std::vector<std::string> list(const std::string& path) override;
+        bool stat(const std::string& path, stat_t& st) override;
+        bool read(const std::string& path, uint64_t offset, size_t length, char* out) override;
+        bool read_all(const std::string& path, std::vector<char>& out) override;
+        std::shared_ptr<const mapping_t> map(const std::string& path) override;
+        void will_need(const std::string& path) override;
+
+    private:
+
+        // Aligned buffers for O_DIRECT reads, reused so we do not allocate per file, a power of two in size and a few at most
+        std::mutex lock_pool;
+        std::vector<std::pair<char*, size_t>> pool;
+
+        // Opens a file for reading, with O_DIRECT if we are bypassing the cache
+        int open_file(const std::string& path, bool& direct) const;
+
+        // Reads from an O_DIRECT file, through an aligned buffer
+        bool read_direct(int fd, uint64_t offset, size_t length, char* out);
+
+        // Done reading a file, drops it from the page cache if we are not caching
+        void close_file(int fd) const;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_POSIXSTORAGE_H
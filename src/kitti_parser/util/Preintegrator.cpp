@@ -0,0 +1,192 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/Preintegrator.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+/**
+ * C = A*B for row major 3x3
+ */
+static inline void mul(const double* A, const double* B, double* C) {
+    for(int r=0; r<3; r++)
+        for(int c=0; c<3; c++)
+            C[3*r+c] = A[3*r]*B[c] + A[3*r+1]*B[3+c] + A[3*r+2]*B[6+c];
+}
+
+
+/**
+ * C = A'*B for row major 3x3
+ */
+static inline void mul_t(const double* A, const double* B, double* C) {
+    for(int r=0; r<3; r++)
+        for(int c=0; c<3; c++)
+            C[3*r+c] = A[r]*B[c] + A[3+r]*B[3+c] + A[6+r]*B[6+c];
+}
+
+
+/**
+ * Skew symmetric matrix of a vector
+ */
+static inline void skew(double x, double y, double z, double* S) {
+    S[0] = 0;  S[1] = -z; S[2] = y;
+    S[3] = z;  S[4] = 0;  S[5] = -x;
+    S[6] = -y; S[7] = x;  S[8] = 0;
+}
+
+
+/**
+ * Rotation of phi (Rodrigues), and the right Jacobian of SO(3) at phi
+ */
+static inline void exp_so3(double x, double y, double z, double* R, double* Jr) {
+    double S[9], S2[9];
+    skew(x, y, z, S);
+    mul(S, S, S2);
+    double theta2 = x*x + y*y + z*z;
+    double theta = sqrt(theta2);
+    double a, b, c, d;
+    if(theta < 1e-8) {
+        a = 1.0; b = 0.5; c = 0.5; d = 1.0/6.0;
+    } else {
+        a = sin(theta)/theta;
+        b = (1.0 - cos(theta))/theta2;
+        c = b;
+        d = (theta - sin(theta))/(theta2*theta);
+    }
+    for(int i=0; i<9; i++) {
+        double I = (i % 4 == 0)? 1.0 : 0.0;
+        R[i] = I + a*S[i] + b*S2[i];
+        Jr[i] = I - c*S[i] + d*S2[i];
+    }
+}
+
+
+/**
+ * Integrates all samples that overlap the interval
+ */
+bool Preintegrator::integrate(const OxtsTable& table, size_t begin, size_t end,
+                              long t_start, long t_end, preintegration_t& out) {
+
+    // Start at the sample held at the start time
+    const std::vector<long>& time = table.time();
+    end = std::min(end, table.size());
+    if(begin >= end || t_end <= t_start || t_end < time.at(begin) || t_start > time.at(end-1))
+        return false;
+    size_t first = (size_t)(std::upper_bound(time.begin()+begin, time.begin()+end, t_start) - time.begin());
+    first = (first > begin)? first - 1 : begin;
+    size_t last = (size_t)(std::lower_bound(time.begin()+first, time.begin()+end, t_end) - time.begin());
+    size_t count = last - first;
+    if(count == 0)
+        return false;
+
+    // Columns we need
+    const double* ax = table.column(OxtsTable::AX).data();
+    const double* ay = table.column(OxtsTable::AY).data();
+    const double* az = table.column(OxtsTable::AZ).data();
+    const double* wx = table.column(OxtsTable::WX).data();
+    const double* wy = table.column(OxtsTable::WY).data();
+    const double* wz = table.column(OxtsTable::WZ).data();
+
+    // First pass, how long each sample is held and its rotation increment
+    steps.resize(count);
+    increments.resize(9*count);
+    jacobians.resize(9*count);
+    for(size_t i=0; i<count; i++) {
+        size_t k = first + i;
+        long t0 = std::max(time[k], t_start);
+        long t1 = (k + 1 < end)? std::min(time[k+1], t_end) : t_end;
+        steps[i] = std::max(0L, t1 - t0)/1000.0;
+    }
+    for(size_t i=0; i<count; i++) {
+        size_t k = first + i;
+        exp_so3(wx[k]*steps[i], wy[k]*steps[i], wz[k]*steps[i], &increments[9*i], &jacobians[9*i]);
+    }
+
+    // Start from identity and zero
+    static const double IDENTITY[9] = {1,0,0, 0,1,0, 0,0,1};
+    memcpy(out.dR, IDENTITY, sizeof(IDENTITY));
+    memset(out.dv, 0, sizeof(out.dv));
+    memset(out.dp, 0, sizeof(out.dp));
+    memset(out.dR_dbg, 0, sizeof(out.dR_dbg));
+    memset(out.dv_dba, 0, sizeof(out.dv_dba));
+    memset(out.dv_dbg, 0, sizeof(out.dv_dbg));
+    memset(out.dp_dba, 0, sizeof(out.dp_dba));
+    memset(out.dp_dbg, 0, sizeof(out.dp_dbg));
+
+    // Second pass, the running sums
+    // Jacobians use the rotation before this sample, so they are updated first
+    double total = 0;
+    for(size_t i=0; i<count; i++) {
+        size_t k = first + i;
+        double dt = steps[i];
+        double dt2 = 0.5*dt*dt;
+        total += dt;
+
+        // Acceleration rotated into the start frame, and dR*[a]x*dR_dbg
+        double a[3] = {ax[k], ay[k], az[k]};
+        double Ra[3], S[9], RS[9], RSJ[9];
+        for(int r=0; r<3; r++)
+            Ra[r] = out.dR[3*r]*a[0] + out.dR[3*r+1]*a[1] + out.dR[3*r+2]*a[2];
+        skew(a[0], a[1], a[2], S);
+        mul(out.dR, S, RS);
+        mul(RS, out.dR_dbg, RSJ);
+
+        // Position and velocity Jacobians
+        for(int i9=0; i9<9; i9++) {
+            out.dp_dba[i9] += out.dv_dba[i9]*dt - out.dR[i9]*dt2;
+            out.dp_dbg[i9] += out.dv_dbg[i9]*dt - RSJ[i9]*dt2;
+            out.dv_dba[i9] -= out.dR[i9]*dt;
+            out.dv_dbg[i9] -= RSJ[i9]*dt;
+        }
+
+        // Position and velocity
+        for(int r=0; r<3; r++) {
+            out.dp[r] += out.dv[r]*dt + Ra[r]*dt2;
+            out.dv[r] += Ra[r]*dt;
+        }
+
+        // Rotation, dR_dbg = dRinc'*dR_dbg - Jr*dt
+        const double* inc = &increments[9*i];
+        const double* Jr = &jacobians[9*i];
+        double J[9], R[9];
+        mul_t(inc, out.dR_dbg, J);
+        for(int i9=0; i9<9; i9++)
+            out.dR_dbg[i9] = J[i9] - Jr[i9]*dt;
+        mul(out.dR, inc, R);
+        memcpy(out.dR, R, sizeof(R));
+    }
+
+    // Done
+    out.timestamp_start = t_start;
+    out.timestamp_end = t_end;
+    out.num_samples = (int)count;
+    out.dt = total;
+    return true;
+
+}
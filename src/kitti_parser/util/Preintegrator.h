@@ -0,0 +1,65 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_PREINTEGRATOR_H
+#define KITTI_PARSER_PREINTEGRATOR_H
+
+#include <vector>
+#include <cstddef>
+#include "kitti_parser/types/preintegration_t.h"
+#include "kitti_parser/util/OxtsTable.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Preintegrates the OXTS accelerations and angular rates between two times
+     * Follows the on-manifold preintegration of Forster et al. (RSS 2015), with zero bias as the
+     * linearization point. Each sample is held until the next one. The rotation increments and
+     * their right Jacobians do not depend on each other, so they are done in a first pass over
+     * the columns, and only the running sums are done one sample at a time.
+     * Keeps scratch space between calls, so use one per thread.
+     */
+    class Preintegrator {
+
+    public:
+
+        // Integrates over [t_start, t_end] (ms) using the records [begin, end) of the table
+        // Returns false if there are no samples in the interval
+        bool integrate(const OxtsTable& table, size_t begin, size_t end,
+                       long t_start, long t_end, preintegration_t& out);
+
+    private:
+
+        // Per sample scratch, 9 values each
+        std::vector<double> increments;
+        std::vector<double> jacobians;
+        std::vector<double> steps;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_PREINTEGRATOR_H
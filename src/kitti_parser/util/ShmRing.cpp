@@ -0,0 +1,561 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "kitti_parser/util/ShmRing.h"
+#include <atomic>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// Layout of the segment, shared by both sides
+static const uint32_t SHM_MAGIC = 0x4b53484d;
+static const uint32_t SHM_VERSION = 1;
+static const size_t MAX_SUBSCRIBERS = 32;
+static const uint64_t CURSOR_JOINING = UINT64_MAX;
+
+// How long to sleep before checking if the other side is still alive (ms)
+static const long LIVENESS_MS = 100;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "Shared memory needs lock free atomics");
+
+// Next message a subscriber wants, everything before it is released
+struct alignas(64) cursor_t {
+    std::atomic<int32_t> pid;
+    std::atomic<uint64_t> next;
+};
+
+// First page of the segment
+struct control_t {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t num_slots;
+    uint64_t slot_size;
+    uint64_t slots_offset;
+    int32_t publisher;
+    std::atomic<uint32_t> closed;
+    // Messages published, and the futex bumped with each
+    alignas(64) std::atomic<uint64_t> head;
+    std::atomic<uint32_t> published;
+    std::atomic<uint32_t> sub_sleepers;
+    // Futex bumped on each release
+    alignas(64) std::atomic<uint32_t> released;
+    std::atomic<uint32_t> pub_sleepers;
+    cursor_t cursors[MAX_SUBSCRIBERS];
+};
+
+// Start of each slot, the payload follows
+struct alignas(64) slot_t {
+    uint64_t seq;
+    int32_t sensor;
+    int64_t timestamp;
+    uint64_t size;
+};
+
+// Payload of a stereo frame, the pixels of each image follow at their offset
+typedef struct {
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    uint64_t step;
+    uint64_t offset;
+} shm_image_t;
+
+struct alignas(64) shm_stereo_t {
+    int64_t timestamp;
+    int32_t is_color;
+    int32_t width;
+    int32_t height;
+    int32_t has_imu;
+    preintegration_t imu;
+    shm_image_t left;
+    shm_image_t right;
+};
+
+// Payload of a lidar scan, the points follow
+struct alignas(16) shm_lidar_t {
+    int64_t timestamp;
+    int64_t timestamp_start;
+    int64_t timestamp_end;
+    uint64_t num_points;
+};
+
+
+static size_t align_up(size_t val, size_t to) {
+    return (val + to - 1)/to*to;
+}
+
+static size_t page_size() {
+    return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// Names have to start with a slash
+static string shm_name(const string& name) {
+    return (!name.empty() && name[0] == '/')? name : "/" + name;
+}
+
+// Zombies still answer kill(), so we also check their state if we can
+static bool alive(int32_t pid) {
+    if(pid <= 0 || (kill(pid, 0) != 0 && errno == ESRCH))
+        return false;
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE* file = fopen(path, "r");
+    if(file == nullptr)
+        return true;
+    char buf[512];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, file);
+    fclose(file);
+    buf[n] = '\0';
+    const char* end = strrchr(buf, ')');
+    return end == nullptr || end[1] != ' ' || end[2] != 'Z';
+}
+
+// Sleep while the futex is still the value we saw, or the timeout runs out
+static void futex_wait(std::atomic<uint32_t>* addr, uint32_t seen, long timeout_ms) {
+    struct timespec ts;
+    ts.tv_sec = timeout_ms/1000;
+    ts.tv_nsec = (timeout_ms%1000)*1000000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, seen, &ts, nullptr, 0);
+}
+
+static void futex_wake(std::atomic<uint32_t>* addr) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+
+/**
+ * Creates the segment and lays out the control page
+ * The control page is filled in before the magic is set, which is what subscribers check
+ */
+ShmPublisher::ShmPublisher(std::string name_shm, size_t num_slots, size_t slot_size) {
+
+    // Replace anything left over from a publisher that died
+    name = shm_name(name_shm);
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd < 0) {
+        cerr << "[kitti_parser]: Unable to create shared memory " << name << " (" << strerror(errno) << ")" << endl;
+        return;
+    }
+
+    // Size it, slots start on their own page so subscribers can map them read only
+    num_slots = std::max(num_slots, (size_t)1);
+    slot_size = align_up(std::max(slot_size, sizeof(slot_t)), 64);
+    size_t offset = align_up(sizeof(control_t), page_size());
+    length = offset + num_slots*slot_size;
+    if(ftruncate(fd, (off_t)length) != 0) {
+        cerr << "[kitti_parser]: Unable to size shared memory " << name << " (" << strerror(errno) << ")" << endl;
+        close(fd);
+        shm_unlink(name.c_str());
+        fd = -1;
+        return;
+    }
+    void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(ptr == MAP_FAILED) {
+        close(fd);
+        shm_unlink(name.c_str());
+        fd = -1;
+        return;
+    }
+    base = (char*)ptr;
+
+    // The new segment is all zeros, so only set what is not
+    control_t* ctrl = (control_t*)base;
+    ctrl->version = SHM_VERSION;
+    ctrl->num_slots = num_slots;
+    ctrl->slot_size = slot_size;
+    ctrl->slots_offset = offset;
+    ctrl->publisher = (int32_t)getpid();
+    for(size_t i=0; i<MAX_SUBSCRIBERS; i++)
+        ctrl->cursors[i].next.store(CURSOR_JOINING);
+    std::atomic_thread_fence(std::memory_order_release);
+    ctrl->magic = SHM_MAGIC;
+
+}
+
+
+ShmPublisher::~ShmPublisher() {
+    if(base != nullptr) {
+        control_t* ctrl = (control_t*)base;
+        ctrl->closed.store(1);
+        ctrl->published.fetch_add(1);
+        futex_wake(&ctrl->published);
+        munmap(base, length);
+    }
+    if(fd >= 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+    }
+}
+
+
+bool ShmPublisher::valid() const {
+    return base != nullptr;
+}
+
+
+uint64_t ShmPublisher::published() const {
+    return (base != nullptr)? ((control_t*)base)->head.load() : 0;
+}
+
+
+/**
+ * Waits till every subscriber has released the message that was last in the slot
+ * The release futex is read before checking, so a release in between wakes us right away.
+ * If we are still waiting after a while, we check that the subscribers we wait on are alive.
+ */
+char* ShmPublisher::begin(size_t size) {
+
+    control_t* ctrl = (control_t*)base;
+    if(base == nullptr || sizeof(slot_t) + size > ctrl->slot_size)
+        return nullptr;
+
+    // Wait for the slowest subscriber
+    uint64_t seq = ctrl->head.load();
+    while(true) {
+        uint32_t seen = ctrl->released.load();
+        bool ready = true;
+        for(size_t i=0; i<MAX_SUBSCRIBERS; i++) {
+            int32_t pid = ctrl->cursors[i].pid.load();
+            uint64_t next = ctrl->cursors[i].next.load();
+            if(pid == 0 || next == CURSOR_JOINING || seq < next + ctrl->num_slots)
+                continue;
+            ready = false;
+            break;
+        }
+        if(ready)
+            break;
+        ctrl->pub_sleepers.fetch_add(1);
+        futex_wait(&ctrl->released, seen, LIVENESS_MS);
+        ctrl->pub_sleepers.fetch_sub(1);
+        // Drop subscribers that are gone
+        for(size_t i=0; i<MAX_SUBSCRIBERS; i++) {
+            int32_t pid = ctrl->cursors[i].pid.load();
+            if(pid != 0 && !alive(pid)) {
+                ctrl->cursors[i].next.store(CURSOR_JOINING);
+                ctrl->cursors[i].pid.compare_exchange_strong(pid, 0);
+            }
+        }
+    }
+
+    // Payload of the slot
+    return base + ctrl->slots_offset + (seq % ctrl->num_slots)*ctrl->slot_size + sizeof(slot_t);
+
+}
+
+
+/**
+ * Fills in the slot header and moves the head, then wakes any subscriber that is asleep
+ */
+void ShmPublisher::commit(sensor_t sensor, long timestamp, size_t size) {
+    control_t* ctrl = (control_t*)base;
+    uint64_t seq = ctrl->head.load();
+    slot_t* slot = (slot_t*)(base + ctrl->slots_offset + (seq % ctrl->num_slots)*ctrl->slot_size);
+    slot->seq = seq;
+    slot->sensor = (int32_t)sensor;
+    slot->timestamp = (int64_t)timestamp;
+    slot->size = size;
+    ctrl->head.store(seq + 1);
+    ctrl->published.fetch_add(1);
+    if(ctrl->sub_sleepers.load() > 0)
+        futex_wake(&ctrl->published);
+}
+
+
+/**
+ * Stereo frames are a header followed by the rows of each image, packed with no padding
+ */
+bool ShmPublisher::publish(const stereo_t& frame) {
+
+    // Size of everything
+    const cv::Mat* images[2] = {&frame.image_left, &frame.image_right};
+    size_t bytes[2];
+    for(int i=0; i<2; i++)
+        bytes[i] = images[i]->total()*images[i]->elemSize();
+    size_t offset_right = align_up(sizeof(shm_stereo_t) + bytes[0], 64);
+    size_t size = offset_right + bytes[1];
+
+    // Get the slot
+    char* payload = begin(size);
+    if(payload == nullptr) {
+        cerr << "[kitti_parser]: Stereo frame of " << size << " bytes does not fit in a shared memory slot" << endl;
+        return false;
+    }
+
+    // Header
+    shm_stereo_t* head = (shm_stereo_t*)payload;
+    head->timestamp = frame.timestamp;
+    head->is_color = frame.is_color;
+    head->width = frame.width;
+    head->height = frame.height;
+    head->has_imu = frame.has_imu;
+    head->imu = frame.imu;
+
+    // Images, row by row in case they are not continuous
+    shm_image_t* heads[2] = {&head->left, &head->right};
+    size_t offsets[2] = {sizeof(shm_stereo_t), offset_right};
+    for(int i=0; i<2; i++) {
+        const cv::Mat& image = *images[i];
+        size_t row = image.cols*image.elemSize();
+        heads[i]->rows = image.rows;
+        heads[i]->cols = image.cols;
+        heads[i]->type = image.type();
+        heads[i]->step = row;
+        heads[i]->offset = offsets[i];
+        for(int r=0; r<image.rows; r++)
+            memcpy(payload + offsets[i] + r*row, image.ptr(r), row);
+    }
+
+    commit(frame.is_color? SENSOR_STEREO_COLOR : SENSOR_STEREO_GRAY, frame.timestamp, size);
+    return true;
+
+}
+
+
+bool ShmPublisher::publish(const lidar_t& scan) {
+
+    // Get the slot
+    size_t size = sizeof(shm_lidar_t) + scan.points.size()*sizeof(std::array<float,4>);
+    char* payload = begin(size);
+    if(payload == nullptr) {
+        cerr << "[kitti_parser]: Lidar scan of " << size << " bytes does not fit in a shared memory slot" << endl;
+        return false;
+    }
+
+    // Header and the points right after
+    shm_lidar_t* head = (shm_lidar_t*)payload;
+    head->timestamp = scan.timestamp;
+    head->timestamp_start = scan.timestamp_start;
+    head->timestamp_end = scan.timestamp_end;
+    head->num_points = scan.points.size();
+    if(!scan.points.empty())
+        memcpy(payload + sizeof(shm_lidar_t), scan.points.data(), scan.points.size()*sizeof(std::array<float,4>));
+
+    commit(SENSOR_LIDAR, scan.timestamp, size);
+    return true;
+
+}
+
+
+bool ShmPublisher::publish(const gpsimu_t& meas) {
+    char* payload = begin(sizeof(gpsimu_t));
+    if(payload == nullptr)
+        return false;
+    memcpy(payload, &meas, sizeof(gpsimu_t));
+    commit(SENSOR_GPSIMU, meas.timestamp, sizeof(gpsimu_t));
+    return true;
+}
+
+
+/**
+ * Maps the control page writable and the slots read only, then takes a free cursor
+ * The cursor holds the publisher back while we join, so we start at the next message without it being overwritten.
+ */
+ShmSubscriber::ShmSubscriber(std::string name_shm) {
+
+    // Open the segment
+    std::string name = shm_name(name_shm);
+    fd = shm_open(name.c_str(), O_RDWR, 0);
+    if(fd < 0) {
+        cerr << "[kitti_parser]: Unable to open shared memory " << name << " (" << strerror(errno) << ")" << endl;
+        return;
+    }
+    struct stat st;
+    length_control = align_up(sizeof(control_t), page_size());
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < length_control) {
+        cerr << "[kitti_parser]: Shared memory " << name << " is not from a publisher" << endl;
+        return;
+    }
+
+    // Control page
+    void* ptr = mmap(nullptr, length_control, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(ptr == MAP_FAILED)
+        return;
+    control = (char*)ptr;
+    control_t* ctrl = (control_t*)control;
+    if(ctrl->magic != SHM_MAGIC || ctrl->version != SHM_VERSION
+       || ctrl->slots_offset + ctrl->num_slots*ctrl->slot_size > (uint64_t)st.st_size) {
+        cerr << "[kitti_parser]: Shared memory " << name << " is not from a publisher" << endl;
+        munmap(control, length_control);
+        control = nullptr;
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // Slots, read only
+    length_slots = ctrl->num_slots*ctrl->slot_size;
+    ptr = mmap(nullptr, length_slots, PROT_READ, MAP_SHARED, fd, (off_t)ctrl->slots_offset);
+    if(ptr == MAP_FAILED) {
+        munmap(control, length_control);
+        control = nullptr;
+        return;
+    }
+    slots = (const char*)ptr;
+
+    // Take a cursor
+    int32_t pid = (int32_t)getpid();
+    for(size_t i=0; i<MAX_SUBSCRIBERS && cursor < 0; i++) {
+        int32_t expected = 0;
+        if(ctrl->cursors[i].pid.compare_exchange_strong(expected, pid))
+            cursor = (int)i;
+    }
+    if(cursor < 0) {
+        cerr << "[kitti_parser]: Shared memory " << name << " has no room for more subscribers" << endl;
+        return;
+    }
+
+    // Start at the head, but the publisher could wrap over it between reading the head and storing it
+    // So first hold every slot with a cursor at zero, after that it can at most finish the message it is on
+    ctrl->cursors[cursor].next.store(0);
+    ctrl->cursors[cursor].next.store(ctrl->head.load());
+
+}
+
+
+ShmSubscriber::~ShmSubscriber() {
+    if(control != nullptr && cursor >= 0) {
+        control_t* ctrl = (control_t*)control;
+        ctrl->cursors[cursor].next.store(CURSOR_JOINING);
+        ctrl->cursors[cursor].pid.store(0);
+        ctrl->released.fetch_add(1);
+        if(ctrl->pub_sleepers.load() > 0)
+            futex_wake(&ctrl->released);
+    }
+    if(slots != nullptr)
+        munmap((void*)slots, length_slots);
+    if(control != nullptr)
+        munmap(control, length_control);
+    if(fd >= 0)
+        close(fd);
+}
+
+
+bool ShmSubscriber::valid() const {
+    return slots != nullptr && cursor >= 0;
+}
+
+
+/**
+ * Moves our cursor past the message we hold, and wakes the publisher if it waits on it
+ */
+void ShmSubscriber::release() {
+    if(!holding)
+        return;
+    holding = false;
+    control_t* ctrl = (control_t*)control;
+    ctrl->cursors[cursor].next.fetch_add(1);
+    ctrl->released.fetch_add(1);
+    if(ctrl->pub_sleepers.load() > 0)
+        futex_wake(&ctrl->released);
+}
+
+
+/**
+ * Waits for the message at our cursor and points the view at it
+ * The publish futex is read before checking the head, so a publish in between wakes us right away.
+ */
+bool ShmSubscriber::next(shm_message_t& msg, long timeout_ms) {
+
+    if(!valid())
+        return false;
+    release();
+
+    // Wait till it is published
+    control_t* ctrl = (control_t*)control;
+    uint64_t seq = ctrl->cursors[cursor].next.load();
+    long waited = 0;
+    while(ctrl->head.load() <= seq) {
+        uint32_t seen = ctrl->published.load();
+        if(ctrl->head.load() > seq)
+            break;
+        if(ctrl->closed.load() != 0 || !alive(ctrl->publisher))
+            return false;
+        if(timeout_ms >= 0 && waited >= timeout_ms)
+            return false;
+        long sleep = (timeout_ms >= 0)? std::min(LIVENESS_MS, timeout_ms - waited) : LIVENESS_MS;
+        ctrl->sub_sleepers.fetch_add(1);
+        futex_wait(&ctrl->published, seen, sleep);
+        ctrl->sub_sleepers.fetch_sub(1);
+        waited += sleep;
+    }
+    holding = true;
+
+    // Point the view into the slot
+    const char* start = slots + (seq % ctrl->num_slots)*ctrl->slot_size;
+    const slot_t* slot = (const slot_t*)start;
+    const char* payload = start + sizeof(slot_t);
+    msg.seq = slot->seq;
+    msg.sensor = (sensor_t)slot->sensor;
+    msg.timestamp = (long)slot->timestamp;
+    msg.stereo = stereo_t();
+    msg.gpsimu = nullptr;
+    msg.points = nullptr;
+    msg.num_points = 0;
+    msg.lidar_start = msg.lidar_end = 0;
+    switch(msg.sensor) {
+        case SENSOR_STEREO_GRAY:
+        case SENSOR_STEREO_COLOR: {
+            const shm_stereo_t* head = (const shm_stereo_t*)payload;
+            msg.stereo.timestamp = head->timestamp;
+            msg.stereo.is_color = head->is_color != 0;
+            msg.stereo.width = head->width;
+            msg.stereo.height = head->height;
+            msg.stereo.has_imu = head->has_imu != 0;
+            msg.stereo.imu = head->imu;
+            msg.stereo.image_left = cv::Mat(head->left.rows, head->left.cols, head->left.type,
+                                            (void*)(payload + head->left.offset), head->left.step);
+            msg.stereo.image_right = cv::Mat(head->right.rows, head->right.cols, head->right.type,
+                                             (void*)(payload + head->right.offset), head->right.step);
+            break;
+        }
+        case SENSOR_LIDAR: {
+            const shm_lidar_t* head = (const shm_lidar_t*)payload;
+            msg.lidar_start = head->timestamp_start;
+            msg.lidar_end = head->timestamp_end;
+            msg.num_points = head->num_points;
+            msg.points = (const std::array<float,4>*)(payload + sizeof(shm_lidar_t));
+            break;
+        }
+        default:
+            msg.gpsimu = (const gpsimu_t*)payload;
+            break;
+    }
+    return true;
+
+}
@@ -0,0 +1,133 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_SHMRING_H
+#define KITTI_PARSER_SHMRING_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "kitti_parser/types/stereo_t.h"
+#include "kitti_parser/types/lidar_t.h"
+#include "kitti_parser/types/gpsimu_t.h"
+#include "kitti_parser/types/shm_message_t.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Shared memory ring that one process publishes decoded messages into, for other local processes
+     * The segment starts with a control page, with the head and the cursor of each subscriber,
+     * followed by the slots. Message n goes into slot n % num_slots, and the publisher only reuses
+     * a slot once every subscriber released the message in it, so all of them see every message in
+     * the order it was published. Both sides sleep on futexes in the control page, which are only
+     * woken if somebody is asleep. Subscribers that die are dropped once the publisher waits on them.
+     */
+    class ShmPublisher {
+
+    public:
+
+        // Create the segment under the name, replacing any old one
+        ShmPublisher(std::string name, size_t num_slots = 16, size_t slot_size = 8 << 20);
+
+        // Tell subscribers we are done, and remove the name
+        ~ShmPublisher();
+
+        ShmPublisher(const ShmPublisher&) = delete;
+        ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+        // True if the segment was created
+        bool valid() const;
+
+        // Copy a measurement into the next slot, waiting for the slowest subscriber if the ring is full
+        // False if it is larger than a slot
+        bool publish(const stereo_t& frame);
+        bool publish(const lidar_t& scan);
+        bool publish(const gpsimu_t& meas);
+
+        // Number of messages published
+        uint64_t published() const;
+
+    private:
+
+        std::string name;
+        int fd = -1;
+        char* base = nullptr;
+        size_t length = 0;
+
+        // Wait till the slot of the next message is free, and return it, null if the payload does not fit
+        char* begin(size_t size);
+
+        // Make the message in the slot visible to the subscribers
+        void commit(sensor_t sensor, long timestamp, size_t size);
+
+    };
+
+
+    /**
+     * Reads the messages of a publisher in place
+     * A subscriber starts at the next message published after it joined.
+     */
+    class ShmSubscriber {
+
+    public:
+
+        // Attach to the segment of a publisher
+        explicit ShmSubscriber(std::string name);
+
+        // Release our cursor
+        ~ShmSubscriber();
+
+        ShmSubscriber(const ShmSubscriber&) = delete;
+        ShmSubscriber& operator=(const ShmSubscriber&) = delete;
+
+        // True if we are attached
+        bool valid() const;
+
+        // Wait for the next message, which stays valid till the next call or release()
+        // False once the publisher is gone and we read everything, or after the timeout (ms) if not negative
+        bool next(shm_message_t& msg, long timeout_ms = -1);
+
+        // Done with the last message, so the publisher can reuse its slot
+        void release();
+
+    private:
+
+        int fd = -1;
+        char* control = nullptr;
+        const char* slots = nullptr;
+        size_t length_control = 0;
+        size_t length_slots = 0;
+
+        // Our cursor, and if we still hold the message before it
+        int cursor = -1;
+        bool holding = false;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_SHMRING_H
@@ -0,0 +1,159 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_SPSCQUEUE_H
+#define KITTI_PARSER_SPSCQUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include "kitti_parser/util/WaitStrategy.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Bounded lock-free queue for a single producer and single consumer thread
+     * Each side keeps a cached copy of the other side's index, so the shared
+     * indices are only read when the queue looks full or empty.
+     * The blocking calls spin and then sleep, and return false once the queue is closed.
+     */
+    template<typename T>
+    class SpscQueue {
+
+    public:
+
+        // Default constructor, capacity is rounded up to a power of two
+        explicit SpscQueue(size_t capacity) {
+            size_t size = 1;
+            while(size < capacity)
+                size <<= 1;
+            buffer.resize(size);
+            mask = size - 1;
+        }
+
+        // Push if there is room, only call from the producer
+        bool try_push(T& val) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if(t - head_cache > mask) {
+                head_cache = head.load(std::memory_order_acquire);
+                if(t - head_cache > mask)
+                    return false;
+            }
+            buffer[t & mask] = std::move(val);
+            tail.store(t + 1, std::memory_order_release);
+            not_empty.notify();
+            return true;
+        }
+
+        // Pop if there is anything, only call from the consumer
+        bool try_pop(T& val) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if(h == tail_cache) {
+                tail_cache = tail.load(std::memory_order_acquire);
+                if(h == tail_cache)
+                    return false;
+            }
+            val = std::move(buffer[h & mask]);
+            head.store(h + 1, std::memory_order_release);
+            not_full.notify();
+            return true;
+        }
+
+        // Push, waiting till there is room, returns false if closed
+        bool push(T val) {
+            while(!is_closed.load(std::memory_order_acquire)) {
+                if(try_push(val))
+                    return true;
+                not_full.wait([&]() {
+                    return is_closed.load(std::memory_order_acquire)
+                           || tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire) <= mask;
+                });
+            }
+            return false;
+        }
+
+        // Pop, waiting till there is something, returns false once closed and empty
+        bool pop(T& val) {
+            while(true) {
+                if(try_pop(val))
+                    return true;
+                if(is_closed.load(std::memory_order_acquire))
+                    return try_pop(val);
+                not_empty.wait([&]() {
+                    return is_closed.load(std::memory_order_acquire)
+                           || tail.load(std::memory_order_acquire) != head.load(std::memory_order_relaxed);
+                });
+            }
+        }
+
+        // Stop the queue, wakes anybody that is waiting
+        void close() {
+            is_closed.store(true, std::memory_order_release);
+            not_empty.notify();
+            not_full.notify();
+        }
+
+        bool closed() const {
+            return is_closed.load(std::memory_order_acquire);
+        }
+
+        // Approximate number of items
+        size_t size() const {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+
+        size_t capacity() const {
+            return mask + 1;
+        }
+
+    private:
+
+        // Ring storage
+        std::vector<T> buffer;
+        size_t mask;
+
+        // Consumer side, padded so the two sides don't share a cache line
+        char pad0[64];
+        std::atomic<size_t> head{0};
+        size_t tail_cache = 0;
+
+        // Producer side
+        char pad1[64];
+        std::atomic<size_t> tail{0};
+        size_t head_cache = 0;
+        char pad2[64];
+
+        // Blocking
+        std::atomic<bool> is_closed{false};
+        WaitStrategy not_empty;
+        WaitStrategy not_full;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_SPSCQUEUE_H
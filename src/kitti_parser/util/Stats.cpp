@@ -0,0 +1,155 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/Stats.h"
+#include <cstdio>
+#include <sstream>
+#include <iomanip>
+#include <utility>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+Stats::stage_shard_t::stage_shard_t() {
+    for(int i=0; i<NUM_BUCKETS; i++)
+        buckets[i].store(0, std::memory_order_relaxed);
+}
+
+
+/**
+ * Records a sample, only this thread writes to its shard so we don't need atomic adds
+ */
+void Stats::record(stage_t stage, uint64_t ns, uint64_t bytes) {
+    stage_shard_t& s = shards.local()->stages[stage];
+    s.count.store(s.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    s.bytes.store(s.bytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    s.total_ns.store(s.total_ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    if(ns > s.max_ns.load(std::memory_order_relaxed))
+        s.max_ns.store(ns, std::memory_order_relaxed);
+    std::atomic<uint64_t>& b = s.buckets[bucket(ns)];
+    b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+
+/**
+ * Sums up all threads
+ */
+Stats::snapshot_t Stats::snapshot() {
+    snapshot_t snap;
+    shards.each([&](const shard_t& shard) {
+        for(int st=0; st<STAGE_COUNT; st++) {
+            const stage_shard_t& s = shard.stages[st];
+            histogram_t& h = snap.stages[st];
+            h.count += s.count.load(std::memory_order_relaxed);
+            h.bytes += s.bytes.load(std::memory_order_relaxed);
+            h.total_ns += s.total_ns.load(std::memory_order_relaxed);
+            h.max_ns = std::max(h.max_ns, (uint64_t)s.max_ns.load(std::memory_order_relaxed));
+            for(int b=0; b<NUM_BUCKETS; b++)
+                h.buckets[b] += s.buckets[b].load(std::memory_order_relaxed);
+        }
+    });
+    return snap;
+}
+
+
+void Stats::set_tracer(Tracer* t) {
+    tracer = t;
+}
+
+
+const char* Stats::name(stage_t stage) {
+    static const char* names[STAGE_COUNT] = {
+            "scan_folders", "load_timestamps", "load_oxts", "fetch_stereo", "decode_image", "fetch_lidar", "fetch_gpsimu",
+            "queue_wait", "dispatch", "cb_stereo_gray", "cb_stereo_color", "cb_lidar", "cb_gpsimu"};
+    return (stage >= 0 && stage < STAGE_COUNT)? names[stage] : "unknown";
+}
+
+
+/**
+ * Values below 2^SUB_BITS get their own bucket, above that each power of two is split into 2^SUB_BITS
+ */
+int Stats::bucket(uint64_t ns) {
+    if(ns < (1u << SUB_BITS))
+        return (int)ns;
+    int msb = 63 - __builtin_clzll(ns);
+    if(msb >= MAX_BITS)
+        return NUM_BUCKETS - 1;
+    return ((msb - SUB_BITS + 1) << SUB_BITS) + (int)((ns >> (msb - SUB_BITS)) & ((1u << SUB_BITS) - 1));
+}
+
+
+uint64_t Stats::bucket_max(int bucket) {
+    if(bucket < (1 << SUB_BITS))
+        return (uint64_t)bucket;
+    int msb = (bucket >> SUB_BITS) + SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(bucket & ((1 << SUB_BITS) - 1));
+    return (((1ull << SUB_BITS) + sub + 1) << (msb - SUB_BITS)) - 1;
+}
+
+
+double Stats::histogram_t::mean_ns() const {
+    return (count > 0)? (double)total_ns/count : 0.0;
+}
+
+
+/**
+ * Returns the upper end of the bucket the percentile falls in
+ */
+uint64_t Stats::histogram_t::percentile_ns(double p) const {
+    if(count == 0)
+        return 0;
+    uint64_t target = (uint64_t)(p/100.0*count + 0.5);
+    target = std::max(target, (uint64_t)1);
+    uint64_t seen = 0;
+    for(int b=0; b<NUM_BUCKETS; b++) {
+        seen += buckets[b];
+        if(seen >= target)
+            return std::min(Stats::bucket_max(b), max_ns);
+    }
+    return max_ns;
+}
+
+
+/**
+ * Formats a table of all stages that have samples, times are in microseconds
+ */
+std::string Stats::snapshot_t::summary() const {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << std::left << std::setw(17) << "stage" << std::right << std::setw(10) << "count"
+       << std::setw(12) << "total ms" << std::setw(10) << "mean us" << std::setw(10) << "p50 us"
+       << std::setw(10) << "p99 us" << std::setw(10) << "max us" << std::setw(10) << "MB/s" << "\n";
+    for(int st=0; st<STAGE_COUNT; st++) {
+        const histogram_t& h = stages[st];
+        if(h.count == 0)
+            continue;
+        double secs = std::max(1e-9*h.total_ns, 1e-9);
+        ss << std::left << std::setw(17) << Stats::name((stage_t)st) << std::right << std::setw(10) << h.count
+           << std::setw(12) << 1e-6*h.total_ns << std::setw(10) << 1e-3*h.mean_ns()
+           << std::setw(10) << 1e-3*h.percentile_ns(50) << std::setw(10) << 1e-3*h.percentile_ns(99)
+           << std::setw(10) << 1e-3*h.max_ns << std::setw(10) << ((h.bytes > 0)? 1e-6*h.bytes/secs : 0.0) << "\n";
+    }
+    return ss.str();
+}
@@ -0,0 +1,160 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_STATS_H
+#define KITTI_PARSER_STATS_H
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "kitti_parser/util/Tracer.h"
+#include "kitti_parser/util/ThreadSlots.h"
+
+
+namespace kitti_parser {
+
+    // Stages of the pipeline that we time
+    typedef enum {
+        STAGE_SCAN_FOLDERS = 0,
+        STAGE_LOAD_TIMESTAMPS,
+        STAGE_LOAD_OXTS,
+        STAGE_FETCH_STEREO,
+        STAGE_DECODE_IMAGE,
+        STAGE_FETCH_LIDAR,
+        STAGE_FETCH_GPSIMU,
+        STAGE_QUEUE_WAIT,
+        STAGE_DISPATCH,
+        STAGE_CALLBACK_STEREO_GRAY,
+        STAGE_CALLBACK_STEREO_COLOR,
+        STAGE_CALLBACK_LIDAR,
+        STAGE_CALLBACK_GPSIMU,
+        STAGE_COUNT
+    } stage_t;
+
+
+    /**
+     * Always-on latency histograms and counters for each stage
+     * Each thread records into its own shard, so recording is a few plain stores with no
+     * locks or shared cache lines. A snapshot sums the shards of all threads.
+     * Histograms are log-linear (HDR style), 16 buckets per power of two, so about 6% precision.
+     * If a tracer is set, every timed scope is also recorded as a trace event.
+     */
+    class Stats {
+
+    public:
+
+        // Bucket layout
+        static const int SUB_BITS = 4;
+        static const int MAX_BITS = 40;
+        static const int NUM_BUCKETS = (MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+        // Histogram of a single stage, times are in nanoseconds
+        struct histogram_t {
+            uint64_t count = 0;
+            uint64_t bytes = 0;
+            uint64_t total_ns = 0;
+            uint64_t max_ns = 0;
+            std::vector<uint64_t> buckets = std::vector<uint64_t>(NUM_BUCKETS, 0);
+            // Mean and percentile (0 to 100) latency
+            double mean_ns() const;
+            uint64_t percentile_ns(double p) const;
+        };
+
+        // All stages summed over all threads
+        struct snapshot_t {
+            histogram_t stages[STAGE_COUNT];
+            // Table of all stages that have been hit
+            std::string summary() const;
+        };
+
+        // Times a scope, and records it on destruction
+        class Timer {
+        public:
+            Timer(Stats* stats, stage_t stage) : stats(stats), stage(stage) {
+                if(stats != nullptr)
+                    start = Tracer::now_ns();
+            }
+            ~Timer() {
+                if(stats == nullptr)
+                    return;
+                uint64_t ns = Tracer::now_ns() - start;
+                stats->record(stage, ns, bytes);
+                if(stats->tracer != nullptr)
+                    stats->tracer->record(Stats::name(stage), start, ns, timestamp);
+            }
+            // Bytes processed in this scope, for throughput
+            uint64_t bytes = 0;
+            // Timestamp of the message this scope is working on, for the trace
+            long timestamp = -1;
+        private:
+            Stats* stats;
+            stage_t stage;
+            uint64_t start = 0;
+        };
+
+        // Record a single sample on the calling thread
+        void record(stage_t stage, uint64_t ns, uint64_t bytes = 0);
+
+        // Sum of all threads
+        snapshot_t snapshot();
+
+        // Also send every timed scope to this tracer, null to disable
+        void set_tracer(Tracer* tracer);
+
+        // Name of a stage
+        static const char* name(stage_t stage);
+
+        // Bucket of a value, and the largest value in a bucket
+        static int bucket(uint64_t ns);
+        static uint64_t bucket_max(int bucket);
+
+    private:
+
+        // Written only by the owning thread, atomic so snapshots can read while it records
+        struct stage_shard_t {
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> bytes{0};
+            std::atomic<uint64_t> total_ns{0};
+            std::atomic<uint64_t> max_ns{0};
+            std::atomic<uint64_t> buckets[NUM_BUCKETS];
+            stage_shard_t();
+        };
+        struct shard_t {
+            stage_shard_t stages[STAGE_COUNT];
+        };
+
+        // Where timed scopes are traced, can be null
+        Tracer* tracer = nullptr;
+
+        // One shard per recording thread, reused by new threads once one exits
+        ThreadSlots<shard_t> shards;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_STATS_H
@@ -0,0 +1,313 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/Storage.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+/**
+ * Default whole file read, a stat and a single read
+ */
+bool Storage::read_all(const std::string& path, std::vector<char>& out) {
+    stat_t st;
+    if(!stat(path, st) || st.is_folder) {
+        out.clear();
+        return false;
+    }
+    out.resize((size_t)st.size);
+    return out.empty() || read(path, 0, out.size(), out.data());
+}
+
+
+/**
+ * By default we can't map
+ */
+std::shared_ptr<const mapping_t> Storage::map(const std::string&) {
+    return std::shared_ptr<const mapping_t>();
+}
+
+
+void Storage::set_cache_mode(cache_mode_t mode) {
+    cache = mode;
+}
+
+
+cache_mode_t Storage::cache_mode() const {
+    return cache;
+}
+
+
+bool Storage::exists(const std::string& path) {
+    stat_t st;
+    return stat(path, st);
+}
+
+
+std::string Storage::join(const std::string& folder, const std::string& name) {
+    if(folder.empty() || folder.back() == '/')
+        return folder + name;
+    return folder + "/" + name;
+}
+
+
+std::string Storage::clean(const std::string& path) {
+    std::string out;
+    for(size_t i=0; i<path.size(); i++) {
+        if(path[i] == '/' && (out.empty() || out.back() == '/'))
+            continue;
+        out.push_back(path[i]);
+    }
+    while(!out.empty() && out.back() == '/')
+        out.pop_back();
+    return out;
+}
+
+
+ArchiveStorage::~ArchiveStorage() {
+    container.reset();
+    if(fd >= 0)
+        close(fd);
+}
+
+
+bool ArchiveStorage::valid() const {
+    return fd >= 0;
+}
+
+
+/**
+ * Lists the files and folders directly in the folder
+ * Since the index is sorted, these are all next to each other
+ */
+std::vector<std::string> ArchiveStorage::list(const std::string& path) {
+    std::vector<std::string> names;
+    std::string folder = clean(path);
+    std::string prefix = (folder.empty())? "" : folder + "/";
+    for(std::map<std::string, entry_t>::const_iterator it = entries.lower_bound(prefix); it != entries.end(); ++it) {
+        if(it->first.compare(0, prefix.size(), prefix) != 0)
+            break;
+        size_t slash = it->first.find('/', prefix.size());
+        std::string name = it->first.substr(prefix.size(), (slash == std::string::npos)? std::string::npos : slash - prefix.size());
+        if(names.empty() || names.back() != name)
+            names.push_back(name);
+    }
+    return names;
+}
+
+
+/**
+ * Files are in the index, folders exist if any file is in them
+ */
+bool ArchiveStorage::stat(const std::string& path, stat_t& st) {
+    std::string name = clean(path);
+    const entry_t* entry = find(name);
+    if(entry != nullptr) {
+        st.is_folder = false;
+        st.size = entry->size;
+        return true;
+    }
+    std::string prefix = (name.empty())? "" : name + "/";
+    std::map<std::string, entry_t>::const_iterator it = entries.lower_bound(prefix);
+    if(it == entries.end() || it->first.compare(0, prefix.size(), prefix) != 0)
+        return false;
+    st.is_folder = true;
+    st.size = 0;
+    return true;
+}
+
+
+const ArchiveStorage::entry_t* ArchiveStorage::find(const std::string& path) const {
+    std::map<std::string, entry_t>::const_iterator it = entries.find(clean(path));
+    return (it == entries.end())? nullptr : &it->second;
+}
+
+
+const ArchiveStorage::entry_t* ArchiveStorage::find_data(const std::string& path) const {
+    const entry_t* entry = find(path);
+    if(entry != nullptr && !entry->resolved.load(std::memory_order_acquire) && !resolve(*entry))
+        return nullptr;
+    return entry;
+}
+
+
+bool ArchiveStorage::resolve(const entry_t&) const {
+    return true;
+}
+
+
+ArchiveStorage::entry_t::entry_t(const entry_t& other) {
+    *this = other;
+}
+
+
+ArchiveStorage::entry_t& ArchiveStorage::entry_t::operator=(const entry_t& other) {
+    offset = other.offset;
+    length = other.length;
+    size = other.size;
+    method = other.method;
+    crc = other.crc;
+    sensor = other.sensor;
+    timestamp = other.timestamp;
+    resolved.store(other.resolved.load());
+    return *this;
+}
+
+
+/**
+ * Reads part of a stored file
+ */
+bool ArchiveStorage::read(const std::string& path, uint64_t offset, size_t length, char* out) {
+    const entry_t* entry = find_data(path);
+    if(entry == nullptr || entry->method != 0 || offset + length > entry->length)
+        return false;
+    bool success = read_raw(entry->offset + offset, length, out);
+    drop(entry->offset + offset, length);
+    return success;
+}
+
+
+/**
+ * Reads a stored file with a single pread, no stat needed since we have the index
+ */
+bool ArchiveStorage::read_all(const std::string& path, std::vector<char>& out) {
+    const entry_t* entry = find_data(path);
+    if(entry == nullptr || entry->method != 0) {
+        out.clear();
+        return false;
+    }
+    out.resize((size_t)entry->length);
+    bool success = read_raw(entry->offset, out.size(), out.data());
+    drop(entry->offset, entry->length);
+    return success;
+}
+
+
+/**
+ * Maps the whole container once, files are views into it
+ * The view shares ownership of the container mapping, so it stays valid on its own
+ */
+std::shared_ptr<const mapping_t> ArchiveStorage::map(const std::string& path) {
+    const entry_t* entry = find_data(path);
+    if(entry == nullptr || entry->method != 0 || fd < 0 || cache != CACHE_NORMAL)
+        return std::shared_ptr<const mapping_t>();
+    std::shared_ptr<const mapping_t> whole;
+    {
+        std::lock_guard<std::mutex> guard(lock_container);
+        if(!container) {
+            struct stat st;
+            if(fstat(fd, &st) != 0 || st.st_size == 0)
+                return std::shared_ptr<const mapping_t>();
+            void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if(data == MAP_FAILED)
+                return std::shared_ptr<const mapping_t>();
+            mapping_t* mapping = new mapping_t{(const char*)data, (size_t)st.st_size};
+            container.reset(mapping, [](const mapping_t* m) {
+                munmap((void*)m->data, m->size);
+                delete m;
+            });
+        }
+        whole = container;
+    }
+    if(entry->offset + entry->length > whole->size)
+        return std::shared_ptr<const mapping_t>();
+    mapping_t* view = new mapping_t{whole->data + entry->offset, (size_t)entry->length};
+    return std::shared_ptr<const mapping_t>(view, [whole](const mapping_t* m) { delete m; });
+}
+
+
+/**
+ * Asks the kernel to start reading the range of the file
+ */
+void ArchiveStorage::will_need(const std::string& path) {
+    const entry_t* entry = find_data(path);
+    if(entry != nullptr && fd >= 0)
+        posix_fadvise(fd, (off_t)entry->offset, (off_t)entry->length, POSIX_FADV_WILLNEED);
+}
+
+
+bool ArchiveStorage::locate(const std::string& path, int& fd_file, uint64_t& offset, uint64_t& length) const {
+    const entry_t* entry = find_data(path);
+    if(entry == nullptr || entry->method != 0 || fd < 0)
+        return false;
+    fd_file = fd;
+    offset = entry->offset;
+    length = entry->length;
+    return true;
+}
+
+
+bool ArchiveStorage::read_raw(uint64_t offset, size_t length, char* out) const {
+    if(fd < 0)
+        return false;
+    size_t done = 0;
+    while(done < length) {
+        ssize_t n = pread(fd, out + done, length - done, (off_t)(offset + done));
+        if(n <= 0)
+            return false;
+        done += (size_t)n;
+    }
+    return true;
+}
+
+
+void ArchiveStorage::drop(uint64_t offset, uint64_t length) const {
+    if(cache != CACHE_NORMAL && fd >= 0)
+        posix_fadvise(fd, (off_t)offset, (off_t)length, POSIX_FADV_DONTNEED);
+}
+
+
+/**
+ * Archives are often made from a parent folder, such as "2011_09_26/2011_09_26_drive_0001_sync/image_00/..."
+ * While there is a single top folder and it has none of the sensor folders, we move into it
+ */
+void ArchiveStorage::strip_to_drive() {
+    const char* sensors[6] = {"image_00", "image_01", "image_02", "image_03", "velodyne_points", "oxts"};
+    std::string root;
+    while(true) {
+        std::vector<std::string> top = list(root);
+        bool has_sensor = false;
+        for(size_t i=0; i<top.size(); i++) {
+            for(int s=0; s<6; s++)
+                has_sensor |= (top.at(i) == sensors[s]);
+        }
+        stat_t st;
+        if(has_sensor || top.size() != 1 || !stat(join(root, top.at(0)), st) || !st.is_folder)
+            break;
+        root = join(root, top.at(0));
+    }
+    if(root.empty())
+        return;
+    std::map<std::string, entry_t> stripped;
+    std::string prefix = root + "/";
+    for(std::map<std::string, entry_t>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        stripped[it->first.substr(prefix.size())] = it->second;
+    }
+    entries.swap(stripped);
+}
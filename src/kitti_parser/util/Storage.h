@@ -0,0 +1,187 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_STORAGE_H
+#define KITTI_PARSER_STORAGE_H
+
+#include <map>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "kitti_parser/types/cache_mode_t.h"
+
+
+namespace kitti_parser {
+
+    // Information about a file or folder
+    typedef struct {
+        bool is_folder;
+        uint64_t size;
+    } stat_t;
+
+    // A read-only view of a whole file, released when the last pointer to it goes away
+    typedef struct {
+        const char* data;
+        size_t size;
+    } mapping_t;
+
+
+    /**
+     * Where the loader reads a dataset from
+     * All of the loaders go through this, so a drive can be a folder, a packed container
+     * or an archive without changing any of the code that uses it. Paths are relative to the
+     * root of the storage, using "/" between folders.
+     */
+    class Storage {
+
+    public:
+
+        virtual ~Storage() {}
+
+        // Names of everything directly in the folder, sorted
+        virtual std::vector<std::string> list(const std::string& path) = 0;
+
+        // Information about a path, returns false if it does not exist
+        virtual bool stat(const std::string& path, stat_t& st) = 0;
+
+        // Read part of a file, returns false if we could not read all of it
+        virtual bool read(const std::string& path, uint64_t offset, size_t length, char* out) = 0;
+
+        // Read a whole file, backends can do this in fewer calls than a stat and a read
+        virtual bool read_all(const std::string& path, std::vector<char>& out);
+
+        // Map a whole file read-only, null if the backend can't or we are not caching
+        virtual std::shared_ptr<const mapping_t> map(const std::string& path);
+
+        // Hint that a file will be read soon, so it can be read ahead
+        virtual void will_need(const std::string&) {}
+
+        // How reads use the page cache
+        virtual void set_cache_mode(cache_mode_t mode);
+        cache_mode_t cache_mode() const;
+
+        // True if the path is there
+        bool exists(const std::string& path);
+
+        // Join a folder and a name, without doubling up slashes
+        static std::string join(const std::string& folder, const std::string& name);
+
+        // Remove leading, trailing and double slashes
+        static std::string clean(const std::string& path);
+
+    protected:
+
+        // How reads use the page cache
+        cache_mode_t cache = CACHE_NORMAL;
+
+    };
+
+
+    /**
+     * Base for single file containers that have an index of their files
+     * The index is sorted by name, so listing a folder is a range of it. Folders are not
+     * stored, a folder exists if there is any file in it. Stored files are read with a
+     * pread at their offset, or handed out as a view into a single mapping of the container.
+     * When not caching, the range of each file is dropped from the page cache after it is read
+     * (for both modes, since files in archives are not block aligned for O_DIRECT).
+     */
+    class ArchiveStorage : public Storage {
+
+    public:
+
+        ~ArchiveStorage() override;
+
+        // Single file in the archive
+        struct entry_t {
+            // Where the stored data starts, and how long it is
+            mutable uint64_t offset = 0;
+            uint64_t length = 0;
+            // Size once decompressed, and the compression method (0 for stored)
+            uint64_t size = 0;
+            int method = 0;
+            // CRC32 of the decompressed data, if the archive has one
+            uint32_t crc = 0;
+            // Sensor and timestamp of the measurement if the archive knows them, else -1
+            int sensor = -1;
+            long timestamp = -1;
+            // False while the offset is not yet where the data starts, see resolve()
+            mutable std::atomic<bool> resolved{true};
+            entry_t() = default;
+            entry_t(const entry_t& other);
+            entry_t& operator=(const entry_t& other);
+        };
+
+        std::vector<std::string> list(const std::string& path) override;
+        bool stat(const std::string& path, stat_t& st) override;
+        bool read(const std::string& path, uint64_t offset, size_t length, char* out) override;
+        bool read_all(const std::string& path, std::vector<char>& out) override;
+        std::shared_ptr<const mapping_t> map(const std::string& path) override;
+        void will_need(const std::string& path) override;
+
+        // True if the container was opened and its index read
+        bool valid() const;
+
+        // Entry of a file, null if it is not there
+        const entry_t* find(const std::string& path) const;
+
+        // Where a stored file is in the open container, false if it is compressed or not there
+        bool locate(const std::string& path, int& fd_file, uint64_t& offset, uint64_t& length) const;
+
+    protected:
+
+        // Open container
+        int fd = -1;
+
+        // Index, sorted by name
+        std::map<std::string, entry_t> entries;
+
+        // Whole container, mapped the first time a file is mapped
+        std::shared_ptr<const mapping_t> container;
+        std::mutex lock_container;
+
+        // Reads bytes of the container, returns false if we could not read all of them
+        bool read_raw(uint64_t offset, size_t length, char* out) const;
+
+        // Entry of a file with its data offset resolved, null if it is not there or that failed
+        const entry_t* find_data(const std::string& path) const;
+
+        // Archives that only know where the data of a file starts once they read its header do it here, on first use
+        // Called for entries that are not resolved yet, it sets the offset and then marks them resolved
+        virtual bool resolve(const entry_t& entry) const;
+
+        // Drop a range of the container from the page cache, if we are not caching
+        void drop(uint64_t offset, uint64_t length) const;
+
+        // If the drive folders are nested inside other folders, make the inner folder the root
+        void strip_to_drive();
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_STORAGE_H
@@ -0,0 +1,155 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/TarStorage.h"
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+const std::string TarStorage::EXTENSION = ".tar";
+
+// Everything in a tar is in blocks of this size
+static const uint64_t BLOCK_SIZE = 512;
+
+
+/**
+ * Parses a numeric header field, which is octal text or big endian binary if the top bit is set
+ */
+static uint64_t parse_number(const char* field, size_t length) {
+    uint64_t value = 0;
+    if((unsigned char)field[0] & 0x80) {
+        for(size_t i=1; i<length; i++)
+            value = (value << 8) | (unsigned char)field[i];
+        return value;
+    }
+    for(size_t i=0; i<length && field[i] != '\0'; i++) {
+        if(field[i] >= '0' && field[i] <= '7')
+            value = (value << 3) | (uint64_t)(field[i] - '0');
+    }
+    return value;
+}
+
+
+/**
+ * Reads a header string, which is not terminated if it fills the field
+ */
+static std::string parse_string(const char* field, size_t length) {
+    return std::string(field, strnlen(field, length));
+}
+
+
+/**
+ * Finds the path record of a pax header, records are "<length> <key>=<value>\n"
+ */
+static std::string parse_pax_path(const std::vector<char>& data) {
+    size_t pos = 0;
+    while(pos < data.size()) {
+        size_t space = pos;
+        while(space < data.size() && data[space] != ' ')
+            space++;
+        size_t length = (size_t)strtoul(std::string(data.begin()+pos, data.begin()+space).c_str(), nullptr, 10);
+        if(length == 0 || pos + length > data.size())
+            break;
+        std::string record(data.begin()+space+1, data.begin()+pos+length-1);
+        if(record.compare(0, 5, "path=") == 0)
+            return record.substr(5);
+        pos += length;
+    }
+    return "";
+}
+
+
+/**
+ * Opens the archive and walks all of its headers
+ */
+TarStorage::TarStorage(std::string path_tar) {
+
+    // Open the archive
+    fd = open(path_tar.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+
+    // Walk the headers, each file follows its header
+    uint64_t pos = 0;
+    std::string long_name;
+    char header[BLOCK_SIZE];
+    while(read_raw(pos, BLOCK_SIZE, header)) {
+
+        // Two empty blocks mark the end, we stop at the first
+        if(header[0] == '\0')
+            break;
+
+        // Check the header checksum, which is the sum with the checksum field as spaces
+        uint64_t sum = 0;
+        for(size_t i=0; i<BLOCK_SIZE; i++)
+            sum += (i >= 148 && i < 156)? (uint64_t)' ' : (uint64_t)(unsigned char)header[i];
+        if(sum != parse_number(header+148, 8)) {
+            std::cerr << "[kitti_parser]: Invalid tar header in " << path_tar << " at " << pos << std::endl;
+            break;
+        }
+
+        // Name, ustar archives split long ones into a prefix
+        std::string name = parse_string(header, 100);
+        if(memcmp(header+257, "ustar", 5) == 0 && header[345] != '\0')
+            name = parse_string(header+345, 155) + "/" + name;
+        uint64_t size = parse_number(header+124, 12);
+        uint64_t offset = pos + BLOCK_SIZE;
+        char type = header[156];
+        pos = offset + (size + BLOCK_SIZE - 1)/BLOCK_SIZE*BLOCK_SIZE;
+
+        // GNU long names and pax headers give the name of the next file
+        if(type == 'L' || type == 'x') {
+            std::vector<char> data((size_t)size);
+            if(!read_raw(offset, data.size(), data.data()))
+                break;
+            long_name = (type == 'L')? parse_string(data.data(), data.size()) : parse_pax_path(data);
+            continue;
+        }
+        if(!long_name.empty()) {
+            name = long_name;
+            long_name.clear();
+        }
+
+        // Only regular files go in the index, folders exist through their files
+        if(type != '0' && type != '\0' && type != '7')
+            continue;
+        if(name.compare(0, 2, "./") == 0)
+            name = name.substr(2);
+        entry_t entry;
+        entry.offset = offset;
+        entry.length = size;
+        entry.size = size;
+        entries[clean(name)] = entry;
+
+    }
+
+    // Move into the drive folder
+    strip_to_drive();
+
+}
@@ -0,0 +1,55 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_TARSTORAGE_H
+#define KITTI_PARSER_TARSTORAGE_H
+
+#include <string>
+#include "kitti_parser/util/Storage.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * An uncompressed tar archive of a drive (.tar)
+     * The headers are scanned once when opened to build the index, after that every file is a
+     * single pread at its offset. Handles ustar prefixes, GNU long names and pax paths. If the
+     * archive was made from a parent folder, the drive folder inside of it becomes the root.
+     */
+    class TarStorage : public ArchiveStorage {
+
+    public:
+
+        // File extension of tar archives
+        static const std::string EXTENSION;
+
+        // Default constructor, opens the archive and indexes it
+        TarStorage(std::string path_tar);
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_TARSTORAGE_H
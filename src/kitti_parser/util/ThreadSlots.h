@@ -0,0 +1,158 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_THREADSLOTS_H
+#define KITTI_PARSER_THREADSLOTS_H
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+
+namespace kitti_parser {
+
+    /**
+     * One object per thread for an owner, like the shards of Stats or the rings of Tracer
+     * Each thread finds its object through a small thread local list, so the lookup takes no locks.
+     * When a thread exits its objects go back to their owners, and are handed to the next new thread,
+     * so pools of threads that come and go do not grow the memory. Everything is freed with the owner.
+     */
+    template<typename T>
+    class ThreadSlots {
+
+    public:
+
+        ThreadSlots() : id(next_id().fetch_add(1)), registry(std::make_shared<registry_t>()) {}
+
+        ThreadSlots(const ThreadSlots&) = delete;
+        ThreadSlots& operator=(const ThreadSlots&) = delete;
+
+        // Object of the calling thread, attach is called on it each time it is handed to a new thread
+        template<typename F>
+        T* local(F attach) {
+            std::vector<entry_t>& list = entries().list;
+            for(size_t i=0; i<list.size(); i++) {
+                if(list[i].id == id)
+                    return list[i].slot;
+            }
+            return add(list, attach);
+        }
+
+        T* local() {
+            return local([](T*) {});
+        }
+
+        // Calls f on every object, including ones waiting for a new thread
+        template<typename F>
+        void each(F f) const {
+            std::lock_guard<std::mutex> lock(registry->mtx);
+            for(size_t i=0; i<registry->all.size(); i++)
+                f(*registry->all.at(i));
+        }
+
+    private:
+
+        // Everything of one owner, kept alive by threads still giving back their objects
+        struct registry_t {
+            std::mutex mtx;
+            std::vector<T*> all;
+            std::vector<T*> free;
+            ~registry_t() {
+                for(size_t i=0; i<all.size(); i++)
+                    delete all.at(i);
+            }
+        };
+
+        // What a thread has, and gives back when it exits
+        struct entry_t {
+            uint64_t id;
+            std::weak_ptr<registry_t> registry;
+            T* slot;
+        };
+        struct thread_entries_t {
+            std::vector<entry_t> list;
+            ~thread_entries_t() {
+                for(size_t i=0; i<list.size(); i++) {
+                    std::shared_ptr<registry_t> reg = list[i].registry.lock();
+                    if(!reg)
+                        continue;
+                    std::lock_guard<std::mutex> lock(reg->mtx);
+                    reg->free.push_back(list[i].slot);
+                }
+            }
+        };
+
+        // Unique id, so a thread's entry is never used for a new owner at the same address
+        uint64_t id;
+        std::shared_ptr<registry_t> registry;
+
+        static std::atomic<uint64_t>& next_id() {
+            static std::atomic<uint64_t> next{1};
+            return next;
+        }
+
+        static thread_entries_t& entries() {
+            static thread_local thread_entries_t local;
+            return local;
+        }
+
+        // Takes a free object or makes one, and forgets entries of owners that are gone
+        template<typename F>
+        T* add(std::vector<entry_t>& list, F& attach) {
+            for(size_t i=0; i<list.size(); ) {
+                if(list[i].registry.expired()) {
+                    list[i] = list.back();
+                    list.pop_back();
+                } else {
+                    i++;
+                }
+            }
+            T* slot = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(registry->mtx);
+                if(!registry->free.empty()) {
+                    slot = registry->free.back();
+                    registry->free.pop_back();
+                } else {
+                    slot = new T();
+                    registry->all.push_back(slot);
+                }
+                attach(slot);
+            }
+            entry_t entry;
+            entry.id = id;
+            entry.registry = registry;
+            entry.slot = slot;
+            list.push_back(entry);
+            return slot;
+        }
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_THREADSLOTS_H
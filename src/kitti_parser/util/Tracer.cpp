@@ -0,0 +1,118 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/Tracer.h"
+#include <chrono>
+#include <cstdio>
+#include <utility>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#else
+#include <thread>
+#include <functional>
+#endif
+
+using namespace std;
+using namespace kitti_parser;
+
+
+/**
+ * Default constructor, rounds the ring size up to a power of two
+ */
+Tracer::Tracer(size_t events_per_thread) {
+    size = 1;
+    while(size < events_per_thread)
+        size <<= 1;
+}
+
+
+uint64_t Tracer::now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * Returns the ring of the calling thread, sized the first time and tagged with the thread each time it is handed out
+ */
+Tracer::ring_t* Tracer::local() {
+    return rings.local([this](ring_t* ring) {
+#ifdef __linux__
+        ring->tid = (long)syscall(SYS_gettid);
+#else
+        ring->tid = (long)std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+        if(ring->events.size() != size)
+            ring->events.resize(size);
+    });
+}
+
+
+/**
+ * Records an event, overwriting the oldest one if the ring is full
+ */
+void Tracer::record(const char* name, uint64_t begin_ns, uint64_t dur_ns, long timestamp) {
+    ring_t* ring = local();
+    uint64_t h = ring->head.load(std::memory_order_relaxed);
+    event_t& e = ring->events[h & (size-1)];
+    e.name = name;
+    e.begin_ns = begin_ns;
+    e.dur_ns = dur_ns;
+    e.timestamp = timestamp;
+    e.tid = ring->tid;
+    ring->head.store(h + 1, std::memory_order_release);
+}
+
+
+/**
+ * Writes the events of all threads as complete ("X") events, times are in microseconds
+ * https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+ */
+bool Tracer::write(std::string path) const {
+
+    FILE* file = fopen(path.c_str(), "w");
+    if(file == nullptr)
+        return false;
+
+    int pid = (int)getpid();
+    bool first = true;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    rings.each([&](const ring_t& ring) {
+        uint64_t head = ring.head.load(std::memory_order_acquire);
+        uint64_t start = (head > size)? head - size : 0;
+        for(uint64_t i=start; i<head; i++) {
+            const event_t& e = ring.events[i & (size-1)];
+            fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"kitti_parser\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%ld",
+                    (first)? "" : ",\n", e.name, 1e-3*e.begin_ns, 1e-3*e.dur_ns, pid, e.tid);
+            if(e.timestamp >= 0)
+                fprintf(file, ",\"args\":{\"timestamp\":%ld}", e.timestamp);
+            fprintf(file, "}");
+            first = false;
+        }
+    });
+    fprintf(file, "\n]}\n");
+    return (fclose(file) == 0);
+
+}
@@ -0,0 +1,93 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_TRACER_H
+#define KITTI_PARSER_TRACER_H
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "kitti_parser/util/ThreadSlots.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Timeline of begin/end events, written as a Chrome trace JSON file
+     * The file can be opened in chrome://tracing or the Perfetto UI.
+     * Each thread records into its own ring buffer, so recording is a single store of a
+     * complete event with no locks. Once a ring is full the oldest events are overwritten.
+     */
+    class Tracer {
+
+    public:
+
+        // A single complete event, times are in steady clock nanoseconds
+        struct event_t {
+            const char* name;
+            uint64_t begin_ns;
+            uint64_t dur_ns;
+            long timestamp;
+            // Thread that recorded it, rings are handed to new threads once theirs exit
+            long tid;
+        };
+
+        // Default constructor, size is the number of events kept per thread
+        Tracer(size_t events_per_thread);
+
+        // Record an event on the calling thread, name must be a static string
+        void record(const char* name, uint64_t begin_ns, uint64_t dur_ns, long timestamp = -1);
+
+        // Write all events to a JSON file, should be called when no thread is recording
+        bool write(std::string path) const;
+
+        // Current steady clock time in nanoseconds
+        static uint64_t now_ns();
+
+    private:
+
+        // Ring of events for one thread
+        struct ring_t {
+            long tid;
+            std::vector<event_t> events;
+            std::atomic<uint64_t> head{0};
+        };
+
+        // Ring size, power of two
+        size_t size;
+
+        // One ring per recording thread, reused by new threads once one exits
+        ThreadSlots<ring_t> rings;
+
+        // Ring of the calling thread
+        ring_t* local();
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_TRACER_H
@@ -0,0 +1,238 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kitti_parser/util/Trajectory.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// Earth radius (m), as used by the KITTI devkit
+static const double EARTH_RADIUS = 6378137.0;
+
+
+/**
+ * Rotation matrix to a quaternion (w,x,y,z)
+ * Uses the largest of the diagonal terms so it stays accurate near 180 degrees
+ */
+static void to_quaternion(const double R[9], double q[4]) {
+    double trace = R[0] + R[4] + R[8];
+    if(trace > 0) {
+        double s = 0.5/sqrt(trace + 1.0);
+        q[0] = 0.25/s;
+        q[1] = (R[7] - R[5])*s;
+        q[2] = (R[2] - R[6])*s;
+        q[3] = (R[3] - R[1])*s;
+    } else if(R[0] > R[4] && R[0] > R[8]) {
+        double s = 2.0*sqrt(1.0 + R[0] - R[4] - R[8]);
+        q[0] = (R[7] - R[5])/s;
+        q[1] = 0.25*s;
+        q[2] = (R[1] + R[3])/s;
+        q[3] = (R[2] + R[6])/s;
+    } else if(R[4] > R[8]) {
+        double s = 2.0*sqrt(1.0 + R[4] - R[0] - R[8]);
+        q[0] = (R[2] - R[6])/s;
+        q[1] = (R[1] + R[3])/s;
+        q[2] = 0.25*s;
+        q[3] = (R[5] + R[7])/s;
+    } else {
+        double s = 2.0*sqrt(1.0 + R[8] - R[0] - R[4]);
+        q[0] = (R[3] - R[1])/s;
+        q[1] = (R[2] + R[6])/s;
+        q[2] = (R[5] + R[7])/s;
+        q[3] = 0.25*s;
+    }
+}
+
+
+/**
+ * Quaternion (w,x,y,z) to the rotation part of a row major 4x4 transform
+ */
+static void to_rotation(const double q[4], double T[16]) {
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+    T[0] = 1 - 2*(y*y + z*z);  T[1] = 2*(x*y - w*z);      T[2] = 2*(x*z + w*y);
+    T[4] = 2*(x*y + w*z);      T[5] = 1 - 2*(x*x + z*z);  T[6] = 2*(y*z - w*x);
+    T[8] = 2*(x*z - w*y);      T[9] = 2*(y*z + w*x);      T[10] = 1 - 2*(x*x + y*y);
+}
+
+
+/**
+ * Computes the poses of the whole drive in one pass over the columns
+ */
+void Trajectory::add_drive(const OxtsTable& table, size_t begin, size_t end) {
+
+    // Nothing to add
+    end = std::min(end, table.size());
+    if(begin >= end)
+        return;
+
+    // Columns we need
+    const double* lat = table.column(OxtsTable::LAT).data();
+    const double* lon = table.column(OxtsTable::LON).data();
+    const double* alt = table.column(OxtsTable::ALT).data();
+    const double* roll = table.column(OxtsTable::ROLL).data();
+    const double* pitch = table.column(OxtsTable::PITCH).data();
+    const double* yaw = table.column(OxtsTable::YAW).data();
+
+    // Mercator scale from the first record
+    double scale = cos(lat[begin]*M_PI/180.0);
+
+    // Make room
+    size_t first = time.size();
+    size_t count = end - begin;
+    if(drives.empty())
+        drives.push_back(0);
+    time.insert(time.end(), table.time().begin()+begin, table.time().begin()+end);
+    transforms.resize(transforms.size() + 16*count);
+    quaternions.resize(quaternions.size() + 4*count);
+
+    // Absolute poses, R = Rz(yaw)*Ry(pitch)*Rx(roll)
+    for(size_t i=0; i<count; i++) {
+        size_t k = begin + i;
+        double cr = cos(roll[k]), sr = sin(roll[k]);
+        double cp = cos(pitch[k]), sp = sin(pitch[k]);
+        double cy = cos(yaw[k]), sy = sin(yaw[k]);
+        double* T = &transforms[16*(first + i)];
+        T[0] = cy*cp;  T[1] = cy*sp*sr - sy*cr;  T[2] = cy*sp*cr + sy*sr;
+        T[4] = sy*cp;  T[5] = sy*sp*sr + cy*cr;  T[6] = sy*sp*cr - cy*sr;
+        T[8] = -sp;    T[9] = cp*sr;             T[10] = cp*cr;
+        T[3] = scale*lon[k]*M_PI*EARTH_RADIUS/180.0;
+        T[7] = scale*EARTH_RADIUS*log(tan((90.0 + lat[k])*M_PI/360.0));
+        T[11] = alt[k];
+        T[12] = 0; T[13] = 0; T[14] = 0; T[15] = 1;
+    }
+
+    // Relative to the first, T0^-1 * T = [R0' * R, R0' * (t - t0)]
+    double R0[9], t0[3];
+    const double* T0 = &transforms[16*first];
+    for(int r=0; r<3; r++) {
+        for(int c=0; c<3; c++)
+            R0[3*r+c] = T0[4*r+c];
+        t0[r] = T0[4*r+3];
+    }
+    for(size_t i=0; i<count; i++) {
+        double* T = &transforms[16*(first + i)];
+        double R[9], d[3];
+        for(int r=0; r<3; r++) {
+            for(int c=0; c<3; c++)
+                R[3*r+c] = R0[r]*T[c] + R0[3+r]*T[4+c] + R0[6+r]*T[8+c];
+            d[r] = T[4*r+3] - t0[r];
+        }
+        for(int r=0; r<3; r++) {
+            for(int c=0; c<3; c++)
+                T[4*r+c] = R[3*r+c];
+            T[4*r+3] = R0[r]*d[0] + R0[3+r]*d[1] + R0[6+r]*d[2];
+        }
+        to_quaternion(R, &quaternions[4*(first + i)]);
+    }
+    drives.push_back(time.size());
+
+}
+
+
+size_t Trajectory::size() const {
+    return time.size();
+}
+
+
+void Trajectory::pose(size_t idx, pose_t& out) const {
+    out.timestamp = time.at(idx);
+    std::copy(transforms.begin()+16*idx, transforms.begin()+16*(idx+1), out.T);
+}
+
+
+/**
+ * Drives are checked in turn, there are only a few
+ */
+bool Trajectory::drive_range(long timestamp, size_t& begin, size_t& end) const {
+    for(size_t d=0; d+1<drives.size(); d++) {
+        begin = drives.at(d);
+        end = drives.at(d+1);
+        if(timestamp >= time.at(begin) && timestamp <= time.at(end-1))
+            return true;
+    }
+    return false;
+}
+
+
+/**
+ * Finds the drive with the time, then the two records around it
+ */
+bool Trajectory::pose_at(long timestamp, pose_t& out) const {
+
+    // Find the drive
+    size_t begin, end;
+    if(!drive_range(timestamp, begin, end))
+        return false;
+
+    // First record after the time, the one before is at or before it
+    size_t i1 = (size_t)(std::upper_bound(time.begin()+begin, time.begin()+end, timestamp) - time.begin());
+    size_t i0 = i1 - 1;
+    if(i1 == end || time.at(i0) == timestamp) {
+        pose(i0, out);
+        out.timestamp = timestamp;
+        return true;
+    }
+
+    // Lerp the position
+    double alpha = (double)(timestamp - time.at(i0))/(double)(time.at(i1) - time.at(i0));
+    const double* T0 = &transforms[16*i0];
+    const double* T1 = &transforms[16*i1];
+    out.timestamp = timestamp;
+    out.T[3] = T0[3] + alpha*(T1[3] - T0[3]);
+    out.T[7] = T0[7] + alpha*(T1[7] - T0[7]);
+    out.T[11] = T0[11] + alpha*(T1[11] - T0[11]);
+    out.T[12] = 0; out.T[13] = 0; out.T[14] = 0; out.T[15] = 1;
+
+    // SLERP the rotation, the short way around
+    const double* q0 = &quaternions[4*i0];
+    double q1[4] = {quaternions[4*i1], quaternions[4*i1+1], quaternions[4*i1+2], quaternions[4*i1+3]};
+    double dot = q0[0]*q1[0] + q0[1]*q1[1] + q0[2]*q1[2] + q0[3]*q1[3];
+    if(dot < 0) {
+        dot = -dot;
+        for(int k=0; k<4; k++)
+            q1[k] = -q1[k];
+    }
+    double w0 = 1.0 - alpha, w1 = alpha;
+    if(dot < 0.9995) {
+        double theta = acos(dot);
+        double s = sin(theta);
+        w0 = sin((1.0 - alpha)*theta)/s;
+        w1 = sin(alpha*theta)/s;
+    }
+    double q[4];
+    double norm = 0;
+    for(int k=0; k<4; k++) {
+        q[k] = w0*q0[k] + w1*q1[k];
+        norm += q[k]*q[k];
+    }
+    norm = sqrt(norm);
+    for(int k=0; k<4; k++)
+        q[k] /= norm;
+    to_rotation(q, out.T);
+    return true;
+
+}
@@ -0,0 +1,81 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_TRAJECTORY_H
+#define KITTI_PARSER_TRAJECTORY_H
+
+#include <vector>
+#include <cstddef>
+#include "kitti_parser/types/pose_t.h"
+#include "kitti_parser/util/OxtsTable.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * Poses of the IMU for every OXTS record, computed once when the drive is loaded
+     * Positions use the Mercator projection scaled by the latitude of the first record, and
+     * rotations are Rz(yaw)*Ry(pitch)*Rx(roll), same as convertOxtsToPose in the KITTI devkit.
+     * Every pose is relative to the first record of its drive. Poses at other times are
+     * found with a binary search, then the rotation is SLERPed and the position lerped.
+     */
+    class Trajectory {
+
+    public:
+
+        // Adds the records [begin, end) of the table as a drive
+        void add_drive(const OxtsTable& table, size_t begin, size_t end);
+
+        // Number of poses
+        size_t size() const;
+
+        // Pose of a single record
+        void pose(size_t idx, pose_t& out) const;
+
+        // Pose at any time inside of a drive, false if the time is outside of all drives
+        bool pose_at(long timestamp, pose_t& out) const;
+
+        // Records [begin, end) of the drive with the time, false if the time is outside of all drives
+        bool drive_range(long timestamp, size_t& begin, size_t& end) const;
+
+    private:
+
+        // Timestamps of each record
+        std::vector<long> time;
+
+        // Row major 4x4 transform of each record, 16 values each
+        std::vector<double> transforms;
+
+        // Rotation of each record as a quaternion (w,x,y,z), 4 values each
+        std::vector<double> quaternions;
+
+        // First record of each drive, plus the end of the last one
+        std::vector<size_t> drives;
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_TRAJECTORY_H
@@ -0,0 +1,117 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KITTI_PARSER_WAITSTRATEGY_H
+#define KITTI_PARSER_WAITSTRATEGY_H
+
+#include <atomic>
+#include <thread>
+#include <climits>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+
+namespace kitti_parser {
+
+    /**
+     * Blocking for the lock-free queues
+     * Waiting spins for a short while, since the other side is normally quick, and then sleeps on a futex.
+     * Notifying is a single atomic increment unless somebody is actually asleep.
+     */
+    class WaitStrategy {
+
+    public:
+
+        // Number of times we check before going to sleep
+        static const int SPIN_COUNT = 256;
+
+        // Block until the condition is true
+        template<typename Pred>
+        void wait(Pred ready) {
+            // Spin first
+            for(int i=0; i<SPIN_COUNT; i++) {
+                if(ready())
+                    return;
+                relax();
+            }
+            // Then sleep till someone notifies us
+            while(!ready()) {
+                int seen = seq.load(std::memory_order_acquire);
+                sleepers.fetch_add(1, std::memory_order_seq_cst);
+                if(!ready())
+                    sleep(seen);
+                sleepers.fetch_sub(1, std::memory_order_seq_cst);
+            }
+        }
+
+        // Wake everyone that is waiting
+        void notify() {
+            seq.fetch_add(1, std::memory_order_seq_cst);
+            if(sleepers.load(std::memory_order_seq_cst) > 0)
+                wake();
+        }
+
+    private:
+
+        // Changes on every notify, this is what we sleep on
+        std::atomic<int> seq{0};
+
+        // Number of threads that are asleep, or about to be
+        std::atomic<int> sleepers{0};
+
+        // Tell the cpu we are spinning
+        static inline void relax() {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield");
+#endif
+        }
+
+        // Sleep while the sequence has not changed
+        void sleep(int seen) {
+#ifdef __linux__
+            syscall(SYS_futex, reinterpret_cast<int*>(&seq), FUTEX_WAIT_PRIVATE, seen, nullptr, nullptr, 0);
+#else
+            if(seq.load(std::memory_order_acquire) == seen)
+                std::this_thread::yield();
+#endif
+        }
+
+        // Wake all sleepers
+        void wake() {
+#ifdef __linux__
+            syscall(SYS_futex, reinterpret_cast<int*>(&seq), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+        }
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_WAITSTRATEGY_H
@@ -0,0 +1,482 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "kitti_parser/util/ZipStorage.h"
+#include "kitti_parser/util/MpmcQueue.h"
+#include "kitti_parser/util/Crc32.h"
+#include <cstring>
+#include <climits>
+#include <thread>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+using namespace std;
+using namespace kitti_parser;
+
+
+const std::string ZipStorage::EXTENSION = ".zip";
+
+// Record signatures
+static const uint32_t SIG_LOCAL = 0x04034b50;
+static const uint32_t SIG_CENTRAL = 0x02014b50;
+static const uint32_t SIG_END = 0x06054b50;
+static const uint32_t SIG_END64 = 0x06064b50;
+static const uint32_t SIG_LOCATOR64 = 0x07064b50;
+
+// Fixed sizes of the records
+static const size_t SIZE_LOCAL = 30;
+static const size_t SIZE_CENTRAL = 46;
+static const size_t SIZE_END = 22;
+static const size_t SIZE_END64 = 56;
+static const size_t SIZE_LOCATOR64 = 20;
+
+// Compression methods we can read
+static const int METHOD_STORED = 0;
+static const int METHOD_DEFLATE = 8;
+
+// Files after the one read that are inflated ahead, and the most kept at once
+static const size_t AHEAD_FILES = 2;
+static const size_t MAX_AHEAD = 64;
+
+
+// Little endian fields
+static uint16_t get_u16(const char* p) {
+    uint16_t v;
+    memcpy(&v, p, 2);
+    return le16toh(v);
+}
+
+static uint32_t get_u32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return le32toh(v);
+}
+
+static uint64_t get_u64(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return le64toh(v);
+}
+
+
+namespace {
+
+    /**
+     * Worker threads that inflate files ahead, shared by all open archives
+     * Started on first use, and they finish any queued files before the process exits.
+     */
+    class InflatePool {
+
+    public:
+
+        static InflatePool& instance() {
+            static InflatePool pool;
+            return pool;
+        }
+
+        // Run the job on a worker, false if too many are queued
+        bool submit(std::function<void()>& job) {
+            std::call_once(started, [this]() {
+                size_t count = std::max(1u, std::thread::hardware_concurrency());
+                for(size_t i=0; i<count; i++) {
+                    workers.emplace_back([this]() {
+                        std::function<void()> next;
+                        while(jobs.pop(next))
+                            next();
+                    });
+                }
+            });
+            return jobs.try_push(job);
+        }
+
+        ~InflatePool() {
+            jobs.close();
+            for(size_t i=0; i<workers.size(); i++)
+                workers.at(i).join();
+        }
+
+    private:
+
+        InflatePool() : jobs(256) {}
+
+        MpmcQueue<std::function<void()>> jobs;
+        std::vector<std::thread> workers;
+        std::once_flag started;
+
+    };
+
+}
+
+
+/**
+ * Opens the archive and reads its central directory
+ * See APPNOTE.TXT of PKWARE for the layout of each record
+ */
+ZipStorage::ZipStorage(std::string path_zip) {
+
+    // Open the archive
+    fd = open(path_zip.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < SIZE_END) {
+        close(fd);
+        fd = -1;
+        return;
+    }
+    uint64_t size = (uint64_t)st.st_size;
+
+    // The end record is last, only followed by a comment of up to 64k
+    size_t tail = (size_t)std::min<uint64_t>(size, SIZE_END + 65535);
+    std::vector<char> buffer(tail);
+    size_t at = tail;
+    if(read_raw(size - tail, tail, buffer.data())) {
+        for(size_t i=tail-SIZE_END+1; i-- > 0;) {
+            if(get_u32(buffer.data()+i) == SIG_END) {
+                at = i;
+                break;
+            }
+        }
+    }
+    if(at == tail) {
+        std::cerr << "[kitti_parser]: No zip central directory in " << path_zip << std::endl;
+        close(fd);
+        fd = -1;
+        return;
+    }
+    uint64_t count = get_u16(buffer.data()+at+10);
+    uint64_t cd_size = get_u32(buffer.data()+at+12);
+    uint64_t cd_offset = get_u32(buffer.data()+at+16);
+
+    // Archives over 4GB or with many files have a zip64 end record, found through the locator before the end record
+    uint64_t end = size - tail + at;
+    char locator[SIZE_LOCATOR64];
+    if(end >= SIZE_LOCATOR64 && read_raw(end - SIZE_LOCATOR64, SIZE_LOCATOR64, locator)
+       && get_u32(locator) == SIG_LOCATOR64) {
+        char record[SIZE_END64];
+        if(read_raw(get_u64(locator+8), SIZE_END64, record) && get_u32(record) == SIG_END64) {
+            count = get_u64(record+32);
+            cd_size = get_u64(record+40);
+            cd_offset = get_u64(record+48);
+        }
+    }
+
+    // Read the whole central directory at once
+    std::vector<char> cd((size_t)cd_size);
+    if(cd_offset + cd_size > size || !read_raw(cd_offset, cd.size(), cd.data())) {
+        std::cerr << "[kitti_parser]: Unable to read the zip central directory of " << path_zip << std::endl;
+        close(fd);
+        fd = -1;
+        return;
+    }
+
+    // One header per file
+    size_t pos = 0;
+    for(uint64_t n=0; n<count && pos + SIZE_CENTRAL <= cd.size(); n++) {
+
+        const char* p = cd.data() + pos;
+        if(get_u32(p) != SIG_CENTRAL) {
+            std::cerr << "[kitti_parser]: Invalid zip central directory in " << path_zip << " at " << pos << std::endl;
+            break;
+        }
+        uint16_t flags = get_u16(p+8);
+        int method = get_u16(p+10);
+        uint32_t crc = get_u32(p+16);
+        uint64_t length = get_u32(p+20);
+        uint64_t size_file = get_u32(p+24);
+        size_t name_length = get_u16(p+28);
+        size_t extra_length = get_u16(p+30);
+        size_t comment_length = get_u16(p+32);
+        uint64_t offset = get_u32(p+42);
+        if(pos + SIZE_CENTRAL + name_length + extra_length + comment_length > cd.size())
+            break;
+        std::string name(p + SIZE_CENTRAL, name_length);
+        pos += SIZE_CENTRAL + name_length + extra_length + comment_length;
+
+        // Sizes and offset that do not fit are in the zip64 extra field, in this order
+        const char* extra = p + SIZE_CENTRAL + name_length;
+        const char* extra_end = extra + extra_length;
+        while(extra + 4 <= extra_end) {
+            uint16_t id = get_u16(extra);
+            const char* field_end = std::min(extra + 4 + get_u16(extra+2), extra_end);
+            const char* field = extra + 4;
+            if(id == 0x0001) {
+                if(size_file == 0xFFFFFFFF && field + 8 <= field_end) {
+                    size_file = get_u64(field);
+                    field += 8;
+                }
+                if(length == 0xFFFFFFFF && field + 8 <= field_end) {
+                    length = get_u64(field);
+                    field += 8;
+                }
+                if(offset == 0xFFFFFFFF && field + 8 <= field_end)
+                    offset = get_u64(field);
+            }
+            extra = field_end;
+        }
+
+        // Folders exist through their files, and we can only read stored or deflated files
+        if(name.empty() || name.back() == '/')
+            continue;
+        if((flags & 0x1) != 0 || (method != METHOD_STORED && method != METHOD_DEFLATE)) {
+            std::cerr << "[kitti_parser]: Skipping " << name << " in " << path_zip << ", it is encrypted or uses method " << method << std::endl;
+            continue;
+        }
+        if(name.compare(0, 2, "./") == 0)
+            name = name.substr(2);
+        entry_t entry;
+        entry.offset = offset;
+        entry.length = length;
+        entry.size = size_file;
+        entry.method = method;
+        entry.crc = crc;
+        entry.resolved.store(false);
+        entries[clean(name)] = entry;
+
+    }
+
+    // Move into the drive folder
+    strip_to_drive();
+
+}
+
+
+/**
+ * Files being inflated ahead read from the archive, so wait for them first
+ */
+ZipStorage::~ZipStorage() {
+    std::lock_guard<std::mutex> guard(lock_ahead);
+    for(std::map<std::string, std::shared_ptr<inflated_t>>::iterator it=ahead.begin(); it!=ahead.end(); ++it) {
+        std::shared_ptr<inflated_t> item = it->second;
+        item->finished.wait([&]() { return item->state.load(std::memory_order_acquire) != 0; });
+    }
+}
+
+
+/**
+ * Parts of deflated files need the whole file inflated
+ */
+bool ZipStorage::read(const std::string& path, uint64_t offset, size_t length, char* out) {
+    const entry_t* entry = find(path);
+    if(entry == nullptr || entry->method == METHOD_STORED)
+        return ArchiveStorage::read(path, offset, length, out);
+    std::vector<char> data;
+    if(offset + length > entry->size || !load(clean(path), *entry, data))
+        return false;
+    if(length > 0)
+        memcpy(out, data.data() + offset, length);
+    return true;
+}
+
+
+bool ZipStorage::read_all(const std::string& path, std::vector<char>& out) {
+    const entry_t* entry = find(path);
+    if(entry == nullptr || entry->method == METHOD_STORED)
+        return ArchiveStorage::read_all(path, out);
+    if(!load(clean(path), *entry, out)) {
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * Deflated files are inflated into their own buffer, which the mapping owns
+ */
+std::shared_ptr<const mapping_t> ZipStorage::map(const std::string& path) {
+    const entry_t* entry = find(path);
+    if(entry == nullptr || entry->method == METHOD_STORED)
+        return ArchiveStorage::map(path);
+    std::shared_ptr<std::vector<char>> data = std::make_shared<std::vector<char>>();
+    if(!load(clean(path), *entry, *data))
+        return std::shared_ptr<const mapping_t>();
+    mapping_t* view = new mapping_t{data->data(), data->size()};
+    return std::shared_ptr<const mapping_t>(view, [data](const mapping_t* m) { delete m; });
+}
+
+
+/**
+ * Deflated files are inflated ahead, stored ones are read ahead by the kernel
+ */
+void ZipStorage::will_need(const std::string& path) {
+    const entry_t* entry = find(path);
+    if(entry == nullptr || entry->method == METHOD_STORED) {
+        ArchiveStorage::will_need(path);
+        return;
+    }
+    queue(clean(path), *entry);
+}
+
+
+/**
+ * The data follows the local header, which can have a different extra field than the central one
+ * So until a file is first used its offset is that of the local header, and we read the header here
+ */
+bool ZipStorage::resolve(const entry_t& entry) const {
+    std::lock_guard<std::mutex> guard(lock_resolve);
+    if(entry.resolved.load(std::memory_order_relaxed))
+        return true;
+    char local[SIZE_LOCAL];
+    if(!read_raw(entry.offset, SIZE_LOCAL, local) || get_u32(local) != SIG_LOCAL) {
+        std::cerr << "[kitti_parser]: Invalid zip local header at offset " << entry.offset << std::endl;
+        return false;
+    }
+    entry.offset += SIZE_LOCAL + get_u16(local+26) + get_u16(local+28);
+    entry.resolved.store(true, std::memory_order_release);
+    return true;
+}
+
+
+/**
+ * Raw deflate, then checked against the size and CRC from the directory
+ */
+bool ZipStorage::decompress(const entry_t& entry, std::vector<char>& out) const {
+
+    // Compressed bytes
+    if(entry.length > UINT_MAX || entry.size > UINT_MAX)
+        return false;
+    if(!entry.resolved.load(std::memory_order_acquire) && !resolve(entry))
+        return false;
+    std::vector<char> in((size_t)entry.length);
+    if(!read_raw(entry.offset, in.size(), in.data()))
+        return false;
+    drop(entry.offset, entry.length);
+
+    // Inflate all of it in one call, we know the size
+    out.resize((size_t)entry.size);
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if(inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+        return false;
+    stream.next_in = (Bytef*)in.data();
+    stream.avail_in = (uInt)in.size();
+    stream.next_out = (Bytef*)out.data();
+    stream.avail_out = (uInt)out.size();
+    int ret = ::inflate(&stream, Z_FINISH);
+    bool success = (ret == Z_STREAM_END && stream.total_out == entry.size);
+    inflateEnd(&stream);
+    if(!success || Crc32::update(0, out.data(), out.size()) != entry.crc) {
+        std::cerr << "[kitti_parser]: Corrupt deflated file in zip archive" << std::endl;
+        return false;
+    }
+    return true;
+
+}
+
+
+/**
+ * Takes the file if it was queued, waiting if a worker is still on it
+ * Either way the next files of its folder get queued, so they are ready for the next read
+ */
+bool ZipStorage::load(const std::string& name, const entry_t& entry, std::vector<char>& out) {
+
+    std::shared_ptr<inflated_t> item;
+    {
+        std::lock_guard<std::mutex> guard(lock_ahead);
+        std::map<std::string, std::shared_ptr<inflated_t>>::iterator it = ahead.find(name);
+        if(it != ahead.end()) {
+            item = it->second;
+            ahead.erase(it);
+            ahead_order.erase(std::find(ahead_order.begin(), ahead_order.end(), name));
+        }
+    }
+    queue_next(name);
+
+    if(item) {
+        item->finished.wait([&]() { return item->state.load(std::memory_order_acquire) != 0; });
+        if(item->state.load(std::memory_order_acquire) == 1) {
+            out.swap(item->data);
+            return true;
+        }
+    }
+    return decompress(entry, out);
+
+}
+
+
+/**
+ * Queues a file for the workers, dropping the oldest finished one if we have too many
+ * If the oldest is still being inflated we are far enough ahead already.
+ */
+void ZipStorage::queue(const std::string& name, const entry_t& entry) {
+
+    if(entry.method == METHOD_STORED)
+        return;
+    std::shared_ptr<inflated_t> item = std::make_shared<inflated_t>();
+    {
+        std::lock_guard<std::mutex> guard(lock_ahead);
+        if(ahead.find(name) != ahead.end())
+            return;
+        if(ahead.size() >= MAX_AHEAD) {
+            std::map<std::string, std::shared_ptr<inflated_t>>::iterator oldest = ahead.find(ahead_order.front());
+            if(oldest->second->state.load(std::memory_order_acquire) == 0)
+                return;
+            ahead.erase(oldest);
+            ahead_order.pop_front();
+        }
+        ahead[name] = item;
+        ahead_order.push_back(name);
+    }
+
+    // The job only uses the archive until it marks the file done, we wait for that before closing
+    // It takes the entry in the index, not a copy, since another read can resolve its offset meanwhile
+    const entry_t* indexed = &entry;
+    std::function<void()> job = [this, item, indexed]() {
+        bool success = decompress(*indexed, item->data);
+        item->state.store(success? 1 : 2, std::memory_order_release);
+        item->finished.notify();
+    };
+    if(!InflatePool::instance().submit(job)) {
+        // A read might already be waiting on it, so mark it failed and it will inflate it itself
+        item->state.store(2, std::memory_order_release);
+        item->finished.notify();
+        std::lock_guard<std::mutex> guard(lock_ahead);
+        std::map<std::string, std::shared_ptr<inflated_t>>::iterator it = ahead.find(name);
+        if(it != ahead.end() && it->second == item) {
+            ahead.erase(it);
+            ahead_order.erase(std::find(ahead_order.begin(), ahead_order.end(), name));
+        }
+    }
+
+}
+
+
+void ZipStorage::queue_next(const std::string& name) {
+    size_t slash = name.rfind('/');
+    std::string folder = (slash == std::string::npos)? "" : name.substr(0, slash + 1);
+    std::map<std::string, entry_t>::const_iterator it = entries.upper_bound(name);
+    for(size_t n=0; it != entries.end() && n < AHEAD_FILES; ++it, ++n) {
+        if(it->first.compare(0, folder.size(), folder) != 0 || it->first.find('/', folder.size()) != std::string::npos)
+            break;
+        queue(it->first, it->second);
+    }
+}
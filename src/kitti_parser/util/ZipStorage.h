@@ -0,0 +1,104 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef KITTI_PARSER_ZIPSTORAGE_H
+#define KITTI_PARSER_ZIPSTORAGE_H
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "kitti_parser/util/Storage.h"
+#include "kitti_parser/util/WaitStrategy.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * A zip archive of a drive (.zip), like the *_sync.zip files KITTI is distributed as
+     * The central directory is read once when opened to build the index, with zip64 for archives over 4GB.
+     * The local header of each file is only read the first time the file is used.
+     * Stored entries are read like any other archive, with a pread at their offset. Deflated entries are
+     * inflated whole and checked against their CRC. When one is read, the next files of the same folder
+     * are inflated ahead on a pool of worker threads, so each stream finds its next file already done.
+     */
+    class ZipStorage : public ArchiveStorage {
+
+    public:
+
+        // File extension of zip archives
+        static const std::string EXTENSION;
+
+        // Default constructor, opens the archive and indexes it
+        ZipStorage(std::string path_zip);
+
+        // Waits for the files still being inflated
+        ~ZipStorage() override;
+
+        bool read(const std::string& path, uint64_t offset, size_t length, char* out) override;
+        bool read_all(const std::string& path, std::vector<char>& out) override;
+        std::shared_ptr<const mapping_t> map(const std::string& path) override;
+        void will_need(const std::string& path) override;
+
+    private:
+
+        // A file inflated ahead of its read
+        struct inflated_t {
+            std::vector<char> data;
+            // Pending, done or failed
+            std::atomic<int> state{0};
+            WaitStrategy finished;
+        };
+
+        // Files inflated ahead, in the order they were queued
+        std::map<std::string, std::shared_ptr<inflated_t>> ahead;
+        std::deque<std::string> ahead_order;
+        std::mutex lock_ahead;
+
+        // Reads the local header of an entry to find where its data starts
+        bool resolve(const entry_t& entry) const override;
+        mutable std::mutex lock_resolve;
+
+        // Inflate a whole entry, on the calling thread
+        bool decompress(const entry_t& entry, std::vector<char>& out) const;
+
+        // Whole file, from the files inflated ahead or else inflated now
+        bool load(const std::string& name, const entry_t& entry, std::vector<char>& out);
+
+        // Queue a deflated file to be inflated ahead, the entry has to be the one in the index
+        void queue(const std::string& name, const entry_t& entry);
+
+        // Queue the files after this one in its folder
+        void queue_next(const std::string& name);
+
+    };
+
+}
+
+
+#endif //KITTI_PARSER_ZIPSTORAGE_H
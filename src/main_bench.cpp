@@ -0,0 +1,375 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <boost/filesystem.hpp>
+#include "kitti_parser/Parser.h"
+
+
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// Size of the synthetic dataset
+struct options_t {
+    std::string path;
+    int frames = 200;
+    int width = 1242;
+    int height = 375;
+    int points = 120000;
+    int oxts_per_frame = 10;
+    bool keep = false;
+};
+
+// Results of a single measurement
+struct result_t {
+    double seconds = 0;
+    size_t messages = 0;
+    size_t bytes = 0;
+};
+
+void generate_dataset(const options_t& opts, std::string path_drive);
+void drop_cache(std::string path);
+result_t bench_fetch(std::string path_drive, sensor_t sensor);
+result_t bench_run(std::string path_date);
+void print_result(std::string name, const result_t& res);
+size_t free_message(Loader::message_types* next);
+
+int main(int argc, char** argv) {
+
+    // Debug message
+    cout << "[kitti_parser]: Starting up" << endl;
+
+
+    // Parse the input
+    options_t opts;
+    for(int i=1; i<argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--keep") {
+            opts.keep = true;
+        } else if(i+1 < argc && arg == "--frames") {
+            opts.frames = atoi(argv[++i]);
+        } else if(i+1 < argc && arg == "--width") {
+            opts.width = atoi(argv[++i]);
+        } else if(i+1 < argc && arg == "--height") {
+            opts.height = atoi(argv[++i]);
+        } else if(i+1 < argc && arg == "--points") {
+            opts.points = atoi(argv[++i]);
+        } else if(i+1 < argc && arg == "--oxts-per-frame") {
+            opts.oxts_per_frame = atoi(argv[++i]);
+        } else if(opts.path.empty() && arg.compare(0, 2, "--") != 0) {
+            opts.path = arg;
+        } else {
+            opts.path.clear();
+            break;
+        }
+    }
+
+    // Check if there is a path to work in
+    if(opts.path.empty() || opts.frames < 1 || opts.width < 1 || opts.height < 1 || opts.points < 1 || opts.oxts_per_frame < 1) {
+        cerr << "[kitti_parser]: Usage: kitti_bench <work folder> [--frames N] [--width W] [--height H]"
+             << " [--points P] [--oxts-per-frame N] [--keep]" << endl;
+        return EXIT_FAILURE;
+    }
+
+
+    // Generate the dataset
+    std::string path_date = opts.path + "/2011_01_01/";
+    std::string path_drive = path_date + "2011_01_01_drive_0001_sync";
+    cout << "[kitti_parser]: Generating " << opts.frames << " frames in \"" << path_date << "\"" << endl;
+    auto t0 = std::chrono::steady_clock::now();
+    generate_dataset(opts, path_drive);
+    double t_gen = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    cout << "\tDone in " << std::fixed << std::setprecision(2) << t_gen << " seconds" << endl;
+
+
+    // Index build
+    drop_cache(path_date);
+    t0 = std::chrono::steady_clock::now();
+    {
+        kitti_parser::Parser parser(path_date);
+    }
+    double t_index_cold = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    t0 = std::chrono::steady_clock::now();
+    {
+        kitti_parser::Parser parser(path_date);
+    }
+    double t_index_warm = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    cout << "Index Build:" << endl;
+    cout << "\tcold: " << std::setprecision(3) << 1000*t_index_cold << " ms" << endl;
+    cout << "\twarm: " << std::setprecision(3) << 1000*t_index_warm << " ms" << endl;
+
+
+    // Each sensor on its own, and then a full run
+    const char* names[SENSOR_COUNT] = {"Stereo Gray", "Stereo Color", "Lidar", "GPS/IMU (with load)"};
+    for(int mode=0; mode<2; mode++) {
+        cout << ((mode == 0)? "Cold Cache:" : "Warm Cache:") << endl;
+        for(int s=0; s<SENSOR_COUNT; s++) {
+            if(mode == 0)
+                drop_cache(path_date);
+            print_result(names[s], bench_fetch(path_drive, (sensor_t)s));
+        }
+        if(mode == 0)
+            drop_cache(path_date);
+        print_result("Parser::run", bench_run(path_date));
+    }
+
+
+    // Clean up
+    if(!opts.keep) {
+        boost::filesystem::remove_all(path_date);
+    }
+
+    // We are done, so return
+    return EXIT_SUCCESS;
+
+}
+
+
+/**
+ * Writes a KITTI timestamp file, with the given start and period in ms
+ */
+void write_timestamps(std::string path, int count, long start, double period) {
+    std::ofstream file(path);
+    for(int i=0; i<count; i++) {
+        long t = start + (long)(i*period);
+        time_t sec = (time_t)(t/1000);
+        struct tm tm;
+        gmtime_r(&sec, &tm);
+        char buf[64];
+        strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+        file << buf << "." << std::setw(3) << std::setfill('0') << (t%1000) << "000000" << "\n";
+    }
+}
+
+
+/**
+ * Generates a drive in the same layout as the KITTI raw data
+ * Images are smooth gradients with noise so the PNGs are not trivially compressible
+ */
+void generate_dataset(const options_t& opts, std::string path_drive) {
+
+    // Start at the first day, 10Hz cameras and lidar
+    std::mt19937 rng(42);
+    long start = 1293876000000;
+    const char* cameras[4] = {"image_00", "image_01", "image_02", "image_03"};
+    char name[32];
+
+    // Cameras
+    for(int c=0; c<4; c++) {
+        std::string path_cam = path_drive + "/" + cameras[c] + "/";
+        boost::filesystem::create_directories(path_cam + "data/");
+        write_timestamps(path_cam + "timestamps.txt", opts.frames, start, 100.0);
+        bool color = (c >= 2);
+        cv::Mat image(opts.height, opts.width, (color)? CV_8UC3 : CV_8UC1);
+        for(int i=0; i<opts.frames; i++) {
+            for(int r=0; r<image.rows; r++) {
+                uchar* row = image.ptr(r);
+                for(int k=0; k<image.cols*image.channels(); k++) {
+                    row[k] = (uchar)((r + k/image.channels() + 3*i + (int)(rng() % 16)) & 0xFF);
+                }
+            }
+            snprintf(name, sizeof(name), "%010d.png", i);
+            cv::imwrite(path_cam + "data/" + name, image);
+        }
+    }
+
+    // Lidar, rings of points around the car
+    std::string path_velo = path_drive + "/velodyne_points/";
+    boost::filesystem::create_directories(path_velo + "data/");
+    write_timestamps(path_velo + "timestamps.txt", opts.frames, start, 100.0);
+    write_timestamps(path_velo + "timestamps_start.txt", opts.frames, start - 50, 100.0);
+    write_timestamps(path_velo + "timestamps_end.txt", opts.frames, start + 50, 100.0);
+    std::uniform_real_distribution<float> noise(-0.02f, 0.02f);
+    std::vector<float> scan(4*(size_t)opts.points);
+    for(int i=0; i<opts.frames; i++) {
+        for(int p=0; p<opts.points; p++) {
+            float angle = 6.2831853f*(float)(p % 2000)/2000.0f;
+            float range = 5.0f + (float)(p/2000) + noise(rng);
+            scan[4*p+0] = range*std::cos(angle);
+            scan[4*p+1] = range*std::sin(angle);
+            scan[4*p+2] = -1.7f + 0.05f*(float)(p/2000) + noise(rng);
+            scan[4*p+3] = std::fabs(noise(rng))*20.0f;
+        }
+        snprintf(name, sizeof(name), "%010d.bin", i);
+        FILE* stream = fopen((path_velo + "data/" + name).c_str(), "wb");
+        fwrite(scan.data(), sizeof(float), scan.size(), stream);
+        fclose(stream);
+    }
+
+    // GPS/IMU, 30 values per line
+    std::string path_oxts = path_drive + "/oxts/";
+    boost::filesystem::create_directories(path_oxts + "data/");
+    int num_oxts = opts.frames*opts.oxts_per_frame;
+    write_timestamps(path_oxts + "timestamps.txt", num_oxts, start, 100.0/opts.oxts_per_frame);
+    for(int i=0; i<num_oxts; i++) {
+        snprintf(name, sizeof(name), "%010d.txt", i);
+        std::ofstream file(path_oxts + "data/" + name);
+        file << std::setprecision(14) << 49.0 + 1e-6*i << " " << 8.4 + 1e-6*i << " " << 110.0 + noise(rng);
+        for(int k=3; k<25; k++) {
+            file << " " << noise(rng);
+        }
+        file << " 4 10 4 4 6\n";
+    }
+
+}
+
+
+/**
+ * Asks the kernel to drop the files of the dataset from the page cache
+ * This works without root, but only for pages that are not dirty
+ */
+void drop_cache(std::string path) {
+    sync();
+    boost::filesystem::recursive_directory_iterator it(path), it_end;
+    for(; it != it_end; ++it) {
+        if(!boost::filesystem::is_regular_file(it->path()))
+            continue;
+        int fd = open(it->path().c_str(), O_RDONLY);
+        if(fd < 0)
+            continue;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+
+/**
+ * Loads every message of a single sensor straight from a Loader
+ */
+result_t bench_fetch(std::string path_drive, sensor_t sensor) {
+
+    // Config with only this sensor enabled
+    Config config;
+    config.has_stereo_gray = (sensor == SENSOR_STEREO_GRAY);
+    config.has_stereo_color = (sensor == SENSOR_STEREO_COLOR);
+    config.has_lidar = (sensor == SENSOR_LIDAR);
+    config.has_gpsimu = (sensor == SENSOR_GPSIMU);
+    // OXTS records are all parsed when loading, so for them the load is timed as well
+    auto t0 = std::chrono::steady_clock::now();
+    Loader loader(&config);
+    loader.load_all(path_drive);
+    if(sensor != SENSOR_GPSIMU)
+        t0 = std::chrono::steady_clock::now();
+
+    // Fetch them all
+    result_t res;
+    Loader::message_types* next = loader.fetch_latest();
+    while(next != nullptr) {
+        res.bytes += free_message(next);
+        res.messages++;
+        next = loader.fetch_latest();
+    }
+    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return res;
+
+}
+
+
+/**
+ * Runs the full parser with callbacks that only count
+ */
+result_t bench_run(std::string path_date) {
+
+    // Count everything that comes in
+    result_t res;
+    kitti_parser::Parser parser(path_date);
+    parser.register_callback_stereo_gray([&](Config*, long, stereo_t* data) {
+        res.bytes += free_message(new Loader::message_types(data));
+        res.messages++;
+    });
+    parser.register_callback_stereo_color([&](Config*, long, stereo_t* data) {
+        res.bytes += free_message(new Loader::message_types(data));
+        res.messages++;
+    });
+    parser.register_callback_lidar([&](Config*, long, lidar_t* data) {
+        res.bytes += free_message(new Loader::message_types(data));
+        res.messages++;
+    });
+    parser.register_callback_gpsimu([&](Config*, long, gpsimu_t* data) {
+        res.bytes += free_message(new Loader::message_types(data));
+        res.messages++;
+    });
+
+    // Run it
+    auto t0 = std::chrono::steady_clock::now();
+    parser.run(1.0);
+    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return res;
+
+}
+
+
+/**
+ * Prints the throughput of a measurement
+ */
+void print_result(std::string name, const result_t& res) {
+    double secs = std::max(res.seconds, 1e-9);
+    cout << "\t" << std::left << std::setw(20) << name << std::right
+         << std::setw(8) << res.messages << " msgs "
+         << std::setw(10) << std::setprecision(1) << res.messages/secs << " msgs/s "
+         << std::setw(10) << std::setprecision(1) << res.bytes/secs/1e6 << " MB/s" << endl;
+}
+
+
+/**
+ * Frees a message, and returns the size of its decoded data
+ */
+size_t free_message(Loader::message_types* next) {
+    size_t bytes = 0;
+    switch (next->which()) {
+        case 0: {
+            stereo_t* s = boost::get<stereo_t *>(*next);
+            bytes = s->image_left.total()*s->image_left.elemSize() + s->image_right.total()*s->image_right.elemSize();
+            delete s;
+            break;
+        }
+        case 1: {
+            lidar_t* l = boost::get<lidar_t *>(*next);
+            bytes = l->points.size()*sizeof(std::array<float,4>);
+            delete l;
+            break;
+        }
+        case 2: {
+            bytes = sizeof(gpsimu_t);
+            delete boost::get<gpsimu_t *>(*next);
+            break;
+        }
+    }
+    delete next;
+    return bytes;
+}
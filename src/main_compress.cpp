@@ -0,0 +1,77 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include "kitti_parser/util/LidarArchive.h"
+
+
+
+using namespace std;
+using namespace kitti_parser;
+
+
+int main(int argc, char** argv) {
+
+    // Debug message
+    cout << "[kitti_parser]: Starting up" << endl;
+
+
+    // Check if there is a path to a dataset
+    if(argc != 2 && !(argc == 3 && std::string(argv[2]) == "--remove")) {
+        cerr << "[kitti_parser]: Error please specify a SINGLE dataset (optionally followed by --remove)" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Parse the input
+    std::string data_path = argv[1];
+    bool remove_raw = (argc == 3);
+
+
+    // Loop through all sub folders, same as the parser
+    boost::filesystem::path p(data_path);
+    vector<boost::filesystem::path> v;
+    copy(boost::filesystem::directory_iterator(p), boost::filesystem::directory_iterator(), back_inserter(v));
+    sort(v.begin(), v.end());
+
+    for (vector<boost::filesystem::path>::const_iterator it(v.begin()), it_end(v.end()); it != it_end; ++it) {
+
+        // Skip if file or no lidar
+        string folder = (*it).string() + "/velodyne_points/data/";
+        if(!boost::filesystem::is_directory(folder))
+            continue;
+
+        // Compress it
+        cout << "[kitti_parser]: Compressing \"" << (*it).filename().string() << "\"" << endl;
+        int count = LidarArchive::write_folder(folder, remove_raw);
+        cout << "\tCompressed " << count << " scans" << endl;
+    }
+
+
+    // We are done, so return
+    return EXIT_SUCCESS;
+
+}
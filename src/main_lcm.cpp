@@ -0,0 +1,73 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "kitti_parser/Parser.h"
+#include "kitti_parser/util/LcmPublisher.h"
+
+
+
+using namespace std;
+using namespace kitti_parser;
+
+
+int main(int argc, char** argv) {
+
+    // Debug message
+    cout << "[kitti_parser]: Starting up" << endl;
+
+
+    // Check if there is a path to a dataset
+    if(argc < 2 || argc > 4) {
+        cerr << "[kitti_parser]: Error please specify a SINGLE dataset" << endl;
+        cerr << "[kitti_parser]: Usage: main_lcm <dataset> [url] [speed]" << endl;
+        return EXIT_FAILURE;
+    }
+    std::string data_path = argv[1];
+    std::string url = (argc > 2)? argv[2] : LcmPublisher::DEFAULT_URL;
+    double speed = (argc > 3)? atof(argv[3]) : 1.0;
+
+
+    // Open the socket
+    LcmPublisher publisher(url);
+    if(!publisher.valid())
+        return EXIT_FAILURE;
+    cout << "[kitti_parser]: Publishing to \"" << url << "\"" << endl;
+
+
+    // Send everything from the dispatch thread, so the channels are in the same order as the callbacks
+    kitti_parser::Parser parser(data_path);
+    parser.register_callback_stereo_gray([&](Config*, long, stereo_t* data) { publisher.publish(*data); delete data; });
+    parser.register_callback_stereo_color([&](Config*, long, stereo_t* data) { publisher.publish(*data); delete data; });
+    parser.register_callback_lidar([&](Config*, long, lidar_t* data) { publisher.publish(*data); delete data; });
+    parser.register_callback_gpsimu([&](Config*, long, gpsimu_t* data) { publisher.publish(*data); delete data; });
+    parser.run(speed);
+
+
+    // We are done, so return
+    return EXIT_SUCCESS;
+
+}
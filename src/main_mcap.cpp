@@ -0,0 +1,84 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "kitti_parser/Parser.h"
+#include "kitti_parser/util/McapExporter.h"
+
+
+
+using namespace std;
+using namespace kitti_parser;
+
+
+int main(int argc, char** argv) {
+
+    // Debug message
+    cout << "[kitti_parser]: Starting up" << endl;
+
+
+    // Check if there is a path to a dataset and an output file
+    if(argc < 3 || argc > 5) {
+        cerr << "[kitti_parser]: Error please specify a SINGLE dataset and an output file" << endl;
+        cerr << "[kitti_parser]: Usage: main_mcap <dataset> <output.mcap> [chunk_mb] [workers]" << endl;
+        return EXIT_FAILURE;
+    }
+    std::string data_path = argv[1];
+    size_t chunk_mb = (argc > 3)? (size_t)atoi(argv[3]) : 4;
+    size_t workers = (argc > 4)? (size_t)atoi(argv[4]) : 0;
+
+
+    // Create the file
+    McapExporter exporter(argv[2], chunk_mb << 20, workers);
+    if(!exporter.valid())
+        return EXIT_FAILURE;
+    cout << "[kitti_parser]: Exporting to \"" << argv[2] << "\"" << endl;
+
+
+    // Pull the messages, so the reader thread loads ahead while the chunks are built and written
+    kitti_parser::Parser parser(data_path);
+    size_t count = 0;
+    while(Message msg = parser.next()) {
+        if(msg.stereo() != nullptr)
+            exporter.write(*msg.stereo());
+        else if(msg.lidar() != nullptr)
+            exporter.write(*msg.lidar());
+        else if(msg.gpsimu() != nullptr)
+            exporter.write(*msg.gpsimu());
+        count++;
+    }
+    if(!exporter.close()) {
+        cerr << "[kitti_parser]: Unable to finish \"" << argv[2] << "\"" << endl;
+        return EXIT_FAILURE;
+    }
+    cout << "\tExported " << count << " messages" << endl;
+
+
+    // We are done, so return
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,69 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include "kitti_parser/Parser.h"
+#include "kitti_parser/util/NpyExporter.h"
+
+
+
+using namespace std;
+using namespace kitti_parser;
+
+
+int main(int argc, char** argv) {
+
+    // Debug message
+    cout << "[kitti_parser]: Starting up" << endl;
+
+
+    // Check if there is a path to a dataset and an output folder
+    if(argc < 3 || argc > 4) {
+        cerr << "[kitti_parser]: Error please specify a SINGLE dataset and an output folder" << endl;
+        cerr << "[kitti_parser]: Usage: main_npy <dataset> <folder> [workers]" << endl;
+        return EXIT_FAILURE;
+    }
+    size_t workers = (argc > 3)? (size_t)atoi(argv[3]) : 0;
+
+
+    // Export everything
+    auto start = std::chrono::steady_clock::now();
+    kitti_parser::Parser parser(argv[1]);
+    NpyExporter exporter(parser, workers);
+    if(!exporter.write(argv[2])) {
+        cerr << "[kitti_parser]: Unable to export into \"" << argv[2] << "\"" << endl;
+        return EXIT_FAILURE;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << "\tExported into \"" << argv[2] << "\" in " << seconds << " seconds" << endl;
+
+
+    // We are done, so return
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,83 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include "kitti_parser/util/PackedDrive.h"
+
+
+
+using namespace std;
+using namespace kitti_parser;
+
+
+int main(int argc, char** argv) {
+
+    // Debug message
+    cout << "[kitti_parser]: Starting up" << endl;
+
+
+    // Check if there is a path to a dataset and an output
+    if(argc != 3) {
+        cerr << "[kitti_parser]: Error please specify a SINGLE dataset and an output folder" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Parse the input
+    boost::filesystem::path path_in(argv[1]);
+    boost::filesystem::path path_out(argv[2]);
+    boost::filesystem::create_directories(path_out);
+
+
+    // Loop through all sub folders, same as the parser
+    vector<boost::filesystem::path> v;
+    copy(boost::filesystem::directory_iterator(path_in), boost::filesystem::directory_iterator(), back_inserter(v));
+    sort(v.begin(), v.end());
+
+    for (vector<boost::filesystem::path>::const_iterator it(v.begin()), it_end(v.end()); it != it_end; ++it) {
+
+        // Calibration files are copied over as-is
+        if(boost::filesystem::is_regular_file(*it)) {
+            boost::filesystem::copy_file(*it, path_out / (*it).filename(), boost::filesystem::copy_option::overwrite_if_exists);
+            continue;
+        }
+
+        // Pack each drive
+        std::string name = (*it).filename().string();
+        cout << "[kitti_parser]: Packing \"" << name << "\"" << endl;
+        int count = PackedDrive::write((*it).string(), (path_out / (name + PackedDrive::EXTENSION)).string());
+        if(count < 0) {
+            cerr << "[kitti_parser]: Unable to pack \"" << name << "\"" << endl;
+            return EXIT_FAILURE;
+        }
+        cout << "\tPacked " << count << " files" << endl;
+    }
+
+
+    // We are done, so return
+    return EXIT_SUCCESS;
+
+}
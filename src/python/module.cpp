@@ -0,0 +1,534 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// Python.h has to come first, see https://docs.python.org/3/c-api/intro.html
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <mutex>
+#include <memory>
+#include <string>
+#include "kitti_parser/Parser.h"
+
+
+namespace kitti_parser {
+
+    /**
+     * The bindings fetch OXTS records by index and share pooled measurements, so they need the loader of a parser
+     */
+    class PythonModule {
+
+    public:
+
+        static Loader* loader(Parser& parser) {
+            return parser.loader;
+        }
+
+    };
+
+}
+
+using namespace kitti_parser;
+
+
+/**
+ * Read only array over memory owned by a measurement or a parser
+ * Exposed through the buffer protocol, so numpy.asarray() aliases it without a copy.
+ * The owner keeps the memory alive, lidar scans go back to the pool once the last array is gone.
+ */
+typedef struct {
+    PyObject_HEAD
+    std::shared_ptr<const void>* owner;
+    PyObject* base;
+    const void* data;
+    const char* format;
+    Py_ssize_t itemsize;
+    int ndim;
+    Py_ssize_t shape[3];
+    Py_ssize_t strides[3];
+} ArrayObject;
+
+// A parser, and the lock that keeps its single consumer pull API to one thread at a time
+typedef struct {
+    PyObject_HEAD
+    Parser* parser;
+    std::mutex* lock;
+} ParserObject;
+
+// A pulled or fetched measurement, shared so its arrays can outlive it
+typedef struct {
+    PyObject_HEAD
+    PyObject* parser;
+    std::shared_ptr<const void>* owner;
+    sensor_t sensor;
+    long timestamp;
+    const stereo_t* stereo;
+    const lidar_t* lidar;
+    const gpsimu_t* gpsimu;
+} MessageObject;
+
+static PyTypeObject ArrayType = {PyVarObject_HEAD_INIT(NULL, 0)};
+static PyTypeObject ParserType = {PyVarObject_HEAD_INIT(NULL, 0)};
+static PyTypeObject MessageType = {PyVarObject_HEAD_INIT(NULL, 0)};
+
+
+/**
+ * Creates an array over the data, which stays alive while the owner or the base object does
+ */
+static PyObject* array_new(const std::shared_ptr<const void>& owner, PyObject* base, const void* data,
+                           const char* format, Py_ssize_t itemsize, int ndim, const Py_ssize_t* shape, const Py_ssize_t* strides) {
+    ArrayObject* self = PyObject_New(ArrayObject, &ArrayType);
+    if(self == nullptr)
+        return nullptr;
+    self->owner = new std::shared_ptr<const void>(owner);
+    self->base = base;
+    Py_XINCREF(base);
+    self->data = data;
+    self->format = format;
+    self->itemsize = itemsize;
+    self->ndim = ndim;
+    for(int i=0; i<ndim; i++) {
+        self->shape[i] = shape[i];
+        self->strides[i] = strides[i];
+    }
+    return (PyObject*)self;
+}
+
+static void array_dealloc(ArrayObject* self) {
+    delete self->owner;
+    Py_XDECREF(self->base);
+    PyObject_Del(self);
+}
+
+static bool array_contiguous(ArrayObject* self) {
+    Py_ssize_t stride = self->itemsize;
+    for(int i=self->ndim-1; i>=0; i--) {
+        if(self->shape[i] > 1 && self->strides[i] != stride)
+            return false;
+        stride *= self->shape[i];
+    }
+    return true;
+}
+
+/**
+ * Shape and strides are only given if asked for, consumers that do not ask need a C contiguous array
+ */
+static int array_getbuffer(ArrayObject* self, Py_buffer* view, int flags) {
+    const char* error = nullptr;
+    bool contiguous = array_contiguous(self);
+    if((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE)
+        error = "kitti_parser arrays are read only";
+    else if(!contiguous && ((flags & PyBUF_STRIDES) != PyBUF_STRIDES
+                            || (flags & PyBUF_C_CONTIGUOUS) == PyBUF_C_CONTIGUOUS
+                            || (flags & PyBUF_ANY_CONTIGUOUS) == PyBUF_ANY_CONTIGUOUS))
+        error = "kitti_parser array is not contiguous";
+    else if((flags & PyBUF_F_CONTIGUOUS) == PyBUF_F_CONTIGUOUS && (flags & PyBUF_ANY_CONTIGUOUS) != PyBUF_ANY_CONTIGUOUS
+            && (self->ndim > 1 || !contiguous))
+        error = "kitti_parser arrays are not Fortran contiguous";
+    if(error != nullptr) {
+        PyErr_SetString(PyExc_BufferError, error);
+        view->obj = nullptr;
+        return -1;
+    }
+    view->buf = (void*)self->data;
+    view->obj = (PyObject*)self;
+    Py_INCREF(self);
+    view->len = self->itemsize;
+    for(int i=0; i<self->ndim; i++)
+        view->len *= self->shape[i];
+    view->readonly = 1;
+    view->itemsize = self->itemsize;
+    view->format = ((flags & PyBUF_FORMAT) == PyBUF_FORMAT)? (char*)self->format : nullptr;
+    view->ndim = self->ndim;
+    view->shape = ((flags & PyBUF_ND) == PyBUF_ND)? self->shape : nullptr;
+    view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES)? self->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+static Py_ssize_t array_len(ArrayObject* self) {
+    return (self->ndim > 0)? self->shape[0] : 0;
+}
+
+static PyBufferProcs array_buffer = {(getbufferproc)array_getbuffer, nullptr};
+static PySequenceMethods array_sequence = {(lenfunc)array_len};
+
+
+/**
+ * Arrays of the measurements, in the layout they are in memory
+ */
+static PyObject* image_array(MessageObject* msg, const cv::Mat& image) {
+    if(image.empty())
+        Py_RETURN_NONE;
+    const char* format;
+    switch(image.depth()) {
+        case CV_8U: format = "B"; break;
+        case CV_16U: format = "H"; break;
+        case CV_32F: format = "f"; break;
+        default:
+            PyErr_SetString(PyExc_TypeError, "unsupported image depth");
+            return nullptr;
+    }
+    Py_ssize_t shape[3] = {image.rows, image.cols, image.channels()};
+    Py_ssize_t strides[3] = {(Py_ssize_t)image.step[0], (Py_ssize_t)image.elemSize(), (Py_ssize_t)image.elemSize1()};
+    return array_new(*msg->owner, nullptr, image.ptr(0), format, (Py_ssize_t)image.elemSize1(),
+                     (image.channels() > 1)? 3 : 2, shape, strides);
+}
+
+static PyObject* points_array(MessageObject* msg) {
+    Py_ssize_t shape[2] = {(Py_ssize_t)msg->lidar->points.size(), 4};
+    Py_ssize_t strides[2] = {(Py_ssize_t)sizeof(std::array<float,4>), (Py_ssize_t)sizeof(float)};
+    return array_new(*msg->owner, nullptr, msg->lidar->points.data(), "f", sizeof(float), 2, shape, strides);
+}
+
+
+/**
+ * Wraps a measurement, lidar scans are shared through the pool of the loader
+ */
+static PyObject* message_new(ParserObject* parser, std::shared_ptr<const lidar_t> lidar) {
+    MessageObject* self = PyObject_New(MessageObject, &MessageType);
+    if(self == nullptr)
+        return nullptr;
+    self->parser = (PyObject*)parser;
+    Py_INCREF(parser);
+    self->owner = new std::shared_ptr<const void>(lidar);
+    self->stereo = nullptr;
+    self->lidar = lidar.get();
+    self->gpsimu = nullptr;
+    self->sensor = SENSOR_LIDAR;
+    self->timestamp = lidar->timestamp;
+    return (PyObject*)self;
+}
+
+static PyObject* message_new(ParserObject* parser, stereo_t* stereo, lidar_t* lidar, gpsimu_t* gpsimu) {
+    if(lidar != nullptr)
+        return message_new(parser, PythonModule::loader(*parser->parser)->share(lidar));
+    MessageObject* self = PyObject_New(MessageObject, &MessageType);
+    if(self == nullptr) {
+        delete stereo;
+        delete lidar;
+        delete gpsimu;
+        return nullptr;
+    }
+    Loader* loader = PythonModule::loader(*parser->parser);
+    self->parser = (PyObject*)parser;
+    Py_INCREF(parser);
+    self->stereo = nullptr;
+    self->lidar = nullptr;
+    self->gpsimu = nullptr;
+    if(stereo != nullptr) {
+        std::shared_ptr<const stereo_t> shared = loader->share(stereo);
+        self->owner = new std::shared_ptr<const void>(shared);
+        self->stereo = shared.get();
+        self->sensor = (stereo->is_color)? SENSOR_STEREO_COLOR : SENSOR_STEREO_GRAY;
+        self->timestamp = stereo->timestamp;
+    } else {
+        std::shared_ptr<const gpsimu_t> shared = loader->share(gpsimu);
+        self->owner = new std::shared_ptr<const void>(shared);
+        self->gpsimu = shared.get();
+        self->sensor = SENSOR_GPSIMU;
+        self->timestamp = gpsimu->timestamp;
+    }
+    return (PyObject*)self;
+}
+
+static void message_dealloc(MessageObject* self) {
+    delete self->owner;
+    Py_XDECREF(self->parser);
+    PyObject_Del(self);
+}
+
+static PyObject* message_sensor(MessageObject* self, void*) {
+    return PyLong_FromLong((long)self->sensor);
+}
+
+static PyObject* message_timestamp(MessageObject* self, void*) {
+    return PyLong_FromLong(self->timestamp);
+}
+
+static PyObject* message_is_color(MessageObject* self, void*) {
+    if(self->stereo == nullptr)
+        Py_RETURN_NONE;
+    return PyBool_FromLong(self->stereo->is_color);
+}
+
+static PyObject* message_left(MessageObject* self, void*) {
+    if(self->stereo == nullptr)
+        Py_RETURN_NONE;
+    return image_array(self, self->stereo->image_left);
+}
+
+static PyObject* message_right(MessageObject* self, void*) {
+    if(self->stereo == nullptr)
+        Py_RETURN_NONE;
+    return image_array(self, self->stereo->image_right);
+}
+
+static PyObject* message_points(MessageObject* self, void*) {
+    if(self->lidar == nullptr)
+        Py_RETURN_NONE;
+    return points_array(self);
+}
+
+static PyObject* message_timestamp_start(MessageObject* self, void*) {
+    if(self->lidar == nullptr)
+        Py_RETURN_NONE;
+    return PyLong_FromLong(self->lidar->timestamp_start);
+}
+
+static PyObject* message_timestamp_end(MessageObject* self, void*) {
+    if(self->lidar == nullptr)
+        Py_RETURN_NONE;
+    return PyLong_FromLong(self->lidar->timestamp_end);
+}
+
+// All fields of the OXTS record, named as in gpsimu_t
+static PyObject* message_oxts(MessageObject* self, void*) {
+    if(self->gpsimu == nullptr)
+        Py_RETURN_NONE;
+    const gpsimu_t& m = *self->gpsimu;
+    return Py_BuildValue("{s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:i,s:i,s:i,s:i,s:i}",
+                         "lat", m.lat, "lon", m.lon, "alt", m.alt, "roll", m.roll, "pitch", m.pitch, "yaw", m.yaw,
+                         "vn", m.vn, "ve", m.ve, "vf", m.vf, "vl", m.vl, "vu", m.vu,
+                         "ax", m.ax, "ay", m.ay, "az", m.az, "af", m.af, "al", m.al, "au", m.au,
+                         "wx", m.wx, "wy", m.wy, "wz", m.wz, "wf", m.wf, "wl", m.wl, "wu", m.wu,
+                         "pos_accuracy", m.pos_accuracy, "vel_accuracy", m.vel_accuracy,
+                         "navstat", m.navstat, "numsats", m.numsats, "posmode", m.posmode,
+                         "velmode", m.velmode, "orimode", m.orimode);
+}
+
+static PyGetSetDef message_getset[] = {
+    {(char*)"sensor", (getter)message_sensor, nullptr, (char*)"Sensor of the measurement, one of the SENSOR_* constants", nullptr},
+    {(char*)"timestamp", (getter)message_timestamp, nullptr, (char*)"Timestamp (ms)", nullptr},
+    {(char*)"is_color", (getter)message_is_color, nullptr, (char*)"True for the color cameras, None if not stereo", nullptr},
+    {(char*)"left", (getter)message_left, nullptr, (char*)"Left image, None if not stereo", nullptr},
+    {(char*)"right", (getter)message_right, nullptr, (char*)"Right image, None if not stereo", nullptr},
+    {(char*)"points", (getter)message_points, nullptr, (char*)"Lidar points as (N,4) float32 x,y,z,r, None if not lidar", nullptr},
+    {(char*)"timestamp_start", (getter)message_timestamp_start, nullptr, (char*)"Start of the scan (ms), None if not lidar", nullptr},
+    {(char*)"timestamp_end", (getter)message_timestamp_end, nullptr, (char*)"End of the scan (ms), None if not lidar", nullptr},
+    {(char*)"oxts", (getter)message_oxts, nullptr, (char*)"Dict of the OXTS fields, None if not GPS/IMU", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
+
+/**
+ * Parsers load the dataset without the GIL, the index can take a while for a whole date
+ */
+static int parser_init(ParserObject* self, PyObject* args, PyObject* kwds) {
+    static const char* keywords[] = {"path", nullptr};
+    const char* path;
+    if(!PyArg_ParseTupleAndKeywords(args, kwds, "s", (char**)keywords, &path))
+        return -1;
+    if(self->parser != nullptr) {
+        PyErr_SetString(PyExc_RuntimeError, "parser is already initialized");
+        return -1;
+    }
+    std::string data_path(path);
+    Parser* parser;
+    Py_BEGIN_ALLOW_THREADS
+    parser = new Parser(data_path);
+    Py_END_ALLOW_THREADS
+    if(!parser->valid()) {
+        delete parser;
+        PyErr_Format(PyExc_IOError, "unable to open dataset %s", path);
+        return -1;
+    }
+    self->parser = parser;
+    self->lock = new std::mutex();
+    return 0;
+}
+
+static void parser_dealloc(ParserObject* self) {
+    Parser* parser = self->parser;
+    Py_BEGIN_ALLOW_THREADS
+    delete parser;
+    Py_END_ALLOW_THREADS
+    delete self->lock;
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static bool parser_ready(ParserObject* self) {
+    if(self->parser == nullptr) {
+        PyErr_SetString(PyExc_RuntimeError, "parser is not initialized");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * The next message of the replay, or None once done
+ * Waiting and loading are done without the GIL, the lock only lets one thread into the pull queue at a time.
+ */
+static PyObject* parser_next(ParserObject* self, PyObject*) {
+    if(!parser_ready(self))
+        return nullptr;
+    Message msg;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> guard(*self->lock);
+        msg = self->parser->next();
+    }
+    Py_END_ALLOW_THREADS
+    if(!msg)
+        Py_RETURN_NONE;
+    switch(msg.sensor()) {
+        case SENSOR_STEREO_GRAY:
+        case SENSOR_STEREO_COLOR:
+            return message_new(self, msg.release_stereo(), nullptr, nullptr);
+        case SENSOR_LIDAR:
+            return message_new(self, nullptr, msg.release_lidar(), nullptr);
+        default:
+            return message_new(self, nullptr, nullptr, msg.release_gpsimu());
+    }
+}
+
+static PyObject* parser_iter(PyObject* self) {
+    Py_INCREF(self);
+    return self;
+}
+
+static PyObject* parser_iternext(ParserObject* self) {
+    PyObject* msg = parser_next(self, nullptr);
+    if(msg == Py_None) {
+        Py_DECREF(msg);
+        return nullptr;
+    }
+    return msg;
+}
+
+// Index of a stream, checked against its size
+static bool parser_index(ParserObject* self, PyObject* args, sensor_t sensor, Py_ssize_t& idx) {
+    if(!parser_ready(self) || !PyArg_ParseTuple(args, "n", &idx))
+        return false;
+    Py_ssize_t size = (Py_ssize_t)self->parser->times(sensor).size();
+    if(idx < 0)
+        idx += size;
+    if(idx < 0 || idx >= size) {
+        PyErr_SetString(PyExc_IndexError, "index out of range");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Random access by index, which can run on many threads at once since the GIL is released while reading
+ */
+static PyObject* parser_lidar(ParserObject* self, PyObject* args) {
+    Py_ssize_t idx;
+    if(!parser_index(self, args, SENSOR_LIDAR, idx))
+        return nullptr;
+    std::shared_ptr<const lidar_t> scan;
+    Py_BEGIN_ALLOW_THREADS
+    scan = self->parser->lidar_at((size_t)idx);
+    Py_END_ALLOW_THREADS
+    return message_new(self, scan);
+}
+
+static PyObject* parser_gpsimu(ParserObject* self, PyObject* args) {
+    Py_ssize_t idx;
+    if(!parser_index(self, args, SENSOR_GPSIMU, idx))
+        return nullptr;
+    gpsimu_t* meas = PythonModule::loader(*self->parser)->fetch_gpsimu((size_t)idx);
+    return message_new(self, nullptr, nullptr, meas);
+}
+
+// Timestamps (ms) of a stream, aliasing the index of the parser
+static PyObject* parser_times(ParserObject* self, PyObject* args) {
+    int sensor;
+    if(!parser_ready(self) || !PyArg_ParseTuple(args, "i", &sensor))
+        return nullptr;
+    if(sensor < 0 || sensor >= SENSOR_COUNT) {
+        PyErr_SetString(PyExc_ValueError, "unknown sensor");
+        return nullptr;
+    }
+    const std::vector<long>& times = self->parser->times((sensor_t)sensor);
+    Py_ssize_t shape[1] = {(Py_ssize_t)times.size()};
+    Py_ssize_t strides[1] = {(Py_ssize_t)sizeof(long)};
+    return array_new(std::shared_ptr<const void>(), (PyObject*)self, times.data(), "l", sizeof(long), 1, shape, strides);
+}
+
+static PyMethodDef parser_methods[] = {
+    {"next", (PyCFunction)parser_next, METH_NOARGS, "Next message of the replay, None once done"},
+    {"lidar", (PyCFunction)parser_lidar, METH_VARARGS, "Lidar scan at an index of its stream"},
+    {"gpsimu", (PyCFunction)parser_gpsimu, METH_VARARGS, "OXTS record at an index of its stream"},
+    {"times", (PyCFunction)parser_times, METH_VARARGS, "Timestamps (ms) of a stream, as an int64 array"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+
+static PyModuleDef module_def = {PyModuleDef_HEAD_INIT, "kitti_parser",
+                                 "Zero copy access to KITTI raw drives through the kitti_parser library", -1, nullptr};
+
+
+/**
+ * Types are filled in here, since C++11 has no designated initializers
+ */
+PyMODINIT_FUNC PyInit_kitti_parser(void) {
+
+    ArrayType.tp_name = "kitti_parser.Array";
+    ArrayType.tp_basicsize = sizeof(ArrayObject);
+    ArrayType.tp_dealloc = (destructor)array_dealloc;
+    ArrayType.tp_as_buffer = &array_buffer;
+    ArrayType.tp_as_sequence = &array_sequence;
+    ArrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ArrayType.tp_doc = "Read only array, use numpy.asarray() to view it without a copy";
+
+    MessageType.tp_name = "kitti_parser.Message";
+    MessageType.tp_basicsize = sizeof(MessageObject);
+    MessageType.tp_dealloc = (destructor)message_dealloc;
+    MessageType.tp_flags = Py_TPFLAGS_DEFAULT;
+    MessageType.tp_doc = "A single measurement";
+    MessageType.tp_getset = message_getset;
+
+    ParserType.tp_name = "kitti_parser.Parser";
+    ParserType.tp_basicsize = sizeof(ParserObject);
+    ParserType.tp_new = PyType_GenericNew;
+    ParserType.tp_init = (initproc)parser_init;
+    ParserType.tp_dealloc = (destructor)parser_dealloc;
+    ParserType.tp_iter = parser_iter;
+    ParserType.tp_iternext = (iternextfunc)parser_iternext;
+    ParserType.tp_methods = parser_methods;
+    ParserType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ParserType.tp_doc = "Parser(path), replays a KITTI drive or date folder";
+
+    if(PyType_Ready(&ArrayType) < 0 || PyType_Ready(&MessageType) < 0 || PyType_Ready(&ParserType) < 0)
+        return nullptr;
+
+    PyObject* module = PyModule_Create(&module_def);
+    if(module == nullptr)
+        return nullptr;
+    Py_INCREF(&ParserType);
+    PyModule_AddObject(module, "Parser", (PyObject*)&ParserType);
+    Py_INCREF(&MessageType);
+    PyModule_AddObject(module, "Message", (PyObject*)&MessageType);
+    Py_INCREF(&ArrayType);
+    PyModule_AddObject(module, "Array", (PyObject*)&ArrayType);
+    PyModule_AddIntConstant(module, "SENSOR_STEREO_GRAY", SENSOR_STEREO_GRAY);
+    PyModule_AddIntConstant(module, "SENSOR_STEREO_COLOR", SENSOR_STEREO_COLOR);
+    PyModule_AddIntConstant(module, "SENSOR_LIDAR", SENSOR_LIDAR);
+    PyModule_AddIntConstant(module, "SENSOR_GPSIMU", SENSOR_GPSIMU);
+    return module;
+
+}
@@ -0,0 +1,228 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <boost/filesystem.hpp>
+#include "kitti_parser/Parser.h"
+#include "kitti_parser/util/AsyncReader.h"
+
+#if !defined(__cpp_impl_coroutine)
+#error "This check needs C++20 coroutines"
+#endif
+
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// Size of the drive we write
+static const int NUM_SCANS = 4;
+static const int NUM_POINTS = 100;
+static const int NUM_OXTS = 8;
+
+
+/**
+ * Writes a timestamp file, one line per message
+ */
+static void write_timestamps(const boost::filesystem::path& path, int count, int start_ms, int period_ms) {
+    ofstream file(path.string());
+    for(int i=0; i<count; i++) {
+        int ms = start_ms + i*period_ms;
+        char line[64];
+        snprintf(line, sizeof(line), "2011-01-01 10:00:%02d.%03d000000\n", ms/1000, ms%1000);
+        file << line;
+    }
+}
+
+
+/**
+ * Tiny drive with only lidar and OXTS, so no images are needed
+ */
+static void write_drive(const boost::filesystem::path& path_drive) {
+    boost::filesystem::path velo = path_drive / "velodyne_points";
+    boost::filesystem::create_directories(velo / "data");
+    write_timestamps(velo / "timestamps.txt", NUM_SCANS, 50, 100);
+    write_timestamps(velo / "timestamps_start.txt", NUM_SCANS, 50, 100);
+    write_timestamps(velo / "timestamps_end.txt", NUM_SCANS, 50, 100);
+    for(int i=0; i<NUM_SCANS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%010d.bin", i);
+        ofstream file((velo / "data" / name).string(), std::ios::binary);
+        for(int p=0; p<NUM_POINTS; p++) {
+            float point[4] = {(float)(i + p), 2.0f*p, -1.0f, 0.5f};
+            file.write((const char*)point, sizeof(point));
+        }
+    }
+    boost::filesystem::path oxts = path_drive / "oxts";
+    boost::filesystem::create_directories(oxts / "data");
+    write_timestamps(oxts / "timestamps.txt", NUM_OXTS, 10, 50);
+    for(int i=0; i<NUM_OXTS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%010d.txt", i);
+        ofstream file((oxts / "data" / name).string());
+        file << 49.0 + 0.001*i << " 8.0";
+        for(int k=2; k<25; k++)
+            file << " " << 0.1*k;
+        file << " 4 10 3 3 3\n";
+    }
+}
+
+
+/**
+ * Jobs posted by the reader, run on the main thread
+ */
+class Executor {
+
+public:
+
+    void post(std::function<void()> job) {
+        std::lock_guard<std::mutex> guard(lock);
+        jobs.push_back(std::move(job));
+        cv.notify_all();
+    }
+
+    void finish() {
+        std::lock_guard<std::mutex> guard(lock);
+        done = true;
+        cv.notify_all();
+    }
+
+    // Runs jobs till the replay is finished
+    void run() {
+        std::unique_lock<std::mutex> guard(lock);
+        while(true) {
+            cv.wait(guard, [&]() { return done || !jobs.empty(); });
+            if(jobs.empty())
+                return;
+            std::function<void()> job = std::move(jobs.front());
+            jobs.pop_front();
+            guard.unlock();
+            job();
+            guard.lock();
+        }
+    }
+
+private:
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> jobs;
+    bool done = false;
+
+};
+
+
+// Coroutine that starts right away and frees itself at the end
+struct task_t {
+    struct promise_type {
+        task_t get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// What a replay saw
+typedef struct {
+    int scans = 0;
+    int records = 0;
+    bool ordered = true;
+    bool complete = true;
+} result_t;
+
+
+/**
+ * Awaits every message, then tells the executor we are done
+ */
+static task_t replay(AsyncReader& reader, result_t& result, Executor& executor) {
+    long last = LONG_MIN;
+    while(Message msg = co_await reader.next_frame()) {
+        result.ordered = result.ordered && (msg.timestamp() >= last);
+        last = msg.timestamp();
+        if(msg.lidar() != nullptr) {
+            result.complete = result.complete && (msg.lidar()->points.size() == (size_t)NUM_POINTS);
+            result.scans++;
+        } else if(msg.gpsimu() != nullptr) {
+            result.records++;
+        }
+    }
+    executor.finish();
+}
+
+
+/**
+ * Replays the drive with the given mode, false if anything was off
+ */
+static bool check(const std::string& path_date, const std::string& name, bool with_executor, AsyncReader::work_t work) {
+    Parser parser(path_date);
+    if(!parser.valid()) {
+        cerr << "[kitti_parser]: Async check failed, " << name << " could not load the drive" << endl;
+        return false;
+    }
+    Executor executor;
+    AsyncReader::executor_t post = nullptr;
+    if(with_executor)
+        post = [&executor](std::function<void()> job) { executor.post(std::move(job)); };
+    AsyncReader reader(parser, post, work);
+    result_t result;
+    replay(reader, result, executor);
+    executor.run();
+    if(result.scans != NUM_SCANS || result.records != NUM_OXTS || !result.ordered || !result.complete) {
+        cerr << "[kitti_parser]: Async check failed, " << name << " got " << result.scans << " scans and "
+             << result.records << " records" << ((result.ordered)? "" : ", out of order") << endl;
+        return false;
+    }
+    return true;
+}
+
+
+int main(int argc, char** argv) {
+
+    // Drive in a temp folder
+    boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("kitti_parser_%%%%%%%%");
+    write_drive(folder / "2011_01_01_drive_0001_sync");
+
+    // Resumed on the reader thread, on an executor, and loading on the executor
+    bool success = check(folder.string(), "reader thread", false, AsyncReader::WORK_LIBRARY);
+    success = check(folder.string(), "executor", true, AsyncReader::WORK_LIBRARY) && success;
+    success = check(folder.string(), "loading on the executor", true, AsyncReader::WORK_EXECUTOR) && success;
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(folder, ec);
+    if(!success)
+        return EXIT_FAILURE;
+    cout << "[kitti_parser]: Async check passed" << endl;
+    return EXIT_SUCCESS;
+
+}
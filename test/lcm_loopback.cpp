@@ -0,0 +1,177 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <endian.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "kitti_parser/util/LcmPublisher.h"
+
+
+using namespace std;
+using namespace kitti_parser;
+
+
+// Readers for the big endian fields of the LCM headers
+static uint32_t get_u32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return be32toh(v);
+}
+
+static uint64_t get_u64(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return be64toh(v);
+}
+
+static bool fail(const std::string& what) {
+    cerr << "[kitti_parser]: Loopback check failed, " << what << endl;
+    return false;
+}
+
+
+/**
+ * Receives one LCM message, putting the fragments back together
+ * Returns the channel and the payload, the fingerprint is left at the start of it
+ */
+static bool receive(int fd, std::string& channel, std::vector<char>& payload) {
+    std::vector<char> datagram(65536);
+    size_t received = 0, fragments = 0;
+    while(true) {
+        ssize_t n = recv(fd, datagram.data(), datagram.size(), 0);
+        if(n < 0)
+            return fail("nothing received (" + std::string(strerror(errno)) + ")");
+        const char* p = datagram.data();
+        uint32_t magic = get_u32(p);
+        // Whole message, the channel then the payload
+        if(magic == 0x4c433032) {
+            channel = std::string(p + 8);
+            size_t start = 8 + channel.size() + 1;
+            payload.assign(p + start, p + n);
+            return true;
+        }
+        if(magic != 0x4c433033)
+            return fail("unknown magic");
+        // Fragment, the first also carries the channel
+        uint32_t size = get_u32(p + 8);
+        uint32_t offset = get_u32(p + 12);
+        uint16_t index = (uint16_t)(((unsigned char)p[16] << 8) | (unsigned char)p[17]);
+        uint16_t count = (uint16_t)(((unsigned char)p[18] << 8) | (unsigned char)p[19]);
+        size_t start = 20;
+        if(index == 0) {
+            channel = std::string(p + 20);
+            start += channel.size() + 1;
+            payload.resize(size);
+        }
+        if(payload.size() != size || offset + (n - start) > size)
+            return fail("fragment out of range");
+        memcpy(payload.data() + offset, p + start, n - start);
+        received += n - start;
+        fragments++;
+        if(fragments == count)
+            return (received == size)? true : fail("fragments do not add up");
+    }
+}
+
+
+/**
+ * Publishes to a socket on 127.0.0.1 and checks what arrives
+ * A small OXTS message goes out as one datagram, and a large scan is split into fragments
+ */
+int main(int argc, char** argv) {
+
+    // Receiver on an open port
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    int rcvbuf = 8 << 20;
+    struct timeval timeout = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if(fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || getsockname(fd, (struct sockaddr*)&addr, &len) != 0) {
+        cerr << "[kitti_parser]: Unable to open the receiving socket" << endl;
+        return EXIT_FAILURE;
+    }
+    LcmPublisher publisher("udpm://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "?ttl=0");
+    if(!publisher.valid())
+        return EXIT_FAILURE;
+
+    // Small message
+    gpsimu_t meas;
+    memset(&meas, 0, sizeof(meas));
+    meas.timestamp = 1234;
+    meas.lat = 49.011;
+    meas.numsats = 7;
+    std::string channel;
+    std::vector<char> payload;
+    if(!publisher.publish(meas) || !receive(fd, channel, payload))
+        return EXIT_FAILURE;
+    if(channel != LcmPublisher::CHANNEL_GPSIMU || payload.size() != 8 + 8 + 25*8 + 5*4) {
+        fail("wrong OXTS message");
+        return EXIT_FAILURE;
+    }
+    uint64_t lat_bits = get_u64(payload.data() + 16);
+    double lat;
+    memcpy(&lat, &lat_bits, 8);
+    if((long)get_u64(payload.data() + 8) != meas.timestamp || lat != meas.lat || get_u32(payload.data() + 8 + 8 + 25*8 + 4) != 7) {
+        fail("wrong OXTS fields");
+        return EXIT_FAILURE;
+    }
+
+    // Large message, about a dozen fragments
+    lidar_t scan;
+    scan.timestamp = 20;
+    scan.timestamp_start = 10;
+    scan.timestamp_end = 30;
+    scan.points.resize(50000);
+    for(size_t i=0; i<scan.points.size(); i++)
+        scan.points[i] = {{(float)i, 0.5f*i, -1.0f*i, 0.25f}};
+    if(!publisher.publish(scan) || !receive(fd, channel, payload))
+        return EXIT_FAILURE;
+    size_t bytes = scan.points.size()*sizeof(std::array<float,4>);
+    if(channel != LcmPublisher::CHANNEL_LIDAR || payload.size() != 40 + bytes) {
+        fail("wrong lidar message");
+        return EXIT_FAILURE;
+    }
+    if((long)get_u64(payload.data() + 8) != scan.timestamp || get_u32(payload.data() + 32) != scan.points.size()
+       || get_u32(payload.data() + 36) != bytes || memcmp(payload.data() + 40, scan.points.data(), bytes) != 0) {
+        fail("wrong lidar fields");
+        return EXIT_FAILURE;
+    }
+
+    close(fd);
+    cout << "[kitti_parser]: Loopback check passed" << endl;
+    return EXIT_SUCCESS;
+
+}
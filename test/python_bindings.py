@@ -0,0 +1,141 @@
+# MIT License
+#
+# Copyright (c) 2016 Patrick Geneva <pgeneva@udel.edu>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+"""
+Checks the Python module against a tiny drive written here, with only lidar and OXTS so no images are needed
+Run with the build folder on PYTHONPATH, ctest does this when configured with -DBUILD_PYTHON=ON
+"""
+
+import gc
+import os
+import shutil
+import struct
+import tempfile
+import threading
+import unittest
+
+import kitti_parser
+
+
+NUM_SCANS = 4
+NUM_POINTS = 100
+NUM_OXTS = 8
+
+
+def write_timestamps(path, count, start_ms, period_ms):
+    with open(path, "w") as f:
+        for i in range(count):
+            ms = start_ms + i*period_ms
+            f.write("2011-01-01 10:00:%02d.%03d000000\n" % (ms // 1000, ms % 1000))
+
+
+def write_drive(path_drive):
+    velo = os.path.join(path_drive, "velodyne_points")
+    os.makedirs(os.path.join(velo, "data"))
+    for name in ("timestamps.txt", "timestamps_start.txt", "timestamps_end.txt"):
+        write_timestamps(os.path.join(velo, name), NUM_SCANS, 50, 100)
+    for i in range(NUM_SCANS):
+        with open(os.path.join(velo, "data", "%010d.bin" % i), "wb") as f:
+            for p in range(NUM_POINTS):
+                f.write(struct.pack("<4f", i + p, 2.0*p, -1.0, 0.5))
+    oxts = os.path.join(path_drive, "oxts")
+    os.makedirs(os.path.join(oxts, "data"))
+    write_timestamps(os.path.join(oxts, "timestamps.txt"), NUM_OXTS, 10, 50)
+    for i in range(NUM_OXTS):
+        values = [49.0 + 0.001*i, 8.0] + [0.1*k for k in range(2, 25)] + [4, 10, 3, 3, 3]
+        with open(os.path.join(oxts, "data", "%010d.txt" % i), "w") as f:
+            f.write(" ".join(str(v) for v in values) + "\n")
+
+
+class BindingsTest(unittest.TestCase):
+
+    def setUp(self):
+        self.folder = tempfile.mkdtemp(prefix="kitti_parser_")
+        write_drive(os.path.join(self.folder, "2011_01_01_drive_0001_sync"))
+
+    def tearDown(self):
+        shutil.rmtree(self.folder)
+
+    def test_replay(self):
+        parser = kitti_parser.Parser(self.folder)
+        counts = {kitti_parser.SENSOR_LIDAR: 0, kitti_parser.SENSOR_GPSIMU: 0}
+        last = -1
+        for msg in parser:
+            self.assertGreaterEqual(msg.timestamp, last)
+            last = msg.timestamp
+            counts[msg.sensor] += 1
+            if msg.sensor == kitti_parser.SENSOR_LIDAR:
+                points = memoryview(msg.points)
+                self.assertEqual(points.shape, (NUM_POINTS, 4))
+                self.assertEqual(points.format, "f")
+                self.assertTrue(points.readonly)
+            else:
+                self.assertAlmostEqual(msg.oxts["lat"], 49.0 + 0.001*counts[msg.sensor] - 0.001)
+        self.assertEqual(counts[kitti_parser.SENSOR_LIDAR], NUM_SCANS)
+        self.assertEqual(counts[kitti_parser.SENSOR_GPSIMU], NUM_OXTS)
+        self.assertIsNone(parser.next())
+
+    def test_random_access(self):
+        parser = kitti_parser.Parser(self.folder)
+        times = memoryview(parser.times(kitti_parser.SENSOR_LIDAR)).tolist()
+        self.assertEqual([t - times[0] for t in times], [100*i for i in range(NUM_SCANS)])
+        points = memoryview(parser.lidar(-1).points)
+        self.assertEqual(points[0, 0], float(NUM_SCANS - 1))
+        self.assertEqual(parser.gpsimu(2).oxts["numsats"], 10)
+        with self.assertRaises(IndexError):
+            parser.lidar(NUM_SCANS)
+
+    def test_threads(self):
+        parser = kitti_parser.Parser(self.folder)
+        sums = [0.0]*NUM_SCANS
+        def fetch(i):
+            sums[i] = sum(memoryview(parser.lidar(i).points).cast("B").cast("f")[0::4])
+        threads = [threading.Thread(target=fetch, args=(i,)) for i in range(NUM_SCANS)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertEqual(sums, [float(NUM_POINTS*i + NUM_POINTS*(NUM_POINTS - 1)//2) for i in range(NUM_SCANS)])
+
+    def test_arrays_outlive_parser(self):
+        parser = kitti_parser.Parser(self.folder)
+        points = memoryview(parser.lidar(1).points)
+        del parser
+        gc.collect()
+        self.assertEqual(points[5, 1], 10.0)
+
+    def test_buffer_flags(self):
+        parser = kitti_parser.Parser(self.folder)
+        points = parser.lidar(2).points
+        # Plain byte consumers ask for neither the shape nor the strides
+        self.assertEqual(len(bytes(points)), NUM_POINTS*16)
+        self.assertEqual(struct.unpack_from("<4f", points, 16), (3.0, 2.0, -1.0, 0.5))
+        with self.assertRaises(TypeError):
+            memoryview(points).cast("B")[0:1] = b"x"
+
+    def test_invalid_path(self):
+        with self.assertRaises(IOError):
+            kitti_parser.Parser(os.path.join(self.folder, "missing"))
+
+
+if __name__ == "__main__":
+    unittest.main()